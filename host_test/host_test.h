@@ -0,0 +1,31 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+/*
+    Minimal checks for the host tests: a failing CHECK prints where and why and the test
+    carries on, so one run reports every failure. main returns host_test_result().
+*/
+
+static int host_test_failures;
+
+#define CHECK(cond, ...)                                                \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            printf("%s:%d: ", __FILE__, __LINE__);                      \
+            printf(__VA_ARGS__);                                        \
+            printf("\n");                                               \
+            host_test_failures++;                                       \
+        }                                                               \
+    } while (0)
+
+static inline int host_test_result(const char *name)
+{
+    printf("%s: %s\n", name, host_test_failures == 0 ? "passed" : "FAILED");
+    return host_test_failures == 0 ? 0 : 1;
+}
+
+#endif
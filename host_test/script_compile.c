@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "script_compiler.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+/* Default CONFIG_KBM_SCRIPT_MAX_SIZE; a bigger program is refused by 'script load' anyway */
+#define SCRIPT_COMPILE_MAX_CODE 4096
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static char *read_all(FILE *file);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static char *read_all(FILE *file)
+{
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+
+    while (buf != NULL)
+    {
+        len += fread(&buf[len], 1, cap - len - 1, file);
+        if (len < cap - 1)
+        {
+            buf[len] = '\0';
+            return buf;
+        }
+        cap *= 2;
+        char *grown = realloc(buf, cap);
+        if (grown == NULL)
+        {
+            free(buf);
+        }
+        buf = grown;
+    }
+    return NULL;
+}
+
+/*
+    Compiles a script on a PC and prints the bytecode as the hex string 'script load' takes:
+
+        script_compile hello.txt
+        script_compile < hello.txt
+*/
+int main(int argc, char **argv)
+{
+    FILE *file = argc > 1 ? fopen(argv[1], "r") : stdin;
+    uint8_t code[SCRIPT_COMPILE_MAX_CODE];
+    script_compile_result_t result;
+
+    if (argc > 2 || file == NULL)
+    {
+        fprintf(stderr, "usage: %s [script]\n", argv[0]);
+        return 2;
+    }
+
+    char *src = read_all(file);
+    if (src == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    bool ok = script_compile(src, code, sizeof(code), &result);
+    free(src);
+    if (!ok)
+    {
+        fprintf(stderr, "%s:%d: %s\n", argc > 1 ? argv[1] : "<stdin>", result.line, result.error);
+        return 1;
+    }
+
+    printf("script load ");
+    for (size_t i = 0; i < result.len; i++)
+    {
+        printf("%02x", code[i]);
+    }
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mouse_path.h"
+#include "host_test.h"
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void check_path(const char *name, mouse_path_kind_t kind, const mouse_point_t *points, size_t num_points,
+                       uint32_t steps);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+/* Deltas must add up exactly to the end point, within int8 and in no fewer than steps reports */
+static void check_path(const char *name, mouse_path_kind_t kind, const mouse_point_t *points, size_t num_points,
+                       uint32_t steps)
+{
+    mouse_path_t path;
+    int32_t x = 0, y = 0;
+    uint32_t reports = 0;
+    int8_t dx, dy;
+
+    CHECK(mouse_path_init(&path, kind, points, num_points, steps), "%s: init", name);
+    while (mouse_path_next(&path, &dx, &dy))
+    {
+        CHECK(dx >= -127 && dy >= -127, "%s: delta %d,%d out of range", name, dx, dy);
+        x += dx;
+        y += dy;
+        reports++;
+        if (reports > steps + 1000)
+        {
+            break;
+        }
+    }
+
+    const mouse_point_t *end = &points[num_points - 1];
+    CHECK(x == end->x && y == end->y, "%s: ended at %d,%d, expected %d,%d", name, (int)x, (int)y,
+          (int)end->x, (int)end->y);
+    CHECK(reports >= steps, "%s: %u reports for %u steps", name, (unsigned)reports, (unsigned)steps);
+    CHECK(!mouse_path_next(&path, &dx, &dy), "%s: still moving after the end", name);
+}
+
+int main(void)
+{
+    const mouse_point_t line[] = {{333, -71}};
+    const mouse_point_t far[] = {{-5000, 2500}};
+    const mouse_point_t still[] = {{0, 0}};
+    const mouse_point_t bezier[] = {{100, -300}, {400, 300}, {517, 3}};
+    const mouse_point_t poly[MOUSE_PATH_MAX_POINTS] = {
+        {10, 0}, {10, 10}, {-37, 10}, {-37, -200}, {1, 1}, {99, -3}, {-250, 40}, {7, 123},
+    };
+
+    check_path("line", MOUSE_PATH_LINE, line, 1, 40);
+    check_path("line, one step", MOUSE_PATH_LINE, line, 1, 1);
+    check_path("line, zero steps", MOUSE_PATH_LINE, line, 1, 0);
+    check_path("line, clamped", MOUSE_PATH_LINE, far, 1, 3);
+    check_path("line, no motion", MOUSE_PATH_LINE, still, 1, 10);
+    check_path("bezier", MOUSE_PATH_BEZIER, bezier, 3, 60);
+    check_path("bezier, few steps", MOUSE_PATH_BEZIER, bezier, 3, 2);
+    check_path("poly, one point", MOUSE_PATH_POLYLINE, poly, 1, 7);
+    check_path("poly, all points", MOUSE_PATH_POLYLINE, poly, MOUSE_PATH_MAX_POINTS, 97);
+    check_path("poly, more steps than pixels", MOUSE_PATH_POLYLINE, poly, 3, 500);
+
+    mouse_path_t path;
+    CHECK(!mouse_path_init(&path, MOUSE_PATH_BEZIER, bezier, 2, 10), "bezier with two points accepted");
+    CHECK(!mouse_path_init(&path, MOUSE_PATH_LINE, bezier, 2, 10), "line with two points accepted");
+    CHECK(!mouse_path_init(&path, MOUSE_PATH_POLYLINE, poly, 0, 10), "poly without points accepted");
+
+    return host_test_result("mouse_path");
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdio.h>
+
+#include "hid_stats.h"
+#include "phy_policy.h"
+#include "host_test.h"
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void check_counts(const char *name, uint32_t phy_2m, uint32_t phy_1m);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static void check_counts(const char *name, uint32_t phy_2m, uint32_t phy_1m)
+{
+    uint32_t counters[HID_STAT_NUM];
+
+    hid_stats_snapshot(counters);
+    CHECK(counters[HID_STAT_PHY_2M] == phy_2m && counters[HID_STAT_PHY_1M] == phy_1m,
+          "%s: counted %u on 2M and %u on 1M, expected %u and %u", name, (unsigned)counters[HID_STAT_PHY_2M],
+          (unsigned)counters[HID_STAT_PHY_1M], (unsigned)phy_2m, (unsigned)phy_1m);
+    hid_stats_reset();
+}
+
+int main(void)
+{
+    uint8_t mask = 0;
+    uint8_t tx_phy = 0, rx_phy = 0;
+
+    /* BLE 5 link, central moves to 2M */
+    hid_stats_reset();
+    CHECK(phy_policy_connect(true, &mask), "ble5: no update requested");
+    CHECK(mask == (PHY_POLICY_1M_PREF_MASK | PHY_POLICY_2M_PREF_MASK), "ble5: preferred mask 0x%x", mask);
+    check_counts("ble5 connect", 0, 0);
+    CHECK(phy_policy_update(true, PHY_POLICY_2M, PHY_POLICY_2M, &tx_phy, &rx_phy), "2M: reported as failed");
+    CHECK(tx_phy == PHY_POLICY_2M && rx_phy == PHY_POLICY_2M, "2M: recorded tx %u, rx %u", tx_phy, rx_phy);
+    check_counts("2M", 1, 0);
+
+    /* Update succeeds but the central keeps one direction, or both, on 1M */
+    CHECK(phy_policy_update(true, PHY_POLICY_1M, PHY_POLICY_2M, &tx_phy, &rx_phy), "tx 1M: reported as failed");
+    CHECK(tx_phy == PHY_POLICY_1M && rx_phy == PHY_POLICY_2M, "tx 1M: recorded tx %u, rx %u", tx_phy, rx_phy);
+    check_counts("tx 1M", 0, 1);
+
+    /* Central refuses: whatever the event carries, the link is on 1M */
+    tx_phy = rx_phy = 0;
+    CHECK(!phy_policy_update(false, PHY_POLICY_2M, PHY_POLICY_CODED, &tx_phy, &rx_phy), "refused: reported as success");
+    CHECK(tx_phy == PHY_POLICY_1M && rx_phy == PHY_POLICY_1M, "refused: recorded tx %u, rx %u", tx_phy, rx_phy);
+    check_counts("refused", 0, 1);
+
+    /* Controller without BLE 5: nothing requested, counted as 1M right away */
+    mask = 0xff;
+    CHECK(!phy_policy_connect(false, &mask), "no ble5: update requested");
+    CHECK(mask == 0xff, "no ble5: mask written");
+    check_counts("no ble5", 0, 1);
+
+    return host_test_result("phy_policy");
+}
@@ -0,0 +1,311 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "hid_codes.h"
+#include "script_compiler.h"
+#include "script_vm.h"
+#include "host_test.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define RECORD_MAX_EVENTS   64
+#define RECORD_MAX_CODE     1024
+
+/* Simulated cost of handing an event to the HID task and of typing one character */
+#define RECORD_EMIT_US      300
+#define RECORD_CHAR_US      2000
+
+typedef struct
+{
+    uint64_t time_us;
+    input_event_t event;
+    char text[32];          /* typed text, event.type is 0xff */
+} record_entry_t;
+
+typedef struct
+{
+    uint64_t now_us;
+    uint64_t leds_on_at_us; /* Caps Lock turns on at this time, 0 for never */
+    uint32_t stop_after;    /* should_stop calls before it returns true, 0 for never */
+    uint32_t stop_polls;
+    record_entry_t entries[RECORD_MAX_EVENTS];
+    size_t count;
+} record_t;
+
+#define RECORD_TEXT 0xff
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void record_emit(const input_event_t *event, void *ctx);
+static void record_type_text(const char *text, size_t len, void *ctx);
+static uint64_t record_now_us(void *ctx);
+static void record_wait_until(uint64_t deadline_us, void *ctx);
+static uint8_t record_leds(void *ctx);
+static bool record_should_stop(void *ctx);
+static bool run(const char *src, record_t *rec, script_result_t *result);
+static void check_key(const record_t *rec, size_t i, uint8_t type, uint8_t modifier, uint8_t keycode,
+                      uint64_t time_us);
+static void check_mouse(const record_t *rec, size_t i, uint8_t buttons, int8_t dx, int8_t dy);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static void record_emit(const input_event_t *event, void *ctx)
+{
+    record_t *rec = ctx;
+
+    if (rec->count < RECORD_MAX_EVENTS)
+    {
+        rec->entries[rec->count].time_us = rec->now_us;
+        rec->entries[rec->count++].event = *event;
+    }
+    rec->now_us += RECORD_EMIT_US;
+}
+
+static void record_type_text(const char *text, size_t len, void *ctx)
+{
+    record_t *rec = ctx;
+
+    if (rec->count < RECORD_MAX_EVENTS)
+    {
+        record_entry_t *entry = &rec->entries[rec->count++];
+        entry->time_us = rec->now_us;
+        entry->event.type = RECORD_TEXT;
+        snprintf(entry->text, sizeof(entry->text), "%.*s", (int)len, text);
+    }
+    rec->now_us += len * RECORD_CHAR_US;
+}
+
+static uint64_t record_now_us(void *ctx)
+{
+    return ((record_t *)ctx)->now_us;
+}
+
+static void record_wait_until(uint64_t deadline_us, void *ctx)
+{
+    record_t *rec = ctx;
+
+    if (deadline_us > rec->now_us)
+    {
+        rec->now_us = deadline_us;
+    }
+}
+
+static uint8_t record_leds(void *ctx)
+{
+    record_t *rec = ctx;
+
+    return rec->leds_on_at_us != 0 && rec->now_us >= rec->leds_on_at_us ? LED_CAPS_LOCK : 0;
+}
+
+static bool record_should_stop(void *ctx)
+{
+    record_t *rec = ctx;
+
+    return rec->stop_after != 0 && ++rec->stop_polls >= rec->stop_after;
+}
+
+/* Compiles src and runs it from time 0; false when it does not compile */
+static bool run(const char *src, record_t *rec, script_result_t *result)
+{
+    static uint8_t code[RECORD_MAX_CODE];
+    script_compile_result_t compiled;
+    const script_host_t host = {
+        .emit = record_emit,
+        .type_text = record_type_text,
+        .now_us = record_now_us,
+        .wait_until = record_wait_until,
+        .leds = record_leds,
+        .should_stop = record_should_stop,
+        .ctx = rec,
+    };
+
+    if (!script_compile(src, code, sizeof(code), &compiled))
+    {
+        printf("line %d: %s\n", compiled.line, compiled.error);
+        return false;
+    }
+    rec->now_us = 0;
+    rec->count = 0;
+    script_vm_run(code, compiled.len, &host, result);
+    return true;
+}
+
+static void check_key(const record_t *rec, size_t i, uint8_t type, uint8_t modifier, uint8_t keycode,
+                      uint64_t time_us)
+{
+    const record_entry_t *entry = &rec->entries[i];
+
+    CHECK(i < rec->count, "event %u missing", (unsigned)i);
+    CHECK(entry->event.type == type && entry->event.keyboard.modifier == modifier &&
+              entry->event.keyboard.keycode == keycode,
+          "event %u is type %u, %02x %02x, expected type %u, %02x %02x", (unsigned)i, entry->event.type,
+          entry->event.keyboard.modifier, entry->event.keyboard.keycode, type, modifier, keycode);
+    CHECK(entry->time_us == time_us, "event %u at %llu us, expected %llu", (unsigned)i,
+          (unsigned long long)entry->time_us, (unsigned long long)time_us);
+}
+
+static void check_mouse(const record_t *rec, size_t i, uint8_t buttons, int8_t dx, int8_t dy)
+{
+    const mouse_t *mouse = &rec->entries[i].event.mouse;
+
+    CHECK(i < rec->count && rec->entries[i].event.type == INPUT_EVENT_MOUSE, "event %u is not a mouse report",
+          (unsigned)i);
+    CHECK(mouse->mouse_buttons == buttons && mouse->movement_x == dx && mouse->movement_y == dy,
+          "mouse %u is %u %d %d, expected %u %d %d", (unsigned)i, mouse->mouse_buttons, mouse->movement_x,
+          mouse->movement_y, buttons, dx, dy);
+}
+
+static void test_keys_text_and_delay(void)
+{
+    record_t rec = {0};
+    script_result_t result;
+
+    CHECK(run("REM open a terminal\nGUI r\nDELAY 500\nSTRINGLN cmd\nCTRL ALT DELETE\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_OK && rec.count == 4, "status %d, %u events", result.status, (unsigned)rec.count);
+    check_key(&rec, 0, INPUT_EVENT_KEYBOARD, LEFT_GUI_KEY_MASK, HID_KEY_R, 0);
+    /* The delay counts from the start, not from the end of the tap */
+    CHECK(rec.entries[1].event.type == RECORD_TEXT && strcmp(rec.entries[1].text, "cmd") == 0 &&
+              rec.entries[1].time_us == 500000,
+          "text '%s' at %llu", rec.entries[1].text, (unsigned long long)rec.entries[1].time_us);
+    check_key(&rec, 2, INPUT_EVENT_KEYBOARD, 0, HID_KEY_RETURN, 500000 + 3 * RECORD_CHAR_US);
+    check_key(&rec, 3, INPUT_EVENT_KEYBOARD, LEFT_CONTROL_KEY_MASK | LEFT_ALT_KEY_MASK, HID_KEY_DELETE_FWD,
+              500000 + 3 * RECORD_CHAR_US + RECORD_EMIT_US);
+}
+
+static void test_default_delay_does_not_drift(void)
+{
+    record_t rec = {0};
+    script_result_t result;
+
+    /* Emitting costs time, but every wait is measured from the previous deadline */
+    CHECK(run("DEFAULT_DELAY 10\na\nb\nc\nREPEAT 2\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_OK && rec.count == 5, "status %d, %u events", result.status, (unsigned)rec.count);
+    check_key(&rec, 0, INPUT_EVENT_KEYBOARD, 0, HID_KEY_A, 0);
+    check_key(&rec, 1, INPUT_EVENT_KEYBOARD, 0, HID_KEY_B, 10000);
+    check_key(&rec, 2, INPUT_EVENT_KEYBOARD, 0, HID_KEY_C, 20000);
+    check_key(&rec, 3, INPUT_EVENT_KEYBOARD, 0, HID_KEY_C, 30000);
+    check_key(&rec, 4, INPUT_EVENT_KEYBOARD, 0, HID_KEY_C, 40000);
+    CHECK(rec.now_us == 50000, "ended at %llu us", (unsigned long long)rec.now_us);
+}
+
+static void test_hold_release(void)
+{
+    record_t rec = {0};
+    script_result_t result;
+
+    CHECK(run("HOLD SHIFT a\nDELAY 20\nRELEASE\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_OK && rec.count == 2, "status %d, %u events", result.status, (unsigned)rec.count);
+    check_key(&rec, 0, INPUT_EVENT_KEY_REPORT, LEFT_SHIFT_KEY_MASK, HID_KEY_A, 0);
+    check_key(&rec, 1, INPUT_EVENT_KEY_REPORT, 0, 0, 20000);
+}
+
+static void test_mouse_and_media(void)
+{
+    record_t rec = {0};
+    script_result_t result;
+
+    CHECK(run("MOUSE 300 -5\nCLICK RIGHT\nMEDIA MUTE\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_OK && rec.count == 7, "status %d, %u events", result.status, (unsigned)rec.count);
+    /* Split into reports of at most 127 counts per axis */
+    check_mouse(&rec, 0, 0, 127, -5);
+    check_mouse(&rec, 1, 0, 127, 0);
+    check_mouse(&rec, 2, 0, 46, 0);
+    check_mouse(&rec, 3, 0x02, 0, 0);
+    check_mouse(&rec, 4, 0, 0, 0);
+    CHECK(rec.entries[5].event.type == INPUT_EVENT_CONSUMER && rec.entries[5].event.consumer.usage == HID_CONSUMER_MUTE &&
+              rec.entries[5].event.consumer.pressed == 1 && rec.entries[6].event.consumer.pressed == 0,
+          "MEDIA is not a consumer tap");
+}
+
+static void test_while_loop(void)
+{
+    record_t rec = {0};
+    script_result_t result;
+
+    CHECK(run("VAR $i = 3\nWHILE ($i)\nSPACE\n$i = $i - 1\nEND_WHILE\nENTER\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_OK && rec.count == 4, "status %d, %u events", result.status, (unsigned)rec.count);
+    for (size_t i = 0; i < 3; i++)
+    {
+        check_key(&rec, i, INPUT_EVENT_KEYBOARD, 0, HID_KEY_SPACEBAR, i * RECORD_EMIT_US);
+    }
+    check_key(&rec, 3, INPUT_EVENT_KEYBOARD, 0, HID_KEY_RETURN, 3 * RECORD_EMIT_US);
+    CHECK(result.vars[0] == 0, "$i ended at %d", (int)result.vars[0]);
+}
+
+static void test_wait_for_led(void)
+{
+    record_t rec = {.leds_on_at_us = 25000};
+    script_result_t result;
+
+    CHECK(run("WAIT_FOR_CAPS_ON 1000\nDELAY 5\nx\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_OK && rec.count == 1, "status %d, %u events", result.status, (unsigned)rec.count);
+    /* Caught at the first poll after the LED turned on; the delay counts from there */
+    check_key(&rec, 0, INPUT_EVENT_KEYBOARD, 0, HID_KEY_X, 25000 + 5000);
+
+    rec = (record_t){0};
+    CHECK(run("WAIT_FOR_CAPS_ON 40\nx\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_ERR_TIMEOUT && rec.count == 0, "status %d, %u events", result.status,
+          (unsigned)rec.count);
+    CHECK(rec.now_us == 40000, "gave up at %llu us", (unsigned long long)rec.now_us);
+}
+
+static void test_stop(void)
+{
+    record_t rec = {.stop_after = 5};
+    script_result_t result;
+
+    CHECK(run("VAR $forever = 1\nWHILE ($forever)\nz\nEND_WHILE\n", &rec, &result), "compile");
+    CHECK(result.status == SCRIPT_STOPPED, "status %d", result.status);
+    CHECK(rec.count == 5, "%u events before the stop", (unsigned)rec.count);
+}
+
+static void test_compile_errors(void)
+{
+    static const struct
+    {
+        const char *src;
+        int line;
+    } bad[] = {
+        {"ENTER\nNOT_A_KEY\n", 2},
+        {"CTRL a b\n", 1},
+        {"WHILE ($x)\nEND_WHILE\n", 1},
+        {"END_WHILE\n", 1},
+        {"VAR $i = 1\nWHILE ($i)\n", 0},
+        {"REPEAT 3\n", 1},
+        {"DELAY -1\n", 1},
+        {"MEDIA LOUDER\n", 1},
+        {"WAIT_FOR_KANA_ON\n", 1},
+    };
+    uint8_t code[64];
+    script_compile_result_t result;
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        CHECK(!script_compile(bad[i].src, code, sizeof(code), &result), "'%s' compiled", bad[i].src);
+        CHECK(bad[i].line == 0 || result.line == bad[i].line, "'%s' failed on line %d, expected %d", bad[i].src,
+              result.line, bad[i].line);
+    }
+
+    CHECK(!script_compile("STRING this line does not fit a tiny program\n", code, 8, &result) &&
+              strcmp(result.error, "program too large") == 0,
+          "oversized program compiled");
+}
+
+int main(void)
+{
+    test_keys_text_and_delay();
+    test_default_delay_does_not_drift();
+    test_hold_release();
+    test_mouse_and_media();
+    test_while_loop();
+    test_wait_for_led();
+    test_stop();
+    test_compile_errors();
+    return host_test_result("script");
+}
@@ -0,0 +1,342 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "accel.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_ACCEL"
+
+#define ACCEL_NVS_NAMESPACE "kbm_accel"
+#define ACCEL_GAIN_ONE      256
+
+static const uint8_t knot_speeds[ACCEL_NUM_KNOTS] = ACCEL_KNOT_SPEEDS;
+
+/* Set from the Bluedroid callbacks, read by the script task */
+static portMUX_TYPE accel_lock = portMUX_INITIALIZER_UNLOCKED;
+static accel_curve_t curve;
+static char peer_key[13];
+
+static struct
+{
+    uint8_t counts;
+    float gain;
+} samples[ACCEL_MAX_SAMPLES];
+static size_t num_samples;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static float curve_gain(const accel_curve_t *c, float v);
+static float curve_inverse(const accel_curve_t *c, float pixels);
+static int8_t clamp_counts(float counts);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void accel_set_peer(const uint8_t *bda)
+{
+    accel_curve_t loaded = {0};
+    nvs_handle_t handle;
+    char key[sizeof(peer_key)];
+
+    /* NVS keys are at most 15 characters, the address in hex takes 12 */
+    snprintf(key, sizeof(key), "%02x%02x%02x%02x%02x%02x", bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+
+    if (nvs_open(ACCEL_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK)
+    {
+        size_t len = sizeof(loaded.gain);
+        loaded.valid = nvs_get_blob(handle, key, loaded.gain, &len) == ESP_OK && len == sizeof(loaded.gain);
+        nvs_close(handle);
+    }
+
+    portENTER_CRITICAL(&accel_lock);
+    strcpy(peer_key, key);
+    curve = loaded;
+    portEXIT_CRITICAL(&accel_lock);
+
+    ESP_LOGI(TAG, "Host %s: %s", key, loaded.valid ? "acceleration curve loaded" : "not calibrated");
+}
+
+void accel_clear_peer(void)
+{
+    portENTER_CRITICAL(&accel_lock);
+    peer_key[0] = '\0';
+    curve.valid = false;
+    portEXIT_CRITICAL(&accel_lock);
+}
+
+void accel_forget_all(void)
+{
+    nvs_handle_t handle;
+
+    if (nvs_open(ACCEL_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        nvs_erase_all(handle);
+        nvs_commit(handle);
+        nvs_close(handle);
+    }
+    portENTER_CRITICAL(&accel_lock);
+    curve.valid = false;
+    portEXIT_CRITICAL(&accel_lock);
+}
+
+esp_err_t accel_add_sample(uint8_t counts, uint32_t reports, uint32_t pixels)
+{
+    if (counts == 0 || reports == 0 || pixels == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* A new measurement at the same speed replaces the old one */
+    size_t i = 0;
+    while (i < num_samples && samples[i].counts != counts)
+    {
+        i++;
+    }
+    if (i == ACCEL_MAX_SAMPLES)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    samples[i].counts = counts;
+    samples[i].gain = (float)pixels / ((float)counts * reports);
+    if (i == num_samples)
+    {
+        num_samples++;
+    }
+    return ESP_OK;
+}
+
+void accel_clear_samples(void)
+{
+    num_samples = 0;
+}
+
+esp_err_t accel_fit(void)
+{
+    accel_curve_t fitted = {.valid = true};
+    char key[sizeof(peer_key)];
+
+    if (num_samples == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Insertion sort by speed, there are only a few samples */
+    for (size_t i = 1; i < num_samples; i++)
+    {
+        for (size_t j = i; j > 0 && samples[j - 1].counts > samples[j].counts; j--)
+        {
+            uint8_t counts = samples[j].counts;
+            float gain = samples[j].gain;
+            samples[j] = samples[j - 1];
+            samples[j - 1].counts = counts;
+            samples[j - 1].gain = gain;
+        }
+    }
+
+    /* Linear between samples, flat beyond them */
+    float prev_output = 0;
+    for (size_t k = 0; k < ACCEL_NUM_KNOTS; k++)
+    {
+        float v = knot_speeds[k];
+        float gain = samples[num_samples - 1].gain;
+        size_t i = 0;
+
+        while (i < num_samples && samples[i].counts < v)
+        {
+            i++;
+        }
+        if (i == 0)
+        {
+            gain = samples[0].gain;
+        }
+        else if (i < num_samples)
+        {
+            float f = (v - samples[i - 1].counts) / (samples[i].counts - samples[i - 1].counts);
+            gain = samples[i - 1].gain + f * (samples[i].gain - samples[i - 1].gain);
+        }
+
+        /* Bigger reports never move less, or the inverse would be ambiguous */
+        if (v * gain < prev_output)
+        {
+            gain = prev_output / v;
+        }
+        prev_output = v * gain;
+
+        float fixed = roundf(gain * ACCEL_GAIN_ONE);
+        fitted.gain[k] = fixed < 1 ? 1 : fixed > UINT16_MAX ? UINT16_MAX : fixed;
+    }
+
+    portENTER_CRITICAL(&accel_lock);
+    curve = fitted;
+    strcpy(key, peer_key);
+    portEXIT_CRITICAL(&accel_lock);
+
+    if (key[0] == '\0')
+    {
+        ESP_LOGW(TAG, "No bonded host connected, curve is used but not stored");
+        return ESP_OK;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(ACCEL_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    ret = nvs_set_blob(handle, key, fitted.gain, sizeof(fitted.gain));
+    if (ret == ESP_OK)
+    {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t accel_forget(void)
+{
+    char key[sizeof(peer_key)];
+
+    portENTER_CRITICAL(&accel_lock);
+    strcpy(key, peer_key);
+    curve.valid = false;
+    portEXIT_CRITICAL(&accel_lock);
+
+    if (key[0] == '\0')
+    {
+        return ESP_OK;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(ACCEL_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    ret = nvs_erase_key(handle, key);
+    if (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND)
+    {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+void accel_dump(FILE *stream)
+{
+    accel_curve_t c;
+    char key[sizeof(peer_key)];
+
+    portENTER_CRITICAL(&accel_lock);
+    c = curve;
+    strcpy(key, peer_key);
+    portEXIT_CRITICAL(&accel_lock);
+
+    fprintf(stream, "Host %s, %s\n", key[0] != '\0' ? key : "none", c.valid ? "calibrated" : "not calibrated");
+    if (c.valid)
+    {
+        for (size_t k = 0; k < ACCEL_NUM_KNOTS; k++)
+        {
+            fprintf(stream, "  %3u counts -> %.2f pixels per count\n", knot_speeds[k],
+                    (float)c.gain[k] / ACCEL_GAIN_ONE);
+        }
+    }
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        fprintf(stream, "  sample: %3u counts -> %.2f pixels per count\n", samples[i].counts, samples[i].gain);
+    }
+}
+
+static float curve_gain(const accel_curve_t *c, float v)
+{
+    if (v <= knot_speeds[0])
+    {
+        return (float)c->gain[0] / ACCEL_GAIN_ONE;
+    }
+
+    size_t k = 1;
+    while (k < ACCEL_NUM_KNOTS - 1 && knot_speeds[k] < v)
+    {
+        k++;
+    }
+    float f = (v - knot_speeds[k - 1]) / (knot_speeds[k] - knot_speeds[k - 1]);
+    f = f > 1 ? 1 : f;
+    return (c->gain[k - 1] + f * (c->gain[k] - c->gain[k - 1])) / ACCEL_GAIN_ONE;
+}
+
+/* Report size that moves pixels far; v * gain(v) rises with v, so bisect */
+static float curve_inverse(const accel_curve_t *c, float pixels)
+{
+    float lo = 0;
+    float hi = 127;
+
+    if (hi * curve_gain(c, hi) <= pixels)
+    {
+        return hi;
+    }
+    for (int i = 0; i < 20; i++)
+    {
+        float mid = (lo + hi) / 2;
+        if (mid * curve_gain(c, mid) < pixels)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+static int8_t clamp_counts(float counts)
+{
+    long rounded = lroundf(counts);
+    return rounded > 127 ? 127 : rounded < -127 ? -127 : rounded;
+}
+
+void accel_comp_init(accel_comp_t *comp)
+{
+    memset(comp, 0, sizeof(*comp));
+    portENTER_CRITICAL(&accel_lock);
+    comp->curve = curve;
+    portEXIT_CRITICAL(&accel_lock);
+}
+
+void accel_compensate(accel_comp_t *comp, float px, float py, int8_t *cx, int8_t *cy)
+{
+    px += comp->residual_x;
+    py += comp->residual_y;
+
+    float pixels = hypotf(px, py);
+    if (!comp->curve.valid || pixels == 0)
+    {
+        *cx = clamp_counts(px);
+        *cy = clamp_counts(py);
+        comp->residual_x = px - *cx;
+        comp->residual_y = py - *cy;
+        return;
+    }
+
+    /* Hosts accelerate on the speed of the whole vector, so scale both axes alike */
+    float scale = curve_inverse(&comp->curve, pixels) / pixels;
+    *cx = clamp_counts(px * scale);
+    *cy = clamp_counts(py * scale);
+
+    float gain = curve_gain(&comp->curve, hypotf(*cx, *cy));
+    comp->residual_x = px - *cx * gain;
+    comp->residual_y = py - *cy * gain;
+}
@@ -0,0 +1,73 @@
+#ifndef ACCEL_H
+#define ACCEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+/*
+    Host pointer acceleration compensation. A host turns a report of v counts into about
+    v * gain(v) pixels, with gain rising with speed. The curve is sampled at fixed report
+    sizes and fitted from measurements the host makes: 'accel probe' sends a known number of
+    equal reports, the host reports how far the pointer went, and 'accel fit' turns the
+    samples into a curve that is stored in NVS under the bonded host's identity address and
+    loaded whenever that host connects.
+
+    Only paths moved with script_move() are compensated; 'm' and input frames stay raw.
+*/
+
+#define ACCEL_NUM_KNOTS     8
+#define ACCEL_MAX_SAMPLES   16
+
+/* Reports sent by 'accel probe' unless told otherwise */
+#define ACCEL_PROBE_REPORTS 20
+
+/* Report sizes at which the curve is sampled */
+#define ACCEL_KNOT_SPEEDS   {1, 2, 4, 8, 16, 32, 64, 127}
+
+typedef struct
+{
+    bool valid;                         /* false: the host is assumed not to accelerate */
+    uint16_t gain[ACCEL_NUM_KNOTS];     /* pixels per count at each knot speed, 8.8 fixed point */
+} accel_curve_t;
+
+/* Turns pixel deltas into report deltas for one move, see accel_compensate() */
+typedef struct
+{
+    accel_curve_t curve;
+    float residual_x;                   /* pixels asked for but not yet produced */
+    float residual_y;
+} accel_comp_t;
+
+/* Called on encryption with the host's identity address, and on disconnect */
+void accel_set_peer(const uint8_t *bda);
+void accel_clear_peer(void);
+
+/* Forgets the curves of all hosts, e.g. when the bonds are deleted */
+void accel_forget_all(void);
+
+/* Records a measurement: reports of counts each moved the pointer pixels in total */
+esp_err_t accel_add_sample(uint8_t counts, uint32_t reports, uint32_t pixels);
+void accel_clear_samples(void);
+
+/* Fits the curve to the samples, uses it and stores it for the connected host */
+esp_err_t accel_fit(void);
+
+/* Drops the connected host's curve */
+esp_err_t accel_forget(void);
+
+void accel_dump(FILE *stream);
+
+/* Takes a snapshot of the current curve */
+void accel_comp_init(accel_comp_t *comp);
+
+/*
+    Report deltas expected to move the pointer by px, py pixels at one report per connection
+    interval. Whatever the rounding or the int8 range leave over, as predicted by the curve,
+    is carried into the next call.
+*/
+void accel_compensate(accel_comp_t *comp, float px, float py, int8_t *cx, int8_t *cy);
+
+#endif
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hidd_prf_api.h"
+#include "sdkconfig.h"
+
+#if CONFIG_KBM_BATTERY_MONITOR
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#endif
+
+#include "battery.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_BATTERY"
+
+#if CONFIG_KBM_BATTERY_MONITOR
+
+/* Reference voltage used when eFuse holds no calibration */
+#define BATTERY_DEFAULT_VREF_MV 1100
+
+/* Each measurement moves the estimate by 1/2^BATTERY_SMOOTHING_SHIFT of the difference */
+#define BATTERY_SMOOTHING_SHIFT 2
+
+/* How far past a step boundary the estimate must be before the reported level moves */
+#define BATTERY_HYSTERESIS_PCT 1
+
+typedef struct
+{
+    uint16_t mv;
+    uint8_t level;
+} battery_curve_point_t;
+
+/* Single-cell LiPo at light load, highest voltage first */
+static const battery_curve_point_t battery_curve[] = {
+    {4200, 100},
+    {4100, 90},
+    {4000, 78},
+    {3900, 63},
+    {3800, 46},
+    {3700, 28},
+    {3600, 12},
+    {3500, 4},
+    {3300, 0},
+};
+
+static portMUX_TYPE battery_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t battery_timer;
+static esp_adc_cal_characteristics_t adc_chars;
+static battery_status_t battery_status;
+
+#endif
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+#if CONFIG_KBM_BATTERY_MONITOR
+static void battery_tick(void *arg);
+static uint8_t battery_mv_to_level(uint32_t mv);
+static bool battery_crossed_step(uint8_t level, uint8_t reported);
+#endif
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+#if CONFIG_KBM_BATTERY_MONITOR
+
+esp_err_t battery_init(void)
+{
+    ESP_ERROR_CHECK(adc1_config_width(ADC_WIDTH_BIT_12));
+    ESP_ERROR_CHECK(adc1_config_channel_atten(CONFIG_KBM_BATTERY_ADC_CHANNEL, ADC_ATTEN_DB_11));
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, BATTERY_DEFAULT_VREF_MV,
+                             &adc_chars);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &battery_tick,
+        .name = "battery"};
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &battery_timer));
+
+    /* First reading right away so the level is real before the host reads it */
+    battery_sample();
+    return esp_timer_start_periodic(battery_timer, (uint64_t)CONFIG_KBM_BATTERY_PERIOD_S * 1000000);
+}
+
+void battery_sample(void)
+{
+    uint32_t raw = 0;
+    for (int i = 0; i < CONFIG_KBM_BATTERY_OVERSAMPLE; i++)
+    {
+        raw += adc1_get_raw(CONFIG_KBM_BATTERY_ADC_CHANNEL);
+    }
+    uint32_t mv = esp_adc_cal_raw_to_voltage(raw / CONFIG_KBM_BATTERY_OVERSAMPLE, &adc_chars) *
+                  CONFIG_KBM_BATTERY_DIVIDER;
+
+    bool notify = false;
+    uint8_t level;
+
+    portENTER_CRITICAL(&battery_lock);
+    if (battery_status.samples == 0)
+    {
+        battery_status.estimate_mv = mv;
+    }
+    else
+    {
+        int32_t diff = (int32_t)mv - (int32_t)battery_status.estimate_mv;
+        battery_status.estimate_mv += diff / (1 << BATTERY_SMOOTHING_SHIFT);
+    }
+    battery_status.samples++;
+    battery_status.raw_mv = mv;
+    battery_status.level = battery_mv_to_level(battery_status.estimate_mv);
+
+    level = battery_status.level;
+    if (battery_status.samples == 1 || battery_crossed_step(level, battery_status.reported))
+    {
+        /* Report the step the estimate is in, so small wobbles do not reach the host */
+        level = (level + CONFIG_KBM_BATTERY_STEP / 2) / CONFIG_KBM_BATTERY_STEP * CONFIG_KBM_BATTERY_STEP;
+        level = level > 100 ? 100 : level;
+        notify = level != battery_status.reported || battery_status.samples == 1;
+        battery_status.reported = level;
+        battery_status.notifications += notify;
+    }
+    portEXIT_CRITICAL(&battery_lock);
+
+    if (notify)
+    {
+        ESP_LOGI(TAG, "Battery %u mV, level %u%%", mv, level);
+        esp_hidd_set_battery_level(level);
+    }
+}
+
+void battery_get_status(battery_status_t *status)
+{
+    portENTER_CRITICAL(&battery_lock);
+    *status = battery_status;
+    portEXIT_CRITICAL(&battery_lock);
+}
+
+/* Runs on the esp_timer task, never on the input path */
+static void battery_tick(void *arg)
+{
+    battery_sample();
+}
+
+static uint8_t battery_mv_to_level(uint32_t mv)
+{
+    const size_t n = sizeof(battery_curve) / sizeof(battery_curve[0]);
+
+    if (mv >= battery_curve[0].mv)
+    {
+        return battery_curve[0].level;
+    }
+    for (size_t i = 1; i < n; i++)
+    {
+        if (mv >= battery_curve[i].mv)
+        {
+            const battery_curve_point_t *hi = &battery_curve[i - 1];
+            const battery_curve_point_t *lo = &battery_curve[i];
+            return lo->level + (mv - lo->mv) * (hi->level - lo->level) / (hi->mv - lo->mv);
+        }
+    }
+    return 0;
+}
+
+static bool battery_crossed_step(uint8_t level, uint8_t reported)
+{
+    int margin = CONFIG_KBM_BATTERY_STEP / 2 + BATTERY_HYSTERESIS_PCT;
+
+    return level >= reported + margin || level + margin <= reported;
+}
+
+#else
+
+esp_err_t battery_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void battery_sample(void)
+{
+}
+
+void battery_get_status(battery_status_t *status)
+{
+    *status = (battery_status_t){0};
+}
+
+#endif
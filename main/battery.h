@@ -0,0 +1,32 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+typedef struct
+{
+    uint32_t samples;       /* measurements taken since boot */
+    uint32_t raw_mv;        /* battery voltage of the last measurement */
+    uint32_t estimate_mv;   /* smoothed battery voltage */
+    uint8_t level;          /* estimated charge, 0-100 % */
+    uint8_t reported;       /* level last written to the Battery Service */
+    uint32_t notifications; /* reported level changes */
+} battery_status_t;
+
+/*
+    Samples the battery divider on a periodic esp_timer, KBM_BATTERY_PERIOD_S apart, so no
+    task or PM lock is held between measurements. Each measurement averages
+    KBM_BATTERY_OVERSAMPLE ADC readings and feeds a moving average; the Battery Service
+    is only updated when the estimate moves past a KBM_BATTERY_STEP boundary.
+*/
+esp_err_t battery_init(void);
+
+/* Takes a measurement now, on the calling task */
+void battery_sample(void);
+
+void battery_get_status(battery_status_t *status);
+
+#endif
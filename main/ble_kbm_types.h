@@ -16,4 +16,40 @@ typedef struct
     int8_t movement_y;
 } mouse_t;
 
+typedef struct
+{
+    uint8_t usage;          /* HID_CONSUMER_* */
+    uint8_t pressed;
+} consumer_t;
+
+#define GAMEPAD_NUM_AXES 6
+
+typedef struct
+{
+    uint32_t buttons;
+    uint8_t hat;
+    int16_t axes[GAMEPAD_NUM_AXES];
+} gamepad_t;
+
+typedef enum
+{
+    INPUT_EVENT_KEYBOARD,       /* key tap, pressed and released */
+    INPUT_EVENT_MOUSE,
+    INPUT_EVENT_KEY_REPORT,     /* keyboard report sent as is, keys stay down until the next one */
+    INPUT_EVENT_CONSUMER,
+} input_event_type_t;
+
+/* One entry of an input ring, see input_ring.h */
+typedef struct
+{
+    uint32_t timestamp_us;  /* low 32 bits of esp_timer_get_time(), stamped on push */
+    uint8_t type;
+    union
+    {
+        keyboard_t keyboard;
+        mouse_t mouse;
+        consumer_t consumer;
+    };
+} input_event_t;
+
 #endif
\ No newline at end of file
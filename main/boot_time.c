@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#include "boot_time.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_BOOT"
+
+static portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t marks[BOOT_MARK_NUM];
+
+static const char *mark_names[BOOT_MARK_NUM] = {
+    [BOOT_MARK_APP_MAIN] = "app_main",
+    [BOOT_MARK_NVS] = "nvs",
+    [BOOT_MARK_CONTROLLER] = "controller",
+    [BOOT_MARK_BLUEDROID] = "bluedroid",
+    [BOOT_MARK_CONSOLE] = "console",
+    [BOOT_MARK_GATT_REGISTERED] = "gatt registered",
+    [BOOT_MARK_ADV_DATA] = "adv data",
+    [BOOT_MARK_ADVERTISING] = "advertising",
+    [BOOT_MARK_HID_SERVICE] = "hid service",
+    [BOOT_MARK_CONNECTED] = "connected",
+    [BOOT_MARK_ENCRYPTED] = "encrypted",
+};
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void boot_time_mark(boot_mark_t mark)
+{
+    int64_t now = esp_timer_get_time();
+    bool first = false;
+
+    portENTER_CRITICAL(&boot_lock);
+    if (marks[mark] == 0)
+    {
+        marks[mark] = now;
+        first = true;
+    }
+    portEXIT_CRITICAL(&boot_lock);
+
+    if (first && (mark == BOOT_MARK_ADVERTISING || mark == BOOT_MARK_ENCRYPTED))
+    {
+        ESP_LOGI(TAG, "%s %lld ms after boot%s", mark_names[mark], now / 1000,
+                 esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED ? " (wake from sleep)" : "");
+    }
+}
+
+int64_t boot_time_get(boot_mark_t mark)
+{
+    return marks[mark];
+}
+
+void boot_time_print(void)
+{
+    int64_t prev = 0;
+
+    for (int i = 0; i < BOOT_MARK_NUM; i++)
+    {
+        if (marks[i] == 0)
+        {
+            printf("%-16s          -\n", mark_names[i]);
+            continue;
+        }
+        /* Marks from parallel tasks can land out of order; the delta is to the previous mark */
+        printf("%-16s %8lld us %+9lld us\n", mark_names[i], marks[i], marks[i] - prev);
+        prev = marks[i];
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+#include <stdint.h>
+
+/* Milestones of a boot, in the order they usually happen */
+typedef enum
+{
+    BOOT_MARK_APP_MAIN,
+    BOOT_MARK_NVS,
+    BOOT_MARK_CONTROLLER,
+    BOOT_MARK_BLUEDROID,
+    BOOT_MARK_CONSOLE,
+    BOOT_MARK_GATT_REGISTERED,
+    BOOT_MARK_ADV_DATA,
+    BOOT_MARK_HID_SERVICE,
+    BOOT_MARK_ADVERTISING,
+    BOOT_MARK_CONNECTED,
+    BOOT_MARK_ENCRYPTED,
+    BOOT_MARK_NUM
+} boot_mark_t;
+
+/*
+    Records the time since boot of a milestone. Only the first call per mark counts, so
+    marks on paths that repeat, such as reconnects, keep the boot value. Safe from any task.
+*/
+void boot_time_mark(boot_mark_t mark);
+
+/* Microseconds since boot at mark, 0 if it has not been reached */
+int64_t boot_time_get(boot_mark_t mark);
+
+void boot_time_print(void);
+
+#endif
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "capture.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_CAPTURE"
+
+#define CAPTURE_SIZE CONFIG_KBM_CAPTURE_SIZE
+
+/* Allocated on the first capture_start() and kept for replay */
+static input_event_t *events;
+/* Total events recorded; the ring holds the last CAPTURE_SIZE of them */
+static uint32_t recorded;
+static bool active;
+/* The HID task records while the console task stops */
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void reverse(input_event_t *first, input_event_t *last);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+esp_err_t capture_start(void)
+{
+    if (events == NULL)
+    {
+        events = malloc(CAPTURE_SIZE * sizeof(input_event_t));
+        if (events == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %u events", CAPTURE_SIZE);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    portENTER_CRITICAL(&capture_lock);
+    recorded = 0;
+    active = true;
+    portEXIT_CRITICAL(&capture_lock);
+    return ESP_OK;
+}
+
+void capture_record(const input_event_t *event)
+{
+    portENTER_CRITICAL(&capture_lock);
+    if (active)
+    {
+        events[recorded % CAPTURE_SIZE] = *event;
+        recorded++;
+    }
+    portEXIT_CRITICAL(&capture_lock);
+}
+
+static void reverse(input_event_t *first, input_event_t *last)
+{
+    while (first < --last)
+    {
+        input_event_t tmp = *first;
+        *first++ = *last;
+        *last = tmp;
+    }
+}
+
+void capture_stop(void)
+{
+    portENTER_CRITICAL(&capture_lock);
+    bool was_active = active;
+    active = false;
+    portEXIT_CRITICAL(&capture_lock);
+
+    if (!was_active || recorded <= CAPTURE_SIZE)
+    {
+        return;
+    }
+
+    /* Rotate the oldest event to the front in place */
+    size_t oldest = recorded % CAPTURE_SIZE;
+    reverse(events, events + oldest);
+    reverse(events + oldest, events + CAPTURE_SIZE);
+    reverse(events, events + CAPTURE_SIZE);
+}
+
+bool capture_active(void)
+{
+    return active;
+}
+
+size_t capture_get(const input_event_t **out)
+{
+    if (active || events == NULL)
+    {
+        *out = NULL;
+        return 0;
+    }
+    *out = events;
+    return recorded < CAPTURE_SIZE ? recorded : CAPTURE_SIZE;
+}
+
+uint32_t capture_overwritten(void)
+{
+    return recorded > CAPTURE_SIZE ? recorded - CAPTURE_SIZE : 0;
+}
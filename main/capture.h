@@ -0,0 +1,40 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "ble_kbm_types.h"
+
+/*
+    Records every input event the HID task dispatches, from the console, GATT input frames,
+    scripts and typed text, into a RAM ring of CONFIG_KBM_CAPTURE_SIZE events. Each keeps the
+    timestamp stamped when it entered its input ring, so replay reproduces the timing of the
+    original source rather than of the dispatcher. When the ring is full the oldest events
+    are overwritten.
+
+    A stopped capture can be replayed with script_replay(), printed, or saved to the macro
+    store as MACRO_TYPE_CAPTURE.
+*/
+
+/* Discards the previous capture and starts recording */
+esp_err_t capture_start(void);
+
+/* Stops recording and lays the events out oldest first */
+void capture_stop(void);
+
+bool capture_active(void);
+
+/* Called by the HID task for each event it dispatches */
+void capture_record(const input_event_t *event);
+
+/* Events of a stopped capture, oldest first; returns the count */
+size_t capture_get(const input_event_t **events);
+
+/* Events overwritten because the ring was full */
+uint32_t capture_overwritten(void);
+
+#endif
@@ -3,6 +3,5 @@
 
 #define DELETE_ALL_BONDINGS 1 << 0
 #define LIST_BONDINGS 1 << 1
-#define GET_LED 1 << 2
 
 #endif
\ No newline at end of file
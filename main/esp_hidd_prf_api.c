@@ -33,6 +33,12 @@
 // HID consumer control input report length
 #define HID_CC_IN_RPT_LEN 2
 
+// HID gamepad input report length (6 x 16-bit axes, hat nibble, 32 buttons)
+#define HID_GAMEPAD_IN_RPT_LEN (HID_GAMEPAD_NUM_AXES * 2 + 1 + 4)
+
+// HID touchpad input report length (2 x flags, X, Y; scan time; contact count and button)
+#define HID_TOUCHPAD_IN_RPT_LEN (HID_TOUCHPAD_CONTACTS_PER_REPORT * 5 + 2 + 1)
+
 esp_err_t esp_hidd_register_callbacks(esp_hidd_event_cb_t callbacks)
 {
     esp_err_t hidd_status;
@@ -51,8 +57,7 @@ esp_err_t esp_hidd_register_callbacks(esp_hidd_event_cb_t callbacks)
         return hidd_status;
     }
 
-    esp_ble_gatts_app_register(BATTRAY_APP_ID);
-
+    /* The battery table lives on the HID app; a separate battery app only cost a registration */
     if ((hidd_status = esp_ble_gatts_app_register(HIDD_APP_ID)) != ESP_OK)
     {
         return hidd_status;
@@ -71,6 +76,7 @@ esp_err_t esp_hidd_profile_init(void)
     // Reset the hid device target environment
     memset(&hidd_le_env, 0, sizeof(hidd_le_env_t));
     hidd_le_env.enabled = true;
+    hidd_le_env.touchpad_switch = 0x03;
     return ESP_OK;
 }
 
@@ -104,7 +110,7 @@ uint16_t esp_hidd_get_version(void)
     return HIDD_VERSION;
 }
 
-void esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pressed)
+esp_err_t esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pressed)
 {
     uint8_t buffer[HID_CC_IN_RPT_LEN] = {0, 0};
     if (key_pressed)
@@ -113,17 +119,16 @@ void esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pr
         hid_consumer_build_report(buffer, key_cmd);
     }
     ESP_LOGD(HID_LE_PRF_TAG, "buffer[0] = %x, buffer[1] = %x", buffer[0], buffer[1]);
-    hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+    return hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
                         HID_RPT_ID_CC_IN, HID_REPORT_TYPE_INPUT, HID_CC_IN_RPT_LEN, buffer);
-    return;
 }
 
-void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, uint8_t *keyboard_cmd, uint8_t num_key)
+esp_err_t esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, uint8_t *keyboard_cmd, uint8_t num_key)
 {
     if (num_key > HID_KEYBOARD_IN_RPT_LEN - 2)
     {
         ESP_LOGE(HID_LE_PRF_TAG, "%s(), the number key should not be more than %d", __func__, HID_KEYBOARD_IN_RPT_LEN);
-        return;
+        return ESP_ERR_INVALID_ARG;
     }
 
     uint8_t buffer[HID_KEYBOARD_IN_RPT_LEN] = {0};
@@ -136,12 +141,11 @@ void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask,
     }
 
     ESP_LOGD(HID_LE_PRF_TAG, "the key vaule = %d,%d,%d, %d, %d, %d,%d, %d", buffer[0], buffer[1], buffer[2], buffer[3], buffer[4], buffer[5], buffer[6], buffer[7]);
-    hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+    return hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
                         HID_RPT_ID_KEY_IN, HID_REPORT_TYPE_INPUT, HID_KEYBOARD_IN_RPT_LEN, buffer);
-    return;
 }
 
-void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y)
+esp_err_t esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y)
 {
     uint8_t buffer[HID_MOUSE_IN_RPT_LEN];
 
@@ -151,12 +155,136 @@ void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mi
     buffer[3] = 0;            // Wheel
     buffer[4] = 0;            // AC Pan
 
-    hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+    return hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
                         HID_RPT_ID_MOUSE_IN, HID_REPORT_TYPE_INPUT, HID_MOUSE_IN_RPT_LEN, buffer);
-    return;
+}
+
+esp_err_t esp_hidd_send_gamepad_value(uint16_t conn_id, uint32_t buttons, uint8_t hat, const int16_t *axes)
+{
+    uint8_t buffer[HID_GAMEPAD_IN_RPT_LEN];
+    uint8_t *p = buffer;
+
+    for (int i = 0; i < HID_GAMEPAD_NUM_AXES; i++)
+    {
+        *p++ = (uint8_t)(axes[i] & 0xFF);
+        *p++ = (uint8_t)((axes[i] >> 8) & 0xFF);
+    }
+    *p++ = hat & 0x0F;          // Hat switch, upper nibble is padding
+    *p++ = buttons & 0xFF;      // Buttons 1-8
+    *p++ = (buttons >> 8) & 0xFF;
+    *p++ = (buttons >> 16) & 0xFF;
+    *p++ = (buttons >> 24) & 0xFF;
+
+    return hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+                        HID_RPT_ID_GAMEPAD_IN, HID_REPORT_TYPE_INPUT, HID_GAMEPAD_IN_RPT_LEN, buffer);
+}
+
+esp_err_t esp_hidd_send_touchpad_value(uint16_t conn_id, const touch_contact_t *contacts, uint8_t num_contacts,
+                                       uint8_t contact_count, uint16_t scan_time, bool button)
+{
+    uint8_t buffer[HID_TOUCHPAD_IN_RPT_LEN] = {0};
+    uint8_t *p = buffer;
+
+    if (num_contacts > HID_TOUCHPAD_CONTACTS_PER_REPORT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < HID_TOUCHPAD_CONTACTS_PER_REPORT; i++)
+    {
+        if (i < num_contacts)
+        {
+            // Confidence, tip switch, contact ID in the upper six bits
+            *p++ = 0x01 | (contacts[i].tip ? 0x02 : 0) | (contacts[i].id << 2);
+            *p++ = contacts[i].x & 0xFF;
+            *p++ = (contacts[i].x >> 8) & 0xFF;
+            *p++ = contacts[i].y & 0xFF;
+            *p++ = (contacts[i].y >> 8) & 0xFF;
+        }
+        else
+        {
+            p += 5;
+        }
+    }
+    *p++ = scan_time & 0xFF;
+    *p++ = (scan_time >> 8) & 0xFF;
+    *p++ = (contact_count & 0x7F) | (button ? 0x80 : 0);
+
+    return hid_dev_send_report(hidd_le_env.gatt_if, conn_id,
+                        HID_RPT_ID_TOUCHPAD_IN, HID_REPORT_TYPE_INPUT, HID_TOUCHPAD_IN_RPT_LEN, buffer);
+}
+
+uint8_t esp_hidd_get_touchpad_mode(void)
+{
+    return hidd_le_env.touchpad_mode;
 }
 
 uint8_t esp_hidd_get_led_value()
 {
     return hid_dev_get_leds();
 }
+
+esp_err_t esp_hidd_get_conn_info(uint16_t conn_id, esp_hidd_conn_info_t *info)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    if (p_clcb == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    info->mtu = p_clcb->mtu;
+    info->tx_octets = p_clcb->tx_octets;
+    info->rx_octets = p_clcb->rx_octets;
+    info->proto_mode = p_clcb->proto_mode;
+    info->tx_phy = p_clcb->tx_phy;
+    info->rx_phy = p_clcb->rx_phy;
+    info->suspended = p_clcb->suspended;
+    return ESP_OK;
+}
+
+uint16_t esp_hidd_get_max_payload(uint16_t conn_id)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+    uint16_t mtu = p_clcb != NULL ? p_clcb->mtu : HIDD_DEFAULT_MTU;
+
+    return mtu - 3;
+}
+
+void esp_hidd_set_data_len(uint16_t tx_octets, uint16_t rx_octets)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(hidd_le_env.dle_conn_id);
+
+    if (p_clcb != NULL)
+    {
+        p_clcb->tx_octets = tx_octets;
+        p_clcb->rx_octets = rx_octets;
+    }
+}
+
+void esp_hidd_set_phy(esp_bd_addr_t bda, uint8_t tx_phy, uint8_t rx_phy)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find_by_bda(bda);
+
+    if (p_clcb != NULL)
+    {
+        p_clcb->tx_phy = tx_phy;
+        p_clcb->rx_phy = rx_phy;
+    }
+}
+
+esp_err_t esp_hidd_set_battery_level(uint8_t level)
+{
+    if (level > 100)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    hidd_set_battery_level(level);
+    return ESP_OK;
+}
+
+void esp_hidd_input_frame_dropped(uint16_t conn_id, uint16_t seq)
+{
+    hidd_input_frame_dropped(conn_id, seq);
+}
@@ -19,6 +19,9 @@
 #include "esp_gatt_defs.h"
 #include "esp_err.h"
 
+#include "hid_codes.h"
+#include "touch_gesture.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,7 +33,10 @@ typedef enum {
     ESP_HIDD_EVENT_BLE_CONNECT,                         
     ESP_HIDD_EVENT_BLE_DISCONNECT,
     ESP_HIDD_EVENT_BLE_VENDOR_REPORT_WRITE_EVT,
-    ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT
+    ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT,
+    ESP_HIDD_EVENT_BLE_INPUT_FRAME_WRITE_EVT,
+    ESP_HIDD_EVENT_BLE_SERVICE_STARTED,                 /* HID service is in the database, safe to advertise */
+    ESP_HIDD_EVENT_BLE_SUSPEND,                         /* Host wrote Suspend or Exit Suspend to the Control Point */
 } esp_hidd_cb_event_t;
 
 /// HID config status
@@ -51,16 +57,24 @@ typedef enum {
     ESP_HIDD_DEINIT_FAILED = 0,
 } esp_hidd_deinit_state_t;
 
-#define LEFT_CONTROL_KEY_MASK        (1 << 0)
-#define LEFT_SHIFT_KEY_MASK          (1 << 1)
-#define LEFT_ALT_KEY_MASK            (1 << 2)
-#define LEFT_GUI_KEY_MASK            (1 << 3)
-#define RIGHT_CONTROL_KEY_MASK       (1 << 4)
-#define RIGHT_SHIFT_KEY_MASK         (1 << 5)
-#define RIGHT_ALT_KEY_MASK           (1 << 6)
-#define RIGHT_GUI_KEY_MASK           (1 << 7)
+#define HID_GAMEPAD_NUM_AXES         6
+#define HID_GAMEPAD_HAT_CENTERED     8
+#define HID_TOUCHPAD_CONTACTS_PER_REPORT 2
+#define HID_TOUCHPAD_MODE_MOUSE      0
+#define HID_TOUCHPAD_MODE_TOUCHPAD   3
+/**
+ * @brief Link parameters negotiated on a connection
+ */
+typedef struct {
+    uint16_t mtu;                                   /*!< ATT MTU */
+    uint16_t tx_octets;                             /*!< LL payload per packet, device to host */
+    uint16_t rx_octets;                             /*!< LL payload per packet, host to device */
+    uint8_t  proto_mode;                            /*!< HID protocol mode, boot or report */
+    uint8_t  tx_phy;                                /*!< PHY device to host, 1 = 1M, 2 = 2M, 3 = Coded */
+    uint8_t  rx_phy;                                /*!< PHY host to device */
+    bool     suspended;                             /*!< Host wrote Suspend to the HID Control Point */
+} esp_hidd_conn_info_t;
 
-typedef uint8_t key_mask_t;
 /**
  * @brief HIDD callback parameters union 
  */
@@ -115,6 +129,24 @@ typedef union {
         uint8_t  *data;                             /*!< The pointer to the data */
     } led_write;	                                /*!< HID callback param of ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT */
 
+    /**
+     * @brief ESP_HIDD_EVENT_BLE_INPUT_FRAME_WRITE_EVT
+	 */
+    struct hidd_input_frame_evt_param {
+        uint16_t conn_id;                           /*!< HID connection index */
+        uint16_t seq;                               /*!< Frames written before this one on the connection */
+        uint16_t length;                            /*!< data length */
+        uint8_t  *data;                             /*!< The pointer to the frame */
+    } input_frame;                                  /*!< HID callback param of ESP_HIDD_EVENT_BLE_INPUT_FRAME_WRITE_EVT */
+
+    /**
+     * @brief ESP_HIDD_EVENT_BLE_SUSPEND
+	 */
+    struct hidd_suspend_evt_param {
+        uint16_t conn_id;                           /*!< HID connection index */
+        bool     suspended;                         /*!< true on Suspend, false on Exit Suspend */
+    } suspend;                                      /*!< HID callback param of ESP_HIDD_EVENT_BLE_SUSPEND */
+
 } esp_hidd_cb_param_t;
 
 
@@ -165,14 +197,82 @@ esp_err_t esp_hidd_profile_deinit(void);
  */
 uint16_t esp_hidd_get_version(void);
 
-void esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pressed);
+esp_err_t esp_hidd_send_consumer_value(uint16_t conn_id, uint8_t key_cmd, bool key_pressed);
+
+esp_err_t esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, uint8_t *keyboard_cmd, uint8_t num_key);
 
-void esp_hidd_send_keyboard_value(uint16_t conn_id, key_mask_t special_key_mask, uint8_t *keyboard_cmd, uint8_t num_key);
+esp_err_t esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y);
 
-void esp_hidd_send_mouse_value(uint16_t conn_id, uint8_t mouse_button, int8_t mickeys_x, int8_t mickeys_y);
+esp_err_t esp_hidd_send_gamepad_value(uint16_t conn_id, uint32_t buttons, uint8_t hat, const int16_t *axes);
+
+/**
+ *
+ * @brief           Send one Precision Touchpad input report
+ *
+ * @param[in]       contacts - up to HID_TOUCHPAD_CONTACTS_PER_REPORT contacts; unused slots are sent empty
+ * @param[in]       contact_count - contacts in the whole frame in its first report, 0 in the rest
+ * @param[in]       scan_time - frame time in 100 us units, the same for every report of a frame
+ *
+ */
+esp_err_t esp_hidd_send_touchpad_value(uint16_t conn_id, const touch_contact_t *contacts, uint8_t num_contacts,
+                                       uint8_t contact_count, uint16_t scan_time, bool button);
+
+/* Input mode the host last selected, HID_TOUCHPAD_MODE_TOUCHPAD once it treats us as a touchpad */
+uint8_t esp_hidd_get_touchpad_mode(void);
 
 uint8_t esp_hidd_get_led_value();
 
+/**
+ *
+ * @brief           Get the link parameters negotiated on a connection
+ *
+ * @return          ESP_OK - success, ESP_ERR_NOT_FOUND - no such connection
+ *
+ */
+esp_err_t esp_hidd_get_conn_info(uint16_t conn_id, esp_hidd_conn_info_t *info);
+
+/**
+ *
+ * @brief           Largest value a single notification or write can carry on a connection,
+ *                  ATT MTU less the 3-byte ATT header. Batching layers size their frames to this.
+ *
+ */
+uint16_t esp_hidd_get_max_payload(uint16_t conn_id);
+
+/**
+ *
+ * @brief           Record the result of the data length request made on connect. Call from
+ *                  ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT.
+ *
+ */
+void esp_hidd_set_data_len(uint16_t tx_octets, uint16_t rx_octets);
+
+/**
+ *
+ * @brief           Record the PHY in use on the connection to bda. Call from
+ *                  ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT.
+ *
+ */
+void esp_hidd_set_phy(esp_bd_addr_t bda, uint8_t tx_phy, uint8_t rx_phy);
+
+/**
+ *
+ * @brief           Update the Battery Level characteristic and notify every connection that
+ *                  enabled notifications. Callers decide when a change is worth a notification.
+ *
+ * @return          ESP_OK - success, ESP_ERR_INVALID_ARG - level above 100
+ *
+ */
+esp_err_t esp_hidd_set_battery_level(uint8_t level);
+
+/**
+ *
+ * @brief           Tell the central on conn_id that frame seq of ESP_HIDD_EVENT_BLE_INPUT_FRAME_WRITE_EVT
+ *                  was dropped, through the Frame Status characteristic of the input service.
+ *
+ */
+void esp_hidd_input_frame_dropped(uint16_t conn_id, uint16_t seq);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,164 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hidd_prf_api.h"
+#include <string.h>
+
+#include "ble_kbm_types.h"
+#include "gamepad_stream.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_GAMEPAD"
+
+/* 1.25 ms per connection interval unit */
+#define CONN_INT_TO_US(x) ((uint64_t)(x) * 1250)
+
+static portMUX_TYPE stream_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t stream_timer;
+
+static gamepad_t pending;
+static uint32_t latched_buttons;
+static bool dirty = false;
+
+static bool streaming = false;
+static bool suspended = false;
+static bool armed = false;      /* timer running, or about to be started by whoever set this */
+static uint16_t stream_conn_id = 0;
+static uint16_t stream_conn_int = GAMEPAD_STREAM_DEFAULT_CONN_INT;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void gamepad_stream_arm(void);
+static void gamepad_stream_disarm(void);
+static void gamepad_stream_tick(void *arg);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void gamepad_stream_init(void)
+{
+    memset(&pending, 0, sizeof(pending));
+    pending.hat = HID_GAMEPAD_HAT_CENTERED;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &gamepad_stream_tick,
+        .name = "gamepad_stream"};
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &stream_timer));
+}
+
+void gamepad_stream_update(const gamepad_t *sample)
+{
+    portENTER_CRITICAL(&stream_lock);
+    latched_buttons |= sample->buttons & ~pending.buttons;
+    pending = *sample;
+    dirty = true;
+    portEXIT_CRITICAL(&stream_lock);
+
+    gamepad_stream_arm();
+}
+
+/*
+    The timer only runs while there is something to send, so an idle link leaves the CPU
+    free to light sleep between connection events.
+*/
+static void gamepad_stream_arm(void)
+{
+    bool arm;
+
+    portENTER_CRITICAL(&stream_lock);
+    arm = streaming && !suspended && dirty && !armed;
+    armed = armed || arm;
+    portEXIT_CRITICAL(&stream_lock);
+
+    if (arm)
+    {
+        esp_err_t ret = esp_timer_start_periodic(stream_timer, CONN_INT_TO_US(stream_conn_int));
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+        {
+            ESP_LOGE(TAG, "Stream timer not started: %s", esp_err_to_name(ret));
+            portENTER_CRITICAL(&stream_lock);
+            armed = false;
+            portEXIT_CRITICAL(&stream_lock);
+        }
+    }
+}
+
+/* Stops the timer, then rearms it if a sample came in meanwhile and streaming is still allowed */
+static void gamepad_stream_disarm(void)
+{
+    esp_timer_stop(stream_timer);
+
+    portENTER_CRITICAL(&stream_lock);
+    armed = false;
+    portEXIT_CRITICAL(&stream_lock);
+
+    gamepad_stream_arm();
+}
+
+void gamepad_stream_start(uint16_t conn_id)
+{
+    stream_conn_id = conn_id;
+    streaming = true;
+    suspended = false;
+
+    gamepad_stream_disarm();
+    ESP_LOGI(TAG, "Streaming every %u us while input changes", (uint32_t)CONN_INT_TO_US(stream_conn_int));
+}
+
+void gamepad_stream_stop(void)
+{
+    streaming = false;
+    gamepad_stream_disarm();
+}
+
+void gamepad_stream_suspend(bool suspend)
+{
+    suspended = suspend;
+    /* Samples keep merging while the host sleeps; the latest state goes out on resume */
+    gamepad_stream_disarm();
+}
+
+void gamepad_stream_set_interval(uint16_t conn_int)
+{
+    if (conn_int == 0 || conn_int == stream_conn_int)
+    {
+        return;
+    }
+
+    stream_conn_int = conn_int;
+    if (streaming)
+    {
+        gamepad_stream_start(stream_conn_id);
+    }
+}
+
+/* Runs once per connection interval while armed; sends at most one merged report */
+static void gamepad_stream_tick(void *arg)
+{
+    gamepad_t report;
+
+    portENTER_CRITICAL(&stream_lock);
+    if (!dirty)
+    {
+        portEXIT_CRITICAL(&stream_lock);
+        gamepad_stream_disarm();
+        return;
+    }
+    report = pending;
+    report.buttons |= latched_buttons;
+    /* A latched tap still needs its release to go out on the next tick */
+    dirty = (latched_buttons & ~pending.buttons) != 0;
+    latched_buttons = 0;
+    portEXIT_CRITICAL(&stream_lock);
+
+    esp_hidd_send_gamepad_value(stream_conn_id, report.buttons, report.hat, report.axes);
+}
@@ -0,0 +1,30 @@
+#ifndef GAMEPAD_STREAM_H
+#define GAMEPAD_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ble_kbm_types.h"
+
+/* Default connection interval used until the central reports its own, in 1.25 ms units */
+#define GAMEPAD_STREAM_DEFAULT_CONN_INT 0x10
+
+void gamepad_stream_init(void);
+
+/*
+    Producers call this as often as they like. Samples are merged into one pending state:
+    axes and hat take the latest value, button presses are latched until they have been
+    sent at least once so a short tap between two connection events is not lost.
+*/
+void gamepad_stream_update(const gamepad_t *sample);
+
+void gamepad_stream_start(uint16_t conn_id);
+void gamepad_stream_stop(void);
+
+/* Host wrote Suspend (true) or Exit Suspend (false) to the HID Control Point */
+void gamepad_stream_suspend(bool suspend);
+
+/* conn_int in 1.25 ms units, as reported by ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT */
+void gamepad_stream_set_interval(uint16_t conn_int);
+
+#endif
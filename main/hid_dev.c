@@ -13,66 +13,97 @@
 // limitations under the License.
 
 #include "hid_dev.h"
+#include "hid_stats.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "esp_log.h"
 
+// HID keyboard boot report length
+#define HID_BOOT_KB_IN_RPT_LEN      8
+// HID mouse boot report length (buttons, X, Y)
+#define HID_BOOT_MOUSE_IN_RPT_LEN   3
+
+// Highest report ID in use, sizes the lookup index
+#define HID_DEV_RPT_ID_MAX          HID_RPT_ID_TOUCHPAD_CERT
+
 static hid_report_map_t *hid_dev_rpt_tbl;
 static uint8_t hid_dev_rpt_tbl_Len;
 
-static hid_report_map_t *hid_dev_rpt_by_id(uint8_t id, uint8_t type)
-{
-    hid_report_map_t *rpt = hid_dev_rpt_tbl;
+// Direct lookup [protocol mode][report id][report type], built once on registration
+static hid_report_map_t *hid_dev_rpt_idx[HID_PROTOCOL_MODE_REPORT + 1][HID_DEV_RPT_ID_MAX + 1][HID_REPORT_TYPE_FEATURE + 1];
 
-    for (uint8_t i = hid_dev_rpt_tbl_Len; i > 0; i--, rpt++)
+static hid_report_map_t *hid_dev_rpt_by_id(uint8_t id, uint8_t type, uint8_t mode)
+{
+    if (mode > HID_PROTOCOL_MODE_REPORT || id > HID_DEV_RPT_ID_MAX || type > HID_REPORT_TYPE_FEATURE)
     {
-        if (rpt->id == id && rpt->type == type && rpt->mode == hidProtocolMode)
-        {
-            return rpt;
-        }
+        return NULL;
     }
 
-    return NULL;
+    return hid_dev_rpt_idx[mode][id][type];
 }
 
-static hid_report_map_t *hid_dev_boot_rpt_by_id(uint8_t id, uint8_t type)
+void hid_dev_register_reports(uint8_t num_reports, hid_report_map_t *p_report)
 {
-    hid_report_map_t *rpt = hid_dev_rpt_tbl;
+    hid_dev_rpt_tbl = p_report;
+    hid_dev_rpt_tbl_Len = num_reports;
 
-    for (uint8_t i = hid_dev_rpt_tbl_Len; i > 0; i--, rpt++)
+    memset(hid_dev_rpt_idx, 0, sizeof(hid_dev_rpt_idx));
+    for (uint8_t i = 0; i < num_reports; i++, p_report++)
     {
-        if (rpt->id == id && rpt->type == type && rpt->mode == hidBootMode)
+        if (p_report->handle == 0 || p_report->mode > HID_PROTOCOL_MODE_REPORT ||
+            p_report->id > HID_DEV_RPT_ID_MAX || p_report->type > HID_REPORT_TYPE_FEATURE)
         {
-            return rpt;
+            continue;
         }
+        hid_dev_rpt_idx[p_report->mode][p_report->id][p_report->type] = p_report;
     }
-
-    return NULL;
-}
-
-void hid_dev_register_reports(uint8_t num_reports, hid_report_map_t *p_report)
-{
-    hid_dev_rpt_tbl = p_report;
-    hid_dev_rpt_tbl_Len = num_reports;
     return;
 }
 
-void hid_dev_send_report(esp_gatt_if_t gatts_if, uint16_t conn_id,
+esp_err_t hid_dev_send_report(esp_gatt_if_t gatts_if, uint16_t conn_id,
                          uint8_t id, uint8_t type, uint8_t length, uint8_t *data)
 {
     hid_report_map_t *p_rpt;
+    uint8_t mode = hidd_clcb_proto_mode(conn_id);
+
+    if (mode == HID_PROTOCOL_MODE_BOOT)
+    {
+        // Boot hosts only understand the fixed keyboard and mouse formats
+        if (id == HID_RPT_ID_KEY_IN && length >= HID_BOOT_KB_IN_RPT_LEN)
+        {
+            length = HID_BOOT_KB_IN_RPT_LEN;
+        }
+        else if (id == HID_RPT_ID_MOUSE_IN && length >= HID_BOOT_MOUSE_IN_RPT_LEN)
+        {
+            length = HID_BOOT_MOUSE_IN_RPT_LEN;
+        }
+        else
+        {
+            ESP_LOGD(HID_LE_PRF_TAG, "%s(), report %d has no boot equivalent, dropped", __func__, id);
+            hid_stats_inc(HID_STAT_BOOT_DROP);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
 
     // get att handle for report
-    if ((p_rpt = hid_dev_rpt_by_id(id, type)) != NULL)
+    if ((p_rpt = hid_dev_rpt_by_id(id, type, mode)) != NULL)
     {
-        // if notifications are enabled
+        // The host would drop it anyway; skip the air time
+        if (hidd_clcb_notify_off(conn_id, p_rpt - hid_dev_rpt_tbl))
+        {
+            hid_stats_inc(HID_STAT_NOTIFY_OFF_DROP);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
         ESP_LOGD(HID_LE_PRF_TAG, "%s(), send the report, handle = %d", __func__, p_rpt->handle);
-        esp_ble_gatts_send_indicate(gatts_if, conn_id, p_rpt->handle, length, data, false);
+        esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, p_rpt->handle, length, data, false);
+        hid_stats_inc(ret == ESP_OK ? HID_STAT_SENT_RPT_ID(id) : HID_STAT_SEND_FAIL);
+        return ret;
     }
 
-    return;
+    hid_stats_inc(HID_STAT_SEND_FAIL);
+    return ESP_ERR_NOT_FOUND;
 }
 
 void enable_led_notifications() {
@@ -81,7 +112,7 @@ void enable_led_notifications() {
 
     uint8_t value = 1;
     esp_err_t ret;
-    if ((p_rpt = hid_dev_rpt_by_id(HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT)) != NULL) {
+    if ((p_rpt = hid_dev_rpt_by_id(HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT, HID_PROTOCOL_MODE_REPORT)) != NULL) {
         ret = esp_ble_gatts_set_attr_value(p_rpt->cccdHandle, length, &value);
         if (ret != ESP_OK) {
             ESP_LOGE(HID_LE_PRF_TAG, "%s(), Failed to enable notifications", __func__);
@@ -99,7 +130,7 @@ void disable_led_notifications() {
 
     uint8_t value = 0;
     esp_err_t ret;
-    if ((p_rpt = hid_dev_rpt_by_id(HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT)) != NULL) {
+    if ((p_rpt = hid_dev_rpt_by_id(HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT, HID_PROTOCOL_MODE_REPORT)) != NULL) {
         ret = esp_ble_gatts_set_attr_value(p_rpt->cccdHandle, length, &value);
         if (ret != ESP_OK) {
             ESP_LOGE(HID_LE_PRF_TAG, "%s(), Failed to enable notifications", __func__);
@@ -121,7 +152,7 @@ uint8_t hid_dev_get_leds()
 
     ESP_LOGD(HID_LE_PRF_TAG, "Checking report using protocol mode");
     // get att handle for report using protocol mode
-    if ((p_rpt = hid_dev_rpt_by_id(HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT)) != NULL)
+    if ((p_rpt = hid_dev_rpt_by_id(HID_RPT_ID_LED_OUT, HID_REPORT_TYPE_OUTPUT, HID_PROTOCOL_MODE_REPORT)) != NULL)
     {
         ret = esp_ble_gatts_get_attr_value(p_rpt->handle, &length, &value);
 
@@ -13,8 +13,12 @@
 // limitations under the License.
 
 #include "hidd_le_prf_int.h"
+#include "hid_stats.h"
+#include "boot_time.h"
+#include "phy_policy.h"
 #include <string.h>
 #include "esp_log.h"
+#include "sdkconfig.h"
 
 /// characteristic presentation information
 struct prf_char_pres_fmt
@@ -116,17 +120,10 @@ static const uint8_t hidReportMap[] = {
     0x09, 0x01,   // Usage (Consumer Control)
     0xA1, 0x01,   // Collection (Application)
     0x85, 0x03,   // Report Id (3)
-    0x09, 0x02,   //   Usage (Numeric Key Pad)
-    0xA1, 0x02,   //   Collection (Logical)
-    0x05, 0x09,   //     Usage Pg (Button)
-    0x19, 0x01,   //     Usage Min (Button 1)
-    0x29, 0x0A,   //     Usage Max (Button 10)
-    0x15, 0x01,   //     Logical Min (1)
-    0x25, 0x0A,   //     Logical Max (10)
-    0x75, 0x04,   //     Report Size (4)
-    0x95, 0x01,   //     Report Count (1)
-    0x81, 0x00,   //     Input (Data, Ary, Abs)
-    0xC0,         //   End Collection
+    // Numeric key pad and selection are never sent; their bits stay as constant padding
+    0x75, 0x04,   //   Report Size (4)
+    0x95, 0x01,   //   Report Count (1)
+    0x81, 0x03,   //   Input (Const, Var, Abs) - Numeric key pad
     0x05, 0x0C,   //   Usage Pg (Consumer Devices)
     0x09, 0x86,   //   Usage (Channel)
     0x15, 0xFF,   //   Logical Min (-1)
@@ -157,19 +154,159 @@ static const uint8_t hidReportMap[] = {
     0x75, 0x04,   //   Report Size (4)
     0x95, 0x01,   //   Report Count (1)
     0x81, 0x00,   //   Input (Data, Ary, Abs)
-    0x09, 0x80,   //   Usage (Selection)
-    0xA1, 0x02,   //   Collection (Logical)
-    0x05, 0x09,   //     Usage Pg (Button)
-    0x19, 0x01,   //     Usage Min (Button 1)
-    0x29, 0x03,   //     Usage Max (Button 3)
-    0x15, 0x01,   //     Logical Min (1)
-    0x25, 0x03,   //     Logical Max (3)
-    0x75, 0x02,   //     Report Size (2)
-    0x81, 0x00,   //     Input (Data, Ary, Abs)
-    0xC0,           //   End Collection
-    0x81, 0x03,   //   Input (Const, Var, Abs)
+    0x81, 0x03,   //   Input (Const, Var, Abs) - Selection and padding
     0xC0,            // End Collectionq
 
+    0x05, 0x01,        // Usage Page (Generic Desktop)
+    0x09, 0x05,        // Usage (Game Pad)
+    0xA1, 0x01,        // Collection (Application)
+    0x85, 0x05,        //   Report Id (5)
+    0x09, 0x30,        //   Usage (X)
+    0x09, 0x31,        //   Usage (Y)
+    0x09, 0x32,        //   Usage (Z)
+    0x09, 0x33,        //   Usage (Rx)
+    0x09, 0x34,        //   Usage (Ry)
+    0x09, 0x35,        //   Usage (Rz)
+    0x16, 0x01, 0x80,  //   Logical Minimum (-32767)
+    0x26, 0xFF, 0x7F,  //   Logical Maximum (32767)
+    0x75, 0x10,        //   Report Size (16)
+    0x95, 0x06,        //   Report Count (6)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute) - Axes
+    0x09, 0x39,        //   Usage (Hat switch)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x07,        //   Logical Maximum (7)
+    0x35, 0x00,        //   Physical Minimum (0)
+    0x46, 0x3B, 0x01,  //   Physical Maximum (315)
+    0x65, 0x14,        //   Unit (Eng Rot: Degree)
+    0x75, 0x04,        //   Report Size (4)
+    0x95, 0x01,        //   Report Count (1)
+    0x81, 0x42,        //   Input (Data, Variable, Absolute, Null State) - Hat
+    0x65, 0x00,        //   Unit (None)
+    0x45, 0x00,        //   Physical Maximum (0)
+    0x81, 0x01,        //   Input (Constant) - Hat padding
+    0x05, 0x09,        //   Usage Page (Buttons)
+    0x19, 0x01,        //   Usage Minimum (01) - Button 1
+    0x29, 0x20,        //   Usage Maximum (32) - Button 32
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x20,        //   Report Count (32)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute) - Button states
+    0xC0,              // End Collection
+
+    // Windows Precision Touchpad, hybrid reporting: two contacts per report, so a frame with
+    // more fingers goes out as several reports sharing one scan time. Logical and Physical
+    // Minimum (0) carry over from the gamepad; the map has no room to repeat them
+    0x05, 0x0D,        // Usage Page (Digitizer)
+    0x09, 0x05,        // Usage (Touch Pad)
+    0xA1, 0x01,        // Collection (Application)
+    0x85, 0x06,        //   Report Id (6)
+    0x09, 0x22,        //   Usage (Finger)
+    0xA1, 0x02,        //   Collection (Logical)
+    0x09, 0x47,        //     Usage (Confidence)
+    0x09, 0x42,        //     Usage (Tip Switch)
+    0x25, 0x01,        //     Logical Maximum (1)
+    0x75, 0x01,        //     Report Size (1)
+    0x95, 0x02,        //     Report Count (2)
+    0x81, 0x02,        //     Input (Data, Variable, Absolute)
+    0x09, 0x51,        //     Usage (Contact Identifier)
+    0x25, 0x04,        //     Logical Maximum (4)
+    0x75, 0x06,        //     Report Size (6)
+    0x95, 0x01,        //     Report Count (1)
+    0x81, 0x02,        //     Input (Data, Variable, Absolute)
+    0x05, 0x01,        //     Usage Page (Generic Desktop)
+    0x09, 0x30,        //     Usage (X)
+    0x09, 0x31,        //     Usage (Y)
+    0x26, 0xE8, 0x03,  //     Logical Maximum (1000)
+    0x46, 0xE8, 0x03,  //     Physical Maximum (1000)
+    0x55, 0x0E,        //     Unit Exponent (-2)
+    0x65, 0x11,        //     Unit (SI Linear: cm)
+    0x75, 0x10,        //     Report Size (16)
+    0x95, 0x02,        //     Report Count (2)
+    0x81, 0x02,        //     Input (Data, Variable, Absolute) - 10 x 10 cm surface
+    0xC0,              //   End Collection
+    0x05, 0x0D,        //   Usage Page (Digitizer)
+    0x09, 0x22,        //   Usage (Finger)
+    0xA1, 0x02,        //   Collection (Logical)
+    0x09, 0x47,        //     Usage (Confidence)
+    0x09, 0x42,        //     Usage (Tip Switch)
+    0x25, 0x01,        //     Logical Maximum (1)
+    0x75, 0x01,        //     Report Size (1)
+    0x81, 0x02,        //     Input (Data, Variable, Absolute) - Report Count (2) from X and Y above
+    0x09, 0x51,        //     Usage (Contact Identifier)
+    0x25, 0x04,        //     Logical Maximum (4)
+    0x75, 0x06,        //     Report Size (6)
+    0x95, 0x01,        //     Report Count (1)
+    0x81, 0x02,        //     Input (Data, Variable, Absolute)
+    0x05, 0x01,        //     Usage Page (Generic Desktop)
+    0x09, 0x30,        //     Usage (X)
+    0x09, 0x31,        //     Usage (Y)
+    0x26, 0xE8, 0x03,  //     Logical Maximum (1000)
+    0x75, 0x10,        //     Report Size (16)
+    0x95, 0x02,        //     Report Count (2)
+    0x81, 0x02,        //     Input (Data, Variable, Absolute)
+    0xC0,              //   End Collection
+    0x05, 0x0D,        //   Usage Page (Digitizer)
+    0x09, 0x56,        //   Usage (Scan Time)
+    0x27, 0xFF, 0xFF, 0x00, 0x00, // Logical Maximum (65535)
+    0x45, 0x00,        //   Physical Maximum (0)
+    0x55, 0x0C,        //   Unit Exponent (-4)
+    0x66, 0x01, 0x10,  //   Unit (SI Linear: Seconds)
+    0x75, 0x10,        //   Report Size (16)
+    0x95, 0x01,        //   Report Count (1)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute) - 100 us units
+    0x55, 0x00,        //   Unit Exponent (0)
+    0x65, 0x00,        //   Unit (None)
+    0x09, 0x54,        //   Usage (Contact Count)
+    0x25, 0x7F,        //   Logical Maximum (127)
+    0x75, 0x07,        //   Report Size (7)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute) - first report of a frame only
+    0x05, 0x09,        //   Usage Page (Buttons)
+    0x09, 0x01,        //   Usage (Button 1)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute) - Pad click
+    0x05, 0x0D,        //   Usage Page (Digitizer)
+    0x85, 0x07,        //   Report Id (7)
+    0x09, 0x55,        //   Usage (Contact Count Maximum)
+    0x09, 0x59,        //   Usage (Pad Type)
+    0x25, 0x0F,        //   Logical Maximum (15)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, 0x02,        //   Report Count (2)
+    0xB1, 0x02,        //   Feature (Data, Variable, Absolute) - Capabilities
+    0x06, 0x00, 0xFF,  //   Usage Page (Vendor Defined 0xFF00)
+    0x85, 0x0A,        //   Report Id (10)
+    0x09, 0xC5,        //   Usage (Device Certification Status)
+    0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+    0x96, 0x00, 0x01,  //   Report Count (256)
+    0xB1, 0x02,        //   Feature (Data, Variable, Absolute) - Certification blob, bytes
+    0xC0,              // End Collection
+
+    0x05, 0x0D,        // Usage Page (Digitizer)
+    0x09, 0x0E,        // Usage (Device Configuration)
+    0xA1, 0x01,        // Collection (Application)
+    0x85, 0x08,        //   Report Id (8)
+    0x09, 0x22,        //   Usage (Finger)
+    0xA1, 0x02,        //   Collection (Logical)
+    0x09, 0x52,        //     Usage (Input Mode)
+    0x25, 0x0A,        //     Logical Maximum (10)
+    0x95, 0x01,        //     Report Count (1)
+    0xB1, 0x02,        //     Feature (Data, Variable, Absolute) - 0 mouse, 3 touchpad
+    0xC0,              //   End Collection
+    0x09, 0x22,        //   Usage (Finger)
+    0xA1, 0x00,        //   Collection (Physical)
+    0x85, 0x09,        //     Report Id (9)
+    0x09, 0x57,        //     Usage (Surface Switch)
+    0x09, 0x58,        //     Usage (Button Switch)
+    0x25, 0x01,        //     Logical Maximum (1)
+    0x75, 0x01,        //     Report Size (1)
+    0x95, 0x02,        //     Report Count (2)
+    0xB1, 0x02,        //     Feature (Data, Variable, Absolute) - Selective reporting
+    0x95, 0x06,        //     Report Count (6)
+    0xB1, 0x03,        //     Feature (Constant) - Padding
+    0xC0,              //   End Collection
+    0xC0,              // End Collection
+
 #if (SUPPORT_REPORT_VENDOR == true)
     0x06, 0xFF, 0xFF, // Usage Page(Vendor defined)
     0x09, 0xA5,       // Usage(Vendor Defined)
@@ -185,6 +322,13 @@ static const uint8_t hidReportMap[] = {
 
 };
 
+_Static_assert(sizeof(hidReportMap) <= HIDD_LE_REPORT_MAP_MAX_LEN, "report map does not fit its characteristic");
+
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+_Static_assert(PHY_POLICY_1M_PREF_MASK == ESP_BLE_GAP_PHY_1M_PREF_MASK &&
+               PHY_POLICY_2M_PREF_MASK == ESP_BLE_GAP_PHY_2M_PREF_MASK, "phy_policy.h uses the HCI bits");
+#endif
+
 /// Battery Service Attributes Indexes
 enum
 {
@@ -198,6 +342,26 @@ enum
     BAS_IDX_NB,
 };
 
+#if CONFIG_KBM_BLE_INPUT_SERVICE
+/// Input Service Attributes Indexes
+enum
+{
+    INPUT_IDX_SVC,
+
+    INPUT_IDX_FRAME_CHAR,
+    INPUT_IDX_FRAME_VAL,
+
+    INPUT_IDX_STATUS_CHAR,
+    INPUT_IDX_STATUS_VAL,
+    INPUT_IDX_STATUS_NTF_CFG,
+
+    INPUT_IDX_NB,
+};
+
+/// Longest frame a single write can carry, MTU 517 less the ATT header
+#define INPUT_FRAME_MAX_LEN     512
+#endif
+
 #define HI_UINT16(a) (((a) >> 8) & 0xFF)
 #define LO_UINT16(a) ((a) & 0xFF)
 #define PROFILE_NUM            1
@@ -213,7 +377,7 @@ struct gatts_profile_inst {
 hidd_le_env_t hidd_le_env;
 
 // HID report map length
-uint8_t hidReportMapLen = sizeof(hidReportMap);
+uint16_t hidReportMapLen = sizeof(hidReportMap);
 uint8_t hidProtocolMode = HID_PROTOCOL_MODE_REPORT;
 uint8_t hidBootMode = HID_PROTOCOL_MODE_BOOT;
 
@@ -258,6 +422,35 @@ static uint8_t hidReportRefFeature[HID_REPORT_REF_LEN] =
 static uint8_t hidReportRefCCIn[HID_REPORT_REF_LEN] =
              { HID_RPT_ID_CC_IN, HID_REPORT_TYPE_INPUT };
 
+// HID Report Reference characteristic descriptor, gamepad input
+static uint8_t hidReportRefGamepadIn[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_GAMEPAD_IN, HID_REPORT_TYPE_INPUT };
+
+// HID Report Reference characteristic descriptor, touchpad input
+static uint8_t hidReportRefTouchpadIn[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_TOUCHPAD_IN, HID_REPORT_TYPE_INPUT };
+
+// HID Report Reference characteristic descriptors, touchpad features
+static uint8_t hidReportRefTouchpadCaps[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_TOUCHPAD_CAPS, HID_REPORT_TYPE_FEATURE };
+static uint8_t hidReportRefTouchpadMode[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_TOUCHPAD_MODE, HID_REPORT_TYPE_FEATURE };
+static uint8_t hidReportRefTouchpadSwitch[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_TOUCHPAD_SWITCH, HID_REPORT_TYPE_FEATURE };
+static uint8_t hidReportRefTouchpadCert[HID_REPORT_REF_LEN] =
+             { HID_RPT_ID_TOUCHPAD_CERT, HID_REPORT_TYPE_FEATURE };
+
+// Touchpad capabilities: five contacts, click pad
+static uint8_t hidTouchpadCaps[] = { 5, 0 };
+// Input mode starts as mouse until the host selects touchpad (3)
+static uint8_t hidTouchpadMode[] = { 0 };
+// Surface and button reporting both on
+static uint8_t hidTouchpadSwitch[] = { 0x03 };
+// Device certification status: the 256-byte blob Microsoft issues once the touchpad passes
+// certification goes here. Windows reads it before it takes the collection as a Precision
+// Touchpad; an uncertified blob leaves the device in mouse mode
+static uint8_t hidTouchpadCert[256] = { 0 };
+
 
 /*
  *  Heart Rate PROFILE ATTRIBUTES
@@ -301,6 +494,8 @@ static const uint8_t   bat_lev_ccc[2] ={ 0x00, 0x00};
 static const uint16_t char_format_uuid = ESP_GATT_UUID_CHAR_PRESENT_FORMAT;
 
 static uint8_t battary_lev = 50;
+static uint16_t bas_lvl_handle = 0;
+static uint16_t bas_ccc_handle = 0;
 /// Full HRS Database Description - Used to add attributes into the database
 static const esp_gatts_attr_db_t bas_att_db[BAS_IDX_NB] =
 {
@@ -326,6 +521,57 @@ static const esp_gatts_attr_db_t bas_att_db[BAS_IDX_NB] =
 };
 
 
+#if CONFIG_KBM_BLE_INPUT_SERVICE
+/// Input Service, 4b4d0001-7e3a-4c5e-9b1f-2a6c8d0e5f10 (little endian)
+static const uint8_t input_svc_uuid[ESP_UUID_LEN_128] = {
+    0x10, 0x5f, 0x0e, 0x8d, 0x6c, 0x2a, 0x1f, 0x9b, 0x5e, 0x4c, 0x3a, 0x7e, 0x01, 0x00, 0x4d, 0x4b,
+};
+/// Input Frame Characteristic, 4b4d0002-7e3a-4c5e-9b1f-2a6c8d0e5f10
+static const uint8_t input_frame_uuid[ESP_UUID_LEN_128] = {
+    0x10, 0x5f, 0x0e, 0x8d, 0x6c, 0x2a, 0x1f, 0x9b, 0x5e, 0x4c, 0x3a, 0x7e, 0x02, 0x00, 0x4d, 0x4b,
+};
+
+/// Frame Status Characteristic, 4b4d0003-7e3a-4c5e-9b1f-2a6c8d0e5f10
+static const uint8_t input_status_uuid[ESP_UUID_LEN_128] = {
+    0x10, 0x5f, 0x0e, 0x8d, 0x6c, 0x2a, 0x1f, 0x9b, 0x5e, 0x4c, 0x3a, 0x7e, 0x03, 0x00, 0x4d, 0x4b,
+};
+static const uint8_t input_status_ccc[2] = {0x00, 0x00};
+
+/// Sequence number of the last frame dropped for want of ring space, see input_frame.h
+static uint8_t input_status_val[2] = {0xFF, 0xFF};
+
+static uint16_t input_frame_handle = 0;
+static uint16_t input_status_handle = 0;
+static uint16_t input_status_ccc_handle = 0;
+
+static const esp_gatts_attr_db_t input_att_db[INPUT_IDX_NB] =
+{
+    // Input Service Declaration
+    [INPUT_IDX_SVC]             = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&primary_service_uuid, ESP_GATT_PERM_READ_ENCRYPTED,
+                                            ESP_UUID_LEN_128, ESP_UUID_LEN_128, (uint8_t *)input_svc_uuid}},
+
+    // Input Frame Characteristic Declaration
+    [INPUT_IDX_FRAME_CHAR]      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ_ENCRYPTED,
+                                            CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_write_nr}},
+
+    // Input Frame Characteristic Value
+    [INPUT_IDX_FRAME_VAL]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_128, (uint8_t *)input_frame_uuid, ESP_GATT_PERM_WRITE_ENCRYPTED,
+                                            INPUT_FRAME_MAX_LEN, 0, NULL}},
+
+    // Frame Status Characteristic Declaration
+    [INPUT_IDX_STATUS_CHAR]     = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid, ESP_GATT_PERM_READ_ENCRYPTED,
+                                            CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE, (uint8_t *)&char_prop_read_notify}},
+
+    // Frame Status Characteristic Value
+    [INPUT_IDX_STATUS_VAL]      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_128, (uint8_t *)input_status_uuid, ESP_GATT_PERM_READ_ENCRYPTED,
+                                            sizeof(input_status_val), sizeof(input_status_val), input_status_val}},
+
+    // Frame Status Characteristic - Client Characteristic Configuration Descriptor
+    [INPUT_IDX_STATUS_NTF_CFG]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid, ESP_GATT_PERM_READ_ENCRYPTED|ESP_GATT_PERM_WRITE_ENCRYPTED,
+                                            sizeof(uint16_t), sizeof(input_status_ccc), (uint8_t *)input_status_ccc}},
+};
+#endif
+
 /// Full Hid device Database Description - Used to add attributes into the database
 static esp_gatts_attr_db_t hidd_le_gatt_db[] =
 {
@@ -480,6 +726,104 @@ static esp_gatts_attr_db_t hidd_le_gatt_db[] =
                                                                        sizeof(hidReportRefCCIn), sizeof(hidReportRefCCIn),
                                                                        hidReportRefCCIn}},
 
+    // Report Characteristic Declaration
+    [HIDD_LE_IDX_REPORT_GAMEPAD_IN_CHAR]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
+                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+                                                                         (uint8_t *)&char_prop_read_notify}},
+    // Report Characteristic Value
+    [HIDD_LE_IDX_REPORT_GAMEPAD_IN_VAL]       = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
+                                                                       NULL}},
+    // Report GAMEPAD INPUT Characteristic - Client Characteristic Configuration Descriptor
+    [HIDD_LE_IDX_REPORT_GAMEPAD_IN_CCC]         = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
+                                                                      (ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_WRITE_ENCRYPTED),
+                                                                      sizeof(uint16_t), 0,
+                                                                      NULL}},
+     // Report Characteristic - Report Reference Descriptor
+    [HIDD_LE_IDX_REPORT_GAMEPAD_IN_REP_REF]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidReportRefGamepadIn), sizeof(hidReportRefGamepadIn),
+                                                                       hidReportRefGamepadIn}},
+
+    // Report Characteristic Declaration
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_IN_CHAR]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
+                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+                                                                         (uint8_t *)&char_prop_read_notify}},
+    // Report Characteristic Value
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_IN_VAL]      = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       HIDD_LE_REPORT_MAX_LEN, 0,
+                                                                       NULL}},
+    // Report TOUCHPAD INPUT Characteristic - Client Characteristic Configuration Descriptor
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_IN_CCC]        = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_client_config_uuid,
+                                                                      (ESP_GATT_PERM_READ_ENCRYPTED | ESP_GATT_PERM_WRITE_ENCRYPTED),
+                                                                      sizeof(uint16_t), 0,
+                                                                      NULL}},
+     // Report Characteristic - Report Reference Descriptor
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_IN_REP_REF] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidReportRefTouchpadIn), sizeof(hidReportRefTouchpadIn),
+                                                                       hidReportRefTouchpadIn}},
+
+    // Touchpad Capabilities Feature Report Characteristic Declaration
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_CHAR]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
+                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+                                                                         (uint8_t *)&char_prop_read}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_VAL]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidTouchpadCaps), sizeof(hidTouchpadCaps),
+                                                                       hidTouchpadCaps}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_REP_REF] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidReportRefTouchpadCaps), sizeof(hidReportRefTouchpadCaps),
+                                                                       hidReportRefTouchpadCaps}},
+
+    // Touchpad Input Mode Feature Report Characteristic Declaration
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_CHAR]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
+                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+                                                                         (uint8_t *)&char_prop_read_write}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_VAL]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED|ESP_GATT_PERM_WRITE_ENCRYPTED,
+                                                                       sizeof(hidTouchpadMode), sizeof(hidTouchpadMode),
+                                                                       hidTouchpadMode}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_REP_REF] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidReportRefTouchpadMode), sizeof(hidReportRefTouchpadMode),
+                                                                       hidReportRefTouchpadMode}},
+
+    // Touchpad Selective Reporting Feature Report Characteristic Declaration
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_CHAR] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
+                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+                                                                         (uint8_t *)&char_prop_read_write}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_VAL]   = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED|ESP_GATT_PERM_WRITE_ENCRYPTED,
+                                                                       sizeof(hidTouchpadSwitch), sizeof(hidTouchpadSwitch),
+                                                                       hidTouchpadSwitch}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_REP_REF] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidReportRefTouchpadSwitch), sizeof(hidReportRefTouchpadSwitch),
+                                                                       hidReportRefTouchpadSwitch}},
+
+    // Touchpad Certification Status Feature Report Characteristic Declaration
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_CHAR]  = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
+                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                         CHAR_DECLARATION_SIZE, CHAR_DECLARATION_SIZE,
+                                                                         (uint8_t *)&char_prop_read}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_VAL]    = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidTouchpadCert), sizeof(hidTouchpadCert),
+                                                                       hidTouchpadCert}},
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_REP_REF] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&hid_report_ref_descr_uuid,
+                                                                       ESP_GATT_PERM_READ_ENCRYPTED,
+                                                                       sizeof(hidReportRefTouchpadCert), sizeof(hidReportRefTouchpadCert),
+                                                                       hidReportRefTouchpadCert}},
+
     // Boot Keyboard Input Report Characteristic Declaration
     [HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR] = {{ESP_GATT_AUTO_RSP}, {ESP_UUID_LEN_16, (uint8_t *)&character_declaration_uuid,
                                                                         ESP_GATT_PERM_READ_ENCRYPTED,
@@ -540,45 +884,178 @@ static esp_gatts_attr_db_t hidd_le_gatt_db[] =
                                                                        hidReportRefFeature}},
 };
 
-static void handle_to_name(uint16_t handle) {
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_SVC", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_INCL_SVC]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_INCL_SVC", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_HID_INFO_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_HID_INFO_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_HID_INFO_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_HID_INFO_VAL", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_HID_CTNL_PT_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_HID_CTNL_PT_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_HID_CTNL_PT_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_HID_CTNL_PT_VAL", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MAP_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MAP_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MAP_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MAP_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MAP_EXT_REP_REF]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MAP_EXT_REP_REF", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_PROTO_MODE_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_PROTO_MODE_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_PROTO_MODE_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_PROTO_MODE_VAL", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MOUSE_IN_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MOUSE_IN_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_CCC]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MOUSE_IN_CCC", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_REP_REF]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_MOUSE_REP_REF", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_KEY_IN_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_KEY_IN_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_CCC]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_KEY_IN_CCC", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_KEY_IN_REP_REF]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_KEY_IN_REP_REF", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_LED_OUT_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_LED_OUT_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_REP_REF]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_LED_OUT_REP_REF", handle);   
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CC_IN_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_CC_IN_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CC_IN_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_CC_IN_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CC_IN_CCC]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_CC_IN_CCC", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CC_IN_REP_REF]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_CC_IN_REP_REF", handle); 
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_IN_REPORT_NTF_CFG]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_KB_IN_REPORT_NTF_CFG", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_OUT_REPORT_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_KB_OUT_REPORT_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_OUT_REPORT_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_KB_OUT_REPORT_VAL", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_NTF_CFG]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_NTF_CFG", handle);    
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_CHAR]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_CHAR", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_VAL]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_VAL", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_REP_REF]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_REPORT_REP_REF", handle);
-    if (handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_NB]) ESP_LOGI(HID_LE_PRF_TAG, "handle: %d = HIDD_LE_IDX_NB", handle);
+/// Attribute index of each HID service handle by its offset from the service declaration, so
+/// an event finds its attribute in one lookup however long the table grows. The stack hands
+/// out the table's handles consecutively; offsets past the table map to nothing
+#define HIDD_LE_IDX_NONE    0xFF
+_Static_assert(HIDD_LE_IDX_NB < HIDD_LE_IDX_NONE, "attribute indexes must fit a uint8_t");
+static uint8_t hidd_le_att_idx[HIDD_LE_IDX_NB];
+/// hid_rpt_map entry whose CCCD is at each attribute index, or HIDD_LE_IDX_NONE
+static uint8_t hidd_le_ccc_rpt[HIDD_LE_IDX_NB];
+_Static_assert(HID_NUM_REPORTS <= 16, "hidd_clcb_t.notify_off has a bit per report");
+
+typedef void (*hidd_le_write_handler_t)(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+
+static void hidd_le_write_ctnl_pt(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+static void hidd_le_write_proto_mode(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+static void hidd_le_write_report_ccc(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+static void hidd_le_write_led_out(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+#if (SUPPORT_REPORT_VENDOR == true)
+static void hidd_le_write_vendor_out(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+#endif
+static void hidd_le_write_touchpad_mode(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+static void hidd_le_write_touchpad_switch(uint8_t att_idx, esp_ble_gatts_cb_param_t *param);
+
+/// Writable attributes of the HID service and what a write to each does
+static const hidd_le_write_handler_t hidd_le_write_handlers[HIDD_LE_IDX_NB] = {
+    [HIDD_LE_IDX_HID_CTNL_PT_VAL]               = &hidd_le_write_ctnl_pt,
+    [HIDD_LE_IDX_PROTO_MODE_VAL]                = &hidd_le_write_proto_mode,
+    [HIDD_LE_IDX_REPORT_MOUSE_IN_CCC]           = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_REPORT_KEY_IN_CCC]             = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_REPORT_CC_IN_CCC]              = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_REPORT_GAMEPAD_IN_CCC]         = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_IN_CCC]        = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_BOOT_KB_IN_REPORT_NTF_CFG]     = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_NTF_CFG]  = &hidd_le_write_report_ccc,
+    [HIDD_LE_IDX_REPORT_LED_OUT_VAL]            = &hidd_le_write_led_out,
+    [HIDD_LE_IDX_BOOT_KB_OUT_REPORT_VAL]        = &hidd_le_write_led_out,
+#if (SUPPORT_REPORT_VENDOR == true)
+    [HIDD_LE_IDX_REPORT_VENDOR_OUT_VAL]         = &hidd_le_write_vendor_out,
+#endif
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_VAL]      = &hidd_le_write_touchpad_mode,
+    [HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_VAL]    = &hidd_le_write_touchpad_switch,
+};
+
+/// Fills the reverse maps once the stack has assigned the table's handles
+static void hidd_le_build_att_idx(void) {
+    uint16_t base = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC];
+
+    memset(hidd_le_att_idx, HIDD_LE_IDX_NONE, sizeof(hidd_le_att_idx));
+    for (uint8_t i = 0; i < HIDD_LE_IDX_NB; i++) {
+        uint16_t offset = hidd_le_env.hidd_inst.att_tbl[i] - base;
+        if (offset < HIDD_LE_IDX_NB) {
+            hidd_le_att_idx[offset] = i;
+        } else {
+            ESP_LOGW(HID_LE_PRF_TAG, "attribute %d at handle %d is outside the service range", i,
+                     hidd_le_env.hidd_inst.att_tbl[i]);
+        }
+    }
+}
+
+/// Attribute index of a handle in the HID service, HIDD_LE_IDX_NONE for any other handle
+static uint8_t hidd_le_handle_to_idx(uint16_t handle) {
+    uint16_t base = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC];
+    uint16_t offset = handle - base;
+
+    if (base == 0 || offset >= HIDD_LE_IDX_NB) {
+        return HIDD_LE_IDX_NONE;
+    }
+    return hidd_le_att_idx[offset];
+}
+
+/// Links each input report's CCCD to its hid_rpt_map entry, after hid_add_id_tbl
+static void hidd_le_build_ccc_rpt(void) {
+    memset(hidd_le_ccc_rpt, HIDD_LE_IDX_NONE, sizeof(hidd_le_ccc_rpt));
+    for (uint8_t i = 0; i < HID_NUM_REPORTS; i++) {
+        uint8_t att_idx = hid_rpt_map[i].cccdHandle != 0 ? hidd_le_handle_to_idx(hid_rpt_map[i].cccdHandle) :
+                                                           HIDD_LE_IDX_NONE;
+        if (att_idx != HIDD_LE_IDX_NONE) {
+            hidd_le_ccc_rpt[att_idx] = i;
+        }
+    }
+}
+
+/// Suspend (0) and Exit Suspend (1); the host is asleep in between
+static void hidd_le_write_ctnl_pt(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    hidd_clcb_t *p_clcb = hidd_clcb_find(param->write.conn_id);
+
+    if (p_clcb != NULL && param->write.len == 1 && param->write.value[0] <= HID_CMD_EXIT_SUSPEND) {
+        p_clcb->suspended = param->write.value[0] == HID_CMD_SUSPEND;
+        ESP_LOGI(HID_LE_PRF_TAG, "conn_id %d host %s", param->write.conn_id,
+                 p_clcb->suspended ? "suspended" : "resumed");
+        if (hidd_le_env.hidd_cb != NULL) {
+            esp_hidd_cb_param_t cb_param = {0};
+            cb_param.suspend.conn_id = param->write.conn_id;
+            cb_param.suspend.suspended = p_clcb->suspended;
+            (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_SUSPEND, &cb_param);
+        }
+    }
+}
+
+static void hidd_le_write_proto_mode(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    hidd_clcb_t *p_clcb = hidd_clcb_find(param->write.conn_id);
+
+    if (p_clcb != NULL && param->write.len == HID_PROTOCOL_MODE_LEN &&
+        param->write.value[0] <= HID_PROTOCOL_MODE_REPORT) {
+        p_clcb->proto_mode = param->write.value[0];
+        ESP_LOGI(HID_LE_PRF_TAG, "conn_id %d switched to %s protocol mode", param->write.conn_id,
+                 p_clcb->proto_mode == HID_PROTOCOL_MODE_BOOT ? "boot" : "report");
+    }
+}
+
+/// A report whose notifications the host turned off is not sent until it turns them on again
+static void hidd_le_write_report_ccc(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    uint8_t rpt = hidd_le_ccc_rpt[att_idx];
+    hidd_clcb_t *p_clcb = hidd_clcb_find(param->write.conn_id);
+
+    if (rpt == HIDD_LE_IDX_NONE || p_clcb == NULL || param->write.len < 1) {
+        return;
+    }
+    if (param->write.value[0] & 0x01) {
+        p_clcb->notify_off &= ~(1 << rpt);
+    } else {
+        p_clcb->notify_off |= 1 << rpt;
+    }
+    ESP_LOGI(HID_LE_PRF_TAG, "conn_id %d %s report %d notifications %s", param->write.conn_id,
+             hid_rpt_map[rpt].mode == HID_PROTOCOL_MODE_BOOT ? "boot" : "input", hid_rpt_map[rpt].id,
+             p_clcb->notify_off & (1 << rpt) ? "off" : "on");
+}
+
+static void hidd_le_write_led_out(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    esp_hidd_cb_param_t cb_param = {0};
+
+    if (hidd_le_env.hidd_cb == NULL) {
+        ESP_LOGI(HID_LE_PRF_TAG, "no callback found for write events");
+        return;
+    }
+    cb_param.led_write.conn_id = param->write.conn_id;
+    cb_param.led_write.report_id = HID_RPT_ID_LED_OUT;
+    cb_param.led_write.length = param->write.len;
+    cb_param.led_write.data = param->write.value;
+    (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT, &cb_param);
+}
+
+#if (SUPPORT_REPORT_VENDOR == true)
+static void hidd_le_write_vendor_out(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    esp_hidd_cb_param_t cb_param = {0};
+
+    if (hidd_le_env.hidd_cb == NULL) {
+        return;
+    }
+    cb_param.vendor_write.conn_id = param->write.conn_id;
+    cb_param.vendor_write.report_id = HID_RPT_ID_VENDOR_OUT;
+    cb_param.vendor_write.length = param->write.len;
+    cb_param.vendor_write.data = param->write.value;
+    (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_VENDOR_REPORT_WRITE_EVT, &cb_param);
+}
+#endif
+
+/// Windows writes input mode 3 when it takes the touchpad collection as a Precision Touchpad;
+/// until then contacts would land nowhere
+static void hidd_le_write_touchpad_mode(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    if (param->write.len >= 1) {
+        hidd_le_env.touchpad_mode = param->write.value[0];
+        ESP_LOGI(HID_LE_PRF_TAG, "touchpad input mode %d", hidd_le_env.touchpad_mode);
+    }
+}
+
+static void hidd_le_write_touchpad_switch(uint8_t att_idx, esp_ble_gatts_cb_param_t *param) {
+    if (param->write.len >= 1) {
+        hidd_le_env.touchpad_switch = param->write.value[0];
+        ESP_LOGI(HID_LE_PRF_TAG, "touchpad surface %s, button %s",
+                 hidd_le_env.touchpad_switch & 0x01 ? "on" : "off",
+                 hidd_le_env.touchpad_switch & 0x02 ? "on" : "off");
+    }
 }
 
 static void hid_add_id_tbl(void);
@@ -613,6 +1090,17 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
         }
         case ESP_GATTS_CREATE_EVT:
             break;
+        case ESP_GATTS_START_EVT: {
+            // A central that connects before this finds no HID service and never asks again
+            if (param->start.status == ESP_GATT_OK &&
+                param->start.service_handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC]) {
+                boot_time_mark(BOOT_MARK_HID_SERVICE);
+                if (hidd_le_env.hidd_cb != NULL) {
+                    (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_SERVICE_STARTED, NULL);
+                }
+            }
+            break;
+        }
         case ESP_GATTS_CONNECT_EVT: {
             esp_hidd_cb_param_t cb_param = {0};
 			ESP_LOGI(HID_LE_PRF_TAG, "HID connection establish, conn_id = %x",param->connect.conn_id);
@@ -620,6 +1108,19 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
             cb_param.connect.conn_id = param->connect.conn_id;
             hidd_clcb_alloc(param->connect.conn_id, param->connect.remote_bda);
             esp_ble_set_encryption(param->connect.remote_bda, ESP_BLE_SEC_ENCRYPT_MITM);
+            // Ask for the longest LL payload; the result arrives as ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT
+            hidd_le_env.dle_conn_id = param->connect.conn_id;
+            esp_ble_gap_set_pkt_data_len(param->connect.remote_bda, HIDD_MAX_DATA_LEN);
+            // See phy_policy.h; the outcome arrives as ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT
+            uint8_t phy_mask;
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+            if (phy_policy_connect(true, &phy_mask)) {
+                esp_ble_gap_set_preferred_phy(param->connect.remote_bda, 0, phy_mask, phy_mask,
+                                              ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+            }
+#else
+            phy_policy_connect(false, &phy_mask);
+#endif
             if(hidd_le_env.hidd_cb != NULL) {
                 (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_CONNECT, &cb_param);
             }
@@ -630,36 +1131,62 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                     (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_DISCONNECT, NULL);
              }
             hidd_clcb_dealloc(param->disconnect.conn_id);
+            // The next host negotiates its own input mode, and must not read back the last one's
+            hidd_le_env.touchpad_mode = hidTouchpadMode[0];
+            hidd_le_env.touchpad_switch = hidTouchpadSwitch[0];
+            esp_ble_gatts_set_attr_value(hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_VAL],
+                                         sizeof(hidTouchpadMode), hidTouchpadMode);
+            esp_ble_gatts_set_attr_value(hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_VAL],
+                                         sizeof(hidTouchpadSwitch), hidTouchpadSwitch);
             break;
         }
         case ESP_GATTS_CLOSE_EVT:
             break;
+        case ESP_GATTS_MTU_EVT: {
+            hidd_clcb_t *p_clcb = hidd_clcb_find(param->mtu.conn_id);
+            if (p_clcb != NULL) {
+                p_clcb->mtu = param->mtu.mtu;
+            }
+            ESP_LOGI(HID_LE_PRF_TAG, "conn_id %d MTU = %d", param->mtu.conn_id, param->mtu.mtu);
+            break;
+        }
+        case ESP_GATTS_CONGEST_EVT: {
+            hidd_clcb_t *p_clcb = hidd_clcb_find(param->congest.conn_id);
+            if (p_clcb != NULL) {
+                p_clcb->congest = param->congest.congested;
+            }
+            if (param->congest.congested) {
+                hid_stats_inc(HID_STAT_CONGEST_EVT);
+            }
+            ESP_LOGD(HID_LE_PRF_TAG, "conn_id %d congested = %d", param->congest.conn_id, param->congest.congested);
+            break;
+        }
+        case ESP_GATTS_READ_EVT: {
+            // Every readable attribute is auto-responded; this only traces what the host reads
+            ESP_LOGD(HID_LE_PRF_TAG, "read of attribute %d, handle %d",
+                     hidd_le_handle_to_idx(param->read.handle), param->read.handle);
+            break;
+        }
         case ESP_GATTS_WRITE_EVT: {
-            esp_hidd_cb_param_t cb_param = {0};
-            handle_to_name(param->write.handle);
-            if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_LED_OUT_VAL]) {
-                ESP_LOGI(HID_LE_PRF_TAG, "Write event at LED OUT characteristic");
-                if (hidd_le_env.hidd_cb != NULL) {
-                    ESP_LOGI(HID_LE_PRF_TAG, "Handling write event...");
-                    cb_param.led_write.conn_id = param->write.conn_id;
-                    cb_param.led_write.report_id = HID_RPT_ID_LED_OUT;
-                    cb_param.led_write.length = param->write.len;
-                    cb_param.led_write.data = param->write.value;
-                    (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT, &cb_param);
-                } else {
-                    ESP_LOGI(HID_LE_PRF_TAG, "no callback found for write events");
+            uint8_t att_idx = hidd_le_handle_to_idx(param->write.handle);
+            if (att_idx != HIDD_LE_IDX_NONE) {
+                ESP_LOGD(HID_LE_PRF_TAG, "write to attribute %d, handle %d, len %d", att_idx,
+                         param->write.handle, param->write.len);
+                if (hidd_le_write_handlers[att_idx] != NULL) {
+                    hidd_le_write_handlers[att_idx](att_idx, param);
                 }
+                break;
             }
-
-#if (SUPPORT_REPORT_VENDOR == true)
-            // cb_param = {0};
-            if (param->write.handle == hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_VENDOR_OUT_VAL] &&
-                hidd_le_env.hidd_cb != NULL) {
-                cb_param.vendor_write.conn_id = param->write.conn_id;
-                cb_param.vendor_write.report_id = HID_RPT_ID_VENDOR_OUT;
-                cb_param.vendor_write.length = param->write.len;
-                cb_param.vendor_write.data = param->write.value;
-                (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_VENDOR_REPORT_WRITE_EVT, &cb_param);
+#if CONFIG_KBM_BLE_INPUT_SERVICE
+            hidd_clcb_t *p_clcb = hidd_clcb_find(param->write.conn_id);
+            if (input_frame_handle != 0 && param->write.handle == input_frame_handle &&
+                p_clcb != NULL && hidd_le_env.hidd_cb != NULL) {
+                esp_hidd_cb_param_t cb_param = {0};
+                cb_param.input_frame.conn_id = param->write.conn_id;
+                cb_param.input_frame.seq = p_clcb->input_frames++;
+                cb_param.input_frame.length = param->write.len;
+                cb_param.input_frame.data = param->write.value;
+                (hidd_le_env.hidd_cb)(ESP_HIDD_EVENT_BLE_INPUT_FRAME_WRITE_EVT, &cb_param);
             }
 #endif
             break;
@@ -670,6 +1197,11 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                 param->add_attr_tab.status == ESP_GATT_OK) {
                 incl_svc.start_hdl = param->add_attr_tab.handles[BAS_IDX_SVC];
                 incl_svc.end_hdl = incl_svc.start_hdl + BAS_IDX_NB -1;
+                bas_lvl_handle = param->add_attr_tab.handles[BAS_IDX_BATT_LVL_VAL];
+                bas_ccc_handle = param->add_attr_tab.handles[BAS_IDX_BATT_LVL_NTF_CFG];
+                // The table was built from battary_lev when it was requested; a level measured since
+                // had no handle to go to
+                esp_ble_gatts_set_attr_value(bas_lvl_handle, sizeof(battary_lev), &battary_lev);
                 ESP_LOGI(HID_LE_PRF_TAG, "%s(), start added the hid service to the stack database. incl_handle = %d",
                            __func__, incl_svc.start_hdl);
                 esp_ble_gatts_create_attr_tab(hidd_le_gatt_db, gatts_if, HIDD_LE_IDX_NB, 0);
@@ -679,9 +1211,24 @@ void esp_hidd_prf_cb_hdl(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                 memcpy(hidd_le_env.hidd_inst.att_tbl, param->add_attr_tab.handles,
                             HIDD_LE_IDX_NB*sizeof(uint16_t));
                 ESP_LOGI(HID_LE_PRF_TAG, "hid svc handle = %x",hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC]);
+                hidd_le_build_att_idx();
                 hid_add_id_tbl();
+                hidd_le_build_ccc_rpt();
 		        esp_ble_gatts_start_service(hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_SVC]);
-            } else {
+            }
+#if CONFIG_KBM_BLE_INPUT_SERVICE
+            else if (param->add_attr_tab.num_handle == INPUT_IDX_NB &&
+                     param->add_attr_tab.svc_uuid.len == ESP_UUID_LEN_128 &&
+                     param->add_attr_tab.status == ESP_GATT_OK) {
+                input_frame_handle = param->add_attr_tab.handles[INPUT_IDX_FRAME_VAL];
+                input_status_handle = param->add_attr_tab.handles[INPUT_IDX_STATUS_VAL];
+                input_status_ccc_handle = param->add_attr_tab.handles[INPUT_IDX_STATUS_NTF_CFG];
+                ESP_LOGI(HID_LE_PRF_TAG, "input svc handle = %x, frame handle = %x",
+                         param->add_attr_tab.handles[INPUT_IDX_SVC], input_frame_handle);
+                esp_ble_gatts_start_service(param->add_attr_tab.handles[INPUT_IDX_SVC]);
+            }
+#endif
+            else {
                 esp_ble_gatts_start_service(param->add_attr_tab.handles[0]);
             }
             break;
@@ -697,6 +1244,10 @@ void hidd_le_create_service(esp_gatt_if_t gatts_if)
     /* Here should added the battery service first, because the hid service should include the battery service.
        After finish to added the battery service then can added the hid service. */
     esp_ble_gatts_create_attr_tab(bas_att_db, gatts_if, BAS_IDX_NB, 0);
+#if CONFIG_KBM_BLE_INPUT_SERVICE
+    /* Includes nothing and is included by nothing, so it does not wait for the chain above */
+    esp_ble_gatts_create_attr_tab(input_att_db, gatts_if, INPUT_IDX_NB, 0);
+#endif
 
 }
 
@@ -717,7 +1268,22 @@ void hidd_clcb_alloc (uint16_t conn_id, esp_bd_addr_t bda)
             p_clcb->in_use      = true;
             p_clcb->conn_id     = conn_id;
             p_clcb->connected   = true;
+            // Every new connection starts in report mode until the host writes Protocol Mode
+            p_clcb->proto_mode  = HID_PROTOCOL_MODE_REPORT;
+            p_clcb->suspended   = false;
+            // Notifications start on for every report; a host turns them off per connection
+            p_clcb->notify_off  = 0;
+            p_clcb->input_frames = 0;
+            p_clcb->mtu         = HIDD_DEFAULT_MTU;
+            p_clcb->tx_octets   = HIDD_DEFAULT_DATA_LEN;
+            p_clcb->rx_octets   = HIDD_DEFAULT_DATA_LEN;
+            p_clcb->tx_phy      = HIDD_PHY_1M;
+            p_clcb->rx_phy      = HIDD_PHY_1M;
             memcpy (p_clcb->remote_bda, bda, ESP_BD_ADDR_LEN);
+            if (hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_PROTO_MODE_VAL] != 0) {
+                esp_ble_gatts_set_attr_value(hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_PROTO_MODE_VAL],
+                                             HID_PROTOCOL_MODE_LEN, &p_clcb->proto_mode);
+            }
             break;
         }
     }
@@ -730,13 +1296,57 @@ bool hidd_clcb_dealloc (uint16_t conn_id)
     hidd_clcb_t      *p_clcb = NULL;
 
     for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HID_MAX_APPS; i_clcb++, p_clcb++) {
+        if (p_clcb->in_use && p_clcb->conn_id == conn_id) {
             memset(p_clcb, 0, sizeof(hidd_clcb_t));
             return true;
+        }
     }
 
     return false;
 }
 
+hidd_clcb_t *hidd_clcb_find(uint16_t conn_id)
+{
+    uint8_t              i_clcb = 0;
+    hidd_clcb_t      *p_clcb = NULL;
+
+    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HID_MAX_APPS; i_clcb++, p_clcb++) {
+        if (p_clcb->in_use && p_clcb->conn_id == conn_id) {
+            return p_clcb;
+        }
+    }
+
+    return NULL;
+}
+
+hidd_clcb_t *hidd_clcb_find_by_bda(esp_bd_addr_t bda)
+{
+    uint8_t              i_clcb = 0;
+    hidd_clcb_t      *p_clcb = NULL;
+
+    for (i_clcb = 0, p_clcb= hidd_le_env.hidd_clcb; i_clcb < HID_MAX_APPS; i_clcb++, p_clcb++) {
+        if (p_clcb->in_use && memcmp(p_clcb->remote_bda, bda, ESP_BD_ADDR_LEN) == 0) {
+            return p_clcb;
+        }
+    }
+
+    return NULL;
+}
+
+uint8_t hidd_clcb_proto_mode(uint16_t conn_id)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    return p_clcb != NULL ? p_clcb->proto_mode : hidProtocolMode;
+}
+
+bool hidd_clcb_notify_off(uint16_t conn_id, uint8_t rpt)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    return p_clcb != NULL && rpt < HID_NUM_REPORTS && (p_clcb->notify_off & (1 << rpt));
+}
+
 // All Gatt server callback is actually handled in esp_hidd_prf_cb_hdl, not gatts_event_handler
 static struct gatts_profile_inst hid_profile_table[PROFILE_NUM] = {
     [PROFILE_APP_IDX] = {
@@ -808,13 +1418,62 @@ void hidd_get_attr_value(uint16_t handle, uint16_t *length, uint8_t **value)
     return;
 }
 
+void hidd_set_battery_level(uint8_t level)
+{
+    uint16_t length = 0;
+    const uint8_t *ccc = NULL;
+
+    battary_lev = level;
+    if (bas_lvl_handle == 0) {
+        return;
+    }
+    esp_ble_gatts_set_attr_value(bas_lvl_handle, sizeof(level), &level);
+
+    // The CCC is auto-responded, so the stack holds one value shared by all connections
+    if (esp_ble_gatts_get_attr_value(bas_ccc_handle, &length, &ccc) != ESP_OK ||
+        length < sizeof(uint16_t) || (ccc[0] & 0x01) == 0) {
+        return;
+    }
+    for (uint8_t i_clcb = 0; i_clcb < HID_MAX_APPS; i_clcb++) {
+        hidd_clcb_t *p_clcb = &hidd_le_env.hidd_clcb[i_clcb];
+        if (p_clcb->in_use && p_clcb->connected) {
+            esp_ble_gatts_send_indicate(hidd_le_env.gatt_if, p_clcb->conn_id, bas_lvl_handle,
+                                        sizeof(level), &level, false);
+        }
+    }
+}
+
+void hidd_input_frame_dropped(uint16_t conn_id, uint16_t seq)
+{
+#if CONFIG_KBM_BLE_INPUT_SERVICE
+    uint16_t length = 0;
+    const uint8_t *ccc = NULL;
+
+    if (input_status_handle == 0) {
+        return;
+    }
+    input_status_val[0] = seq & 0xFF;
+    input_status_val[1] = HI_UINT16(seq);
+    esp_ble_gatts_set_attr_value(input_status_handle, sizeof(input_status_val), input_status_val);
+
+    // Shared by all connections like the battery level CCC, so a central that never subscribed
+    // has to poll the value instead
+    if (esp_ble_gatts_get_attr_value(input_status_ccc_handle, &length, &ccc) != ESP_OK ||
+        length < sizeof(uint16_t) || (ccc[0] & 0x01) == 0) {
+        return;
+    }
+    esp_ble_gatts_send_indicate(hidd_le_env.gatt_if, conn_id, input_status_handle,
+                                sizeof(input_status_val), input_status_val, false);
+#endif
+}
+
 static void hid_add_id_tbl(void)
 {
      // Mouse input report
       hid_rpt_map[0].id = hidReportRefMouseIn[0];
       hid_rpt_map[0].type = hidReportRefMouseIn[1];
       hid_rpt_map[0].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_VAL];
-      hid_rpt_map[0].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_VAL];
+      hid_rpt_map[0].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_MOUSE_IN_CCC];
       hid_rpt_map[0].mode = HID_PROTOCOL_MODE_REPORT;
 
       // Key input report
@@ -843,7 +1502,7 @@ static void hid_add_id_tbl(void)
       hid_rpt_map[4].id = hidReportRefKeyIn[0];
       hid_rpt_map[4].type = hidReportRefKeyIn[1];
       hid_rpt_map[4].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL];
-      hid_rpt_map[4].cccdHandle = 0;
+      hid_rpt_map[4].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_KB_IN_REPORT_NTF_CFG];
       hid_rpt_map[4].mode = HID_PROTOCOL_MODE_BOOT;
 
       // Boot keyboard output report
@@ -859,7 +1518,7 @@ static void hid_add_id_tbl(void)
       hid_rpt_map[6].id = hidReportRefMouseIn[0];
       hid_rpt_map[6].type = hidReportRefMouseIn[1];
       hid_rpt_map[6].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_VAL];
-      hid_rpt_map[6].cccdHandle = 0;
+      hid_rpt_map[6].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_BOOT_MOUSE_IN_REPORT_NTF_CFG];
       hid_rpt_map[6].mode = HID_PROTOCOL_MODE_BOOT;
 
       // Feature report
@@ -869,6 +1528,44 @@ static void hid_add_id_tbl(void)
       hid_rpt_map[7].cccdHandle = 0;
       hid_rpt_map[7].mode = HID_PROTOCOL_MODE_REPORT;
 
+      // Gamepad input report
+      hid_rpt_map[8].id = hidReportRefGamepadIn[0];
+      hid_rpt_map[8].type = hidReportRefGamepadIn[1];
+      hid_rpt_map[8].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_GAMEPAD_IN_VAL];
+      hid_rpt_map[8].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_GAMEPAD_IN_CCC];
+      hid_rpt_map[8].mode = HID_PROTOCOL_MODE_REPORT;
+
+      // Touchpad input report
+      hid_rpt_map[9].id = hidReportRefTouchpadIn[0];
+      hid_rpt_map[9].type = hidReportRefTouchpadIn[1];
+      hid_rpt_map[9].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_IN_VAL];
+      hid_rpt_map[9].cccdHandle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_IN_CCC];
+      hid_rpt_map[9].mode = HID_PROTOCOL_MODE_REPORT;
+
+      // Touchpad feature reports
+      hid_rpt_map[10].id = hidReportRefTouchpadCaps[0];
+      hid_rpt_map[10].type = hidReportRefTouchpadCaps[1];
+      hid_rpt_map[10].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_VAL];
+      hid_rpt_map[10].cccdHandle = 0;
+      hid_rpt_map[10].mode = HID_PROTOCOL_MODE_REPORT;
+
+      hid_rpt_map[11].id = hidReportRefTouchpadMode[0];
+      hid_rpt_map[11].type = hidReportRefTouchpadMode[1];
+      hid_rpt_map[11].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_VAL];
+      hid_rpt_map[11].cccdHandle = 0;
+      hid_rpt_map[11].mode = HID_PROTOCOL_MODE_REPORT;
+
+      hid_rpt_map[12].id = hidReportRefTouchpadSwitch[0];
+      hid_rpt_map[12].type = hidReportRefTouchpadSwitch[1];
+      hid_rpt_map[12].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_VAL];
+      hid_rpt_map[12].cccdHandle = 0;
+      hid_rpt_map[12].mode = HID_PROTOCOL_MODE_REPORT;
+
+      hid_rpt_map[13].id = hidReportRefTouchpadCert[0];
+      hid_rpt_map[13].type = hidReportRefTouchpadCert[1];
+      hid_rpt_map[13].handle = hidd_le_env.hidd_inst.att_tbl[HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_VAL];
+      hid_rpt_map[13].cccdHandle = 0;
+      hid_rpt_map[13].mode = HID_PROTOCOL_MODE_REPORT;
 
   // Setup report ID map
   hid_dev_register_reports(HID_NUM_REPORTS, hid_rpt_map);
@@ -0,0 +1,136 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "hid_stats.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+static atomic_uint_least32_t counters[HID_STAT_NUM];
+static atomic_uint_least32_t latency[HID_STATS_LATENCY_BUCKETS];
+
+static const char *const stat_names[HID_STAT_NUM] = {
+    [HID_STAT_RX_PASSKEY] = "rx.passkey",
+    [HID_STAT_RX_KEYBOARD] = "rx.keyboard",
+    [HID_STAT_RX_MOUSE] = "rx.mouse",
+    [HID_STAT_RX_COMMANDS] = "rx.commands",
+    [HID_STAT_RX_TYPING] = "rx.typing",
+    [HID_STAT_RX_FRAME] = "rx.frame",
+    [HID_STAT_DROP_PASSKEY] = "drop.passkey",
+    [HID_STAT_DROP_KEYBOARD] = "drop.keyboard",
+    [HID_STAT_DROP_MOUSE] = "drop.mouse",
+    [HID_STAT_DROP_COMMANDS] = "drop.commands",
+    [HID_STAT_DROP_TYPING] = "drop.typing",
+    [HID_STAT_DROP_FRAME] = "drop.frame",
+    [HID_STAT_FRAME_ERROR] = "frame.malformed",
+    [HID_STAT_HOLD_KEY_LANE] = "hold.key_lane",
+    [HID_STAT_HOLD_BUTTON_LANE] = "hold.button_lane",
+    [HID_STAT_SEND_FAIL] = "send.fail",
+    [HID_STAT_BOOT_DROP] = "send.boot_drop",
+    [HID_STAT_NOTIFY_OFF_DROP] = "send.notify_off",
+    [HID_STAT_CONGEST_EVT] = "congest.events",
+    [HID_STAT_CONGEST_HOLD] = "congest.holds",
+    [HID_STAT_CONNECT] = "conn.connect",
+    [HID_STAT_DISCONNECT] = "conn.disconnect",
+    [HID_STAT_RECONNECT] = "conn.reconnect",
+    [HID_STAT_PHY_2M] = "conn.phy_2m",
+    [HID_STAT_PHY_1M] = "conn.phy_1m",
+    [HID_STAT_TYPING_CACHE_HIT] = "typing.cache_hit",
+    [HID_STAT_TYPING_CACHE_MISS] = "typing.cache_miss",
+};
+
+static char sent_names[HID_STATS_MAX_RPT_ID + 1][12];
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void hid_stats_inc(hid_stat_t stat)
+{
+    if (stat < HID_STAT_NUM)
+    {
+        atomic_fetch_add_explicit(&counters[stat], 1, memory_order_relaxed);
+    }
+}
+
+void hid_stats_latency(uint32_t us)
+{
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+
+    if (bucket >= HID_STATS_LATENCY_BUCKETS)
+    {
+        bucket = HID_STATS_LATENCY_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&latency[bucket], 1, memory_order_relaxed);
+}
+
+void hid_stats_reset(void)
+{
+    for (int i = 0; i < HID_STAT_NUM; i++)
+    {
+        atomic_store_explicit(&counters[i], 0, memory_order_relaxed);
+    }
+    for (int i = 0; i < HID_STATS_LATENCY_BUCKETS; i++)
+    {
+        atomic_store_explicit(&latency[i], 0, memory_order_relaxed);
+    }
+}
+
+void hid_stats_snapshot(uint32_t *out)
+{
+    for (int i = 0; i < HID_STAT_NUM; i++)
+    {
+        out[i] = atomic_load_explicit(&counters[i], memory_order_relaxed);
+    }
+}
+
+const char *hid_stats_name(hid_stat_t stat)
+{
+    if (stat >= HID_STAT_SENT_RPT_ID_0 && stat <= HID_STAT_SENT_RPT_ID_LAST)
+    {
+        char *name = sent_names[stat - HID_STAT_SENT_RPT_ID_0];
+        if (name[0] == '\0')
+        {
+            snprintf(name, sizeof(sent_names[0]), "sent.id%d", stat - HID_STAT_SENT_RPT_ID_0);
+        }
+        return name;
+    }
+
+    return stat < HID_STAT_NUM && stat_names[stat] != NULL ? stat_names[stat] : "?";
+}
+
+void hid_stats_latency_snapshot(uint32_t *out)
+{
+    for (int i = 0; i < HID_STATS_LATENCY_BUCKETS; i++)
+    {
+        out[i] = atomic_load_explicit(&latency[i], memory_order_relaxed);
+    }
+}
+
+uint32_t hid_stats_latency_percentile(const uint32_t *buckets, uint32_t percentile)
+{
+    uint64_t total = 0;
+
+    for (int i = 0; i < HID_STATS_LATENCY_BUCKETS; i++)
+    {
+        total += buckets[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = (total * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < HID_STATS_LATENCY_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            return i == 0 ? 0 : (1u << i) - 1;
+        }
+    }
+    return (1u << (HID_STATS_LATENCY_BUCKETS - 1)) - 1;
+}
@@ -0,0 +1,88 @@
+#ifndef HID_STATS_H
+#define HID_STATS_H
+
+#include <stdint.h>
+
+/*
+    Pipeline counters. Every counter is a 32-bit atomic so producers on any task or core
+    can bump it without a lock; readers take a snapshot and work from that.
+*/
+
+/* Report IDs counted individually; see HID_RPT_ID_* in hidd_le_prf_int.h */
+#define HID_STATS_MAX_RPT_ID 7
+
+typedef enum
+{
+    /* Items taken off each input queue by the HID task */
+    HID_STAT_RX_PASSKEY,
+    HID_STAT_RX_KEYBOARD,
+    HID_STAT_RX_MOUSE,
+    HID_STAT_RX_COMMANDS,
+    HID_STAT_RX_TYPING,
+    HID_STAT_RX_FRAME,
+
+    /* Items a producer could not queue because the queue was full */
+    HID_STAT_DROP_PASSKEY,
+    HID_STAT_DROP_KEYBOARD,
+    HID_STAT_DROP_MOUSE,
+    HID_STAT_DROP_COMMANDS,
+    HID_STAT_DROP_TYPING,
+    HID_STAT_DROP_FRAME,
+    HID_STAT_FRAME_ERROR,
+
+    /*
+        Input events a full scheduler lane held back in their ring, counted on every retry
+        until the lane has room; nothing is lost, a high count means sustained back-pressure
+    */
+    HID_STAT_HOLD_KEY_LANE,
+    HID_STAT_HOLD_BUTTON_LANE,
+
+    /* Reports handed to the stack, indexed by report ID */
+    HID_STAT_SENT_RPT_ID_0,
+    HID_STAT_SENT_RPT_ID_LAST = HID_STAT_SENT_RPT_ID_0 + HID_STATS_MAX_RPT_ID,
+
+    HID_STAT_SEND_FAIL,
+    HID_STAT_BOOT_DROP,
+    HID_STAT_NOTIFY_OFF_DROP,
+    HID_STAT_CONGEST_EVT,
+    HID_STAT_CONGEST_HOLD,
+
+    HID_STAT_CONNECT,
+    HID_STAT_DISCONNECT,
+    HID_STAT_RECONNECT,
+    HID_STAT_PHY_2M,
+    HID_STAT_PHY_1M,
+
+    /* typing_plan() calls served from, or added to, the report sequence cache */
+    HID_STAT_TYPING_CACHE_HIT,
+    HID_STAT_TYPING_CACHE_MISS,
+
+    HID_STAT_NUM,
+} hid_stat_t;
+
+#define HID_STAT_SENT_RPT_ID(id) \
+    ((id) <= HID_STATS_MAX_RPT_ID ? (hid_stat_t)(HID_STAT_SENT_RPT_ID_0 + (id)) : HID_STAT_SENT_RPT_ID_LAST)
+
+/*
+    Ingest-to-dispatch latency of input events, in log2 buckets: bucket 0 counts 0 us,
+    bucket n counts [2^(n-1), 2^n) us and the last bucket everything above.
+*/
+#define HID_STATS_LATENCY_BUCKETS 20
+
+void hid_stats_inc(hid_stat_t stat);
+void hid_stats_latency(uint32_t us);
+void hid_stats_reset(void);
+
+/* Copies all counters into out, which holds HID_STAT_NUM entries */
+void hid_stats_snapshot(uint32_t *out);
+
+/* Short printable name, e.g. "rx.keyboard" or "sent.id2" */
+const char *hid_stats_name(hid_stat_t stat);
+
+/* Copies the latency buckets into out, which holds HID_STATS_LATENCY_BUCKETS entries */
+void hid_stats_latency_snapshot(uint32_t *out);
+
+/* Upper bound in us of the bucket holding the given percentile, 0 if there are no samples */
+uint32_t hid_stats_latency_percentile(const uint32_t *buckets, uint32_t percentile);
+
+#endif
@@ -0,0 +1,354 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_hidd_prf_api.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "hidd_le_prf_int.h"
+#include "hid_stats.h"
+#include "hid_tx_sched.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_TX"
+
+#define HID_TX_MAX_KEYS 6
+
+typedef struct
+{
+    uint8_t modifier;
+    uint8_t num_keys;
+    uint8_t keys[HID_TX_MAX_KEYS];
+} hid_tx_key_t;
+
+typedef enum
+{
+    HID_TX_BUTTON_MOUSE,
+    HID_TX_BUTTON_CONSUMER,
+} hid_tx_button_type_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t buttons;    /* mouse buttons or consumer usage */
+    int8_t dx;          /* motion carried with a mouse button report */
+    int8_t dy;
+    bool pressed;       /* consumer only */
+} hid_tx_button_t;
+
+typedef struct
+{
+    uint8_t head;
+    uint8_t count;
+} hid_tx_lane_t;
+
+typedef struct
+{
+    bool in_use;
+    uint16_t conn_id;
+
+    hid_tx_lane_t key_lane;
+    hid_tx_key_t keys[HID_TX_KEY_LANE_DEPTH];
+
+    hid_tx_lane_t button_lane;
+    hid_tx_button_t buttons[HID_TX_BUTTON_LANE_DEPTH];
+
+    /* Motion lane: one summed delta under the current button state */
+    uint8_t mouse_buttons;
+    int32_t motion_x;
+    int32_t motion_y;
+} hid_tx_conn_t;
+
+static hid_tx_conn_t tx_conns[HID_MAX_APPS];
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static hid_tx_conn_t *hid_tx_conn(uint16_t conn_id);
+static int8_t hid_tx_clamp(int32_t value);
+static bool hid_tx_congested(uint16_t conn_id);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+/* Slot of conn_id, claimed on first use. NULL when every slot belongs to another live link */
+static hid_tx_conn_t *hid_tx_conn(uint16_t conn_id)
+{
+    static uint16_t refused_conn_id = UINT16_MAX;
+    hid_tx_conn_t *free_slot = NULL;
+
+    for (int i = 0; i < HID_MAX_APPS; i++)
+    {
+        if (tx_conns[i].in_use && tx_conns[i].conn_id == conn_id)
+        {
+            return &tx_conns[i];
+        }
+        if (!tx_conns[i].in_use && free_slot == NULL)
+        {
+            free_slot = &tx_conns[i];
+        }
+    }
+
+    /* A closed link's reports can never be sent, so its slot is the only one safe to take over */
+    for (int i = 0; i < HID_MAX_APPS && free_slot == NULL; i++)
+    {
+        if (hidd_clcb_find(tx_conns[i].conn_id) == NULL)
+        {
+            free_slot = &tx_conns[i];
+        }
+    }
+
+    if (free_slot == NULL)
+    {
+        if (refused_conn_id != conn_id)
+        {
+            ESP_LOGE(TAG, "No report slot for conn_id %d, all %d in use", conn_id, HID_MAX_APPS);
+            refused_conn_id = conn_id;
+        }
+        return NULL;
+    }
+    memset(free_slot, 0, sizeof(hid_tx_conn_t));
+    free_slot->in_use = true;
+    free_slot->conn_id = conn_id;
+    return free_slot;
+}
+
+static int8_t hid_tx_clamp(int32_t value)
+{
+    if (value > 127)
+    {
+        return 127;
+    }
+    if (value < -127)
+    {
+        return -127;
+    }
+    return (int8_t)value;
+}
+
+static bool hid_tx_congested(uint16_t conn_id)
+{
+    hidd_clcb_t *p_clcb = hidd_clcb_find(conn_id);
+
+    if (p_clcb != NULL && p_clcb->congest)
+    {
+        hid_stats_inc(HID_STAT_CONGEST_HOLD);
+        return true;
+    }
+    return false;
+}
+
+void hid_tx_sched_reset(uint16_t conn_id)
+{
+    hid_tx_conn_t *conn = hid_tx_conn(conn_id);
+
+    if (conn == NULL)
+    {
+        return;
+    }
+    memset(conn, 0, sizeof(hid_tx_conn_t));
+    conn->in_use = true;
+    conn->conn_id = conn_id;
+}
+
+bool hid_tx_sched_push_key(uint16_t conn_id, uint8_t modifier, const uint8_t *keys, uint8_t num_keys)
+{
+    hid_tx_conn_t *conn = hid_tx_conn(conn_id);
+
+    if (conn == NULL)
+    {
+        return false;
+    }
+    if (num_keys > HID_TX_MAX_KEYS)
+    {
+        num_keys = HID_TX_MAX_KEYS;
+    }
+    if (conn->key_lane.count == HID_TX_KEY_LANE_DEPTH)
+    {
+        return false;
+    }
+
+    hid_tx_key_t *entry = &conn->keys[(conn->key_lane.head + conn->key_lane.count) % HID_TX_KEY_LANE_DEPTH];
+    entry->modifier = modifier;
+    entry->num_keys = num_keys;
+    memset(entry->keys, 0, sizeof(entry->keys));
+    memcpy(entry->keys, keys, num_keys);
+    conn->key_lane.count++;
+    return true;
+}
+
+static bool hid_tx_push_button(hid_tx_conn_t *conn, const hid_tx_button_t *button)
+{
+    if (conn == NULL || conn->button_lane.count == HID_TX_BUTTON_LANE_DEPTH)
+    {
+        return false;
+    }
+
+    conn->buttons[(conn->button_lane.head + conn->button_lane.count) % HID_TX_BUTTON_LANE_DEPTH] = *button;
+    conn->button_lane.count++;
+    return true;
+}
+
+bool hid_tx_sched_push_mouse(uint16_t conn_id, uint8_t buttons, int16_t dx, int16_t dy)
+{
+    hid_tx_conn_t *conn = hid_tx_conn(conn_id);
+
+    if (conn == NULL)
+    {
+        return false;
+    }
+    if (buttons == conn->mouse_buttons)
+    {
+        conn->motion_x += dx;
+        conn->motion_y += dy;
+        return true;
+    }
+
+    /*
+        A button change seals the motion made under the old button state so a drag ends
+        where it should. That motion rides on the button lane ahead of the change itself.
+    */
+    if (HID_TX_BUTTON_LANE_DEPTH - conn->button_lane.count < 2)
+    {
+        return false;
+    }
+
+    if (conn->motion_x != 0 || conn->motion_y != 0)
+    {
+        hid_tx_button_t sealed = {
+            .type = HID_TX_BUTTON_MOUSE,
+            .buttons = conn->mouse_buttons,
+            .dx = hid_tx_clamp(conn->motion_x),
+            .dy = hid_tx_clamp(conn->motion_y),
+        };
+        hid_tx_push_button(conn, &sealed);
+        conn->motion_x -= sealed.dx;
+        conn->motion_y -= sealed.dy;
+    }
+
+    /* Anything beyond one report's range stays pending and follows under the new state */
+    hid_tx_button_t change = {
+        .type = HID_TX_BUTTON_MOUSE,
+        .buttons = buttons,
+        .dx = hid_tx_clamp(dx),
+        .dy = hid_tx_clamp(dy),
+    };
+    hid_tx_push_button(conn, &change);
+    conn->motion_x += dx - change.dx;
+    conn->motion_y += dy - change.dy;
+    conn->mouse_buttons = buttons;
+    return true;
+}
+
+bool hid_tx_sched_push_consumer(uint16_t conn_id, uint8_t usage, bool pressed)
+{
+    hid_tx_button_t button = {
+        .type = HID_TX_BUTTON_CONSUMER,
+        .buttons = usage,
+        .pressed = pressed,
+    };
+
+    return hid_tx_push_button(hid_tx_conn(conn_id), &button);
+}
+
+bool hid_tx_sched_pending(uint16_t conn_id)
+{
+    hid_tx_conn_t *conn = hid_tx_conn(conn_id);
+
+    return conn != NULL && (conn->key_lane.count > 0 || conn->button_lane.count > 0 ||
+           conn->motion_x != 0 || conn->motion_y != 0);
+}
+
+uint8_t hid_tx_sched_key_space(uint16_t conn_id)
+{
+    hid_tx_conn_t *conn = hid_tx_conn(conn_id);
+
+    return conn == NULL ? 0 : HID_TX_KEY_LANE_DEPTH - conn->key_lane.count;
+}
+
+void hid_tx_sched_flush(uint16_t conn_id)
+{
+    hid_tx_conn_t *conn = hid_tx_conn(conn_id);
+    esp_err_t ret;
+
+    if (conn == NULL)
+    {
+        return;
+    }
+    if (hidd_clcb_find(conn_id) == NULL)
+    {
+        /* Link is gone; nothing queued for it will ever be deliverable */
+        if (hid_tx_sched_pending(conn_id))
+        {
+            ESP_LOGW(TAG, "conn_id %d closed, dropping queued reports", conn_id);
+        }
+        conn->in_use = false;
+        return;
+    }
+
+    while (conn->key_lane.count > 0)
+    {
+        if (hid_tx_congested(conn_id))
+        {
+            return;
+        }
+
+        hid_tx_key_t *entry = &conn->keys[conn->key_lane.head];
+        ret = esp_hidd_send_keyboard_value(conn_id, entry->modifier, entry->keys, entry->num_keys);
+        if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED)
+        {
+            ESP_LOGD(TAG, "Key report held, send failed: %s", esp_err_to_name(ret));
+            return;
+        }
+        conn->key_lane.head = (conn->key_lane.head + 1) % HID_TX_KEY_LANE_DEPTH;
+        conn->key_lane.count--;
+    }
+
+    while (conn->button_lane.count > 0)
+    {
+        if (hid_tx_congested(conn_id))
+        {
+            return;
+        }
+
+        hid_tx_button_t *entry = &conn->buttons[conn->button_lane.head];
+        if (entry->type == HID_TX_BUTTON_CONSUMER)
+        {
+            ret = esp_hidd_send_consumer_value(conn_id, entry->buttons, entry->pressed);
+        }
+        else
+        {
+            ret = esp_hidd_send_mouse_value(conn_id, entry->buttons, entry->dx, entry->dy);
+        }
+        if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED)
+        {
+            ESP_LOGD(TAG, "Button report held, send failed: %s", esp_err_to_name(ret));
+            return;
+        }
+        conn->button_lane.head = (conn->button_lane.head + 1) % HID_TX_BUTTON_LANE_DEPTH;
+        conn->button_lane.count--;
+    }
+
+    while (conn->motion_x != 0 || conn->motion_y != 0)
+    {
+        if (hid_tx_congested(conn_id))
+        {
+            return;
+        }
+
+        int8_t dx = hid_tx_clamp(conn->motion_x);
+        int8_t dy = hid_tx_clamp(conn->motion_y);
+        ret = esp_hidd_send_mouse_value(conn_id, conn->mouse_buttons, dx, dy);
+        if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED)
+        {
+            ESP_LOGD(TAG, "Motion held, send failed: %s", esp_err_to_name(ret));
+            return;
+        }
+        conn->motion_x -= dx;
+        conn->motion_y -= dy;
+    }
+}
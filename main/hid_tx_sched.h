@@ -0,0 +1,37 @@
+#ifndef HID_TX_SCHED_H
+#define HID_TX_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Outbound report scheduler. Reports are queued per connection into priority lanes and
+    sent by hid_tx_sched_flush() in lane order:
+
+    1. key     - every keyboard state change, in order, never merged
+    2. button  - mouse button and consumer control changes, in order
+    3. motion  - relative pointer motion, summed into one pending delta
+
+    Key releases therefore never wait behind pointer motion. While the link is congested
+    nothing is sent and motion keeps accumulating instead of queueing stale reports.
+*/
+
+#define HID_TX_KEY_LANE_DEPTH       16
+#define HID_TX_BUTTON_LANE_DEPTH    16
+
+void hid_tx_sched_reset(uint16_t conn_id);
+
+/* Returns false when the lane is full; flush and retry */
+bool hid_tx_sched_push_key(uint16_t conn_id, uint8_t modifier, const uint8_t *keys, uint8_t num_keys);
+bool hid_tx_sched_push_mouse(uint16_t conn_id, uint8_t buttons, int16_t dx, int16_t dy);
+bool hid_tx_sched_push_consumer(uint16_t conn_id, uint8_t usage, bool pressed);
+
+/* Sends queued reports in priority order until all lanes are empty or the link is congested */
+void hid_tx_sched_flush(uint16_t conn_id);
+
+bool hid_tx_sched_pending(uint16_t conn_id);
+
+/* Free entries in the key lane */
+uint8_t hid_tx_sched_key_space(uint16_t conn_id);
+
+#endif
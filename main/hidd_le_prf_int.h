@@ -23,7 +23,13 @@
 #include "esp_gap_ble_api.h"
 #include "hid_dev.h"
 
+/// Vendor output report carrying input frames. Next to the Precision Touchpad collection it would
+/// make the report map 529 bytes, over the 512 its characteristic holds; frames go to the input
+/// service instead (CONFIG_KBM_BLE_INPUT_SERVICE)
 #define SUPPORT_REPORT_VENDOR                 false
+#if (SUPPORT_REPORT_VENDOR == true)
+#error "SUPPORT_REPORT_VENDOR does not fit the report map next to the Precision Touchpad, use CONFIG_KBM_BLE_INPUT_SERVICE"
+#endif
 //HID BLE profile log tag
 #define HID_LE_PRF_TAG                        "HID_LE_PRF"
 
@@ -40,14 +46,31 @@
 
 #define HID_MAX_APPS                 1
 
+// Link defaults until the peer negotiates more
+#define HIDD_DEFAULT_MTU             23
+#define HIDD_DEFAULT_DATA_LEN        27
+// Largest LE Data Length Extension payload
+#define HIDD_MAX_DATA_LEN            251
+
+// PHY values as reported by the controller (HCI encoding)
+#define HIDD_PHY_1M                  1
+#define HIDD_PHY_2M                  2
+#define HIDD_PHY_CODED               3
+
 // Number of HID reports defined in the service
-#define HID_NUM_REPORTS          9
+#define HID_NUM_REPORTS          14
 
 // HID Report IDs for the service
 #define HID_RPT_ID_MOUSE_IN      1   // Mouse input report ID
 #define HID_RPT_ID_KEY_IN        2   // Keyboard input report ID
 #define HID_RPT_ID_CC_IN         3   //Consumer Control input report ID
 #define HID_RPT_ID_VENDOR_OUT    4   // Vendor output report ID
+#define HID_RPT_ID_GAMEPAD_IN    5   // Gamepad input report ID
+#define HID_RPT_ID_TOUCHPAD_IN       6   // Precision Touchpad input report ID
+#define HID_RPT_ID_TOUCHPAD_CAPS     7   // Touchpad contact count maximum and pad type feature report ID
+#define HID_RPT_ID_TOUCHPAD_MODE     8   // Touchpad input mode feature report ID
+#define HID_RPT_ID_TOUCHPAD_SWITCH   9   // Touchpad selective reporting feature report ID
+#define HID_RPT_ID_TOUCHPAD_CERT     10  // Touchpad device certification status feature report ID
 #define HID_RPT_ID_LED_OUT       0  // LED output report ID
 #define HID_RPT_ID_FEATURE       0  // Feature report ID
 
@@ -153,7 +176,33 @@ enum {
     HIDD_LE_IDX_REPORT_CC_IN_VAL,
     HIDD_LE_IDX_REPORT_CC_IN_CCC,
     HIDD_LE_IDX_REPORT_CC_IN_REP_REF,
-    
+
+    // Report gamepad input
+    HIDD_LE_IDX_REPORT_GAMEPAD_IN_CHAR,
+    HIDD_LE_IDX_REPORT_GAMEPAD_IN_VAL,
+    HIDD_LE_IDX_REPORT_GAMEPAD_IN_CCC,
+    HIDD_LE_IDX_REPORT_GAMEPAD_IN_REP_REF,
+
+    // Report touchpad input
+    HIDD_LE_IDX_REPORT_TOUCHPAD_IN_CHAR,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_IN_VAL,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_IN_CCC,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_IN_REP_REF,
+
+    // Touchpad feature reports
+    HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_CHAR,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_VAL,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_CAPS_REP_REF,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_CHAR,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_VAL,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_MODE_REP_REF,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_CHAR,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_VAL,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_SWITCH_REP_REF,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_CHAR,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_VAL,
+    HIDD_LE_IDX_REPORT_TOUCHPAD_CERT_REP_REF,
+
     // Boot Keyboard Input Report
     HIDD_LE_IDX_BOOT_KB_IN_REPORT_CHAR,
     HIDD_LE_IDX_BOOT_KB_IN_REPORT_VAL,
@@ -260,6 +309,15 @@ typedef struct {
     esp_bd_addr_t         remote_bda;
     uint32_t                  trans_id;
     uint8_t                    cur_srvc_id;
+    uint8_t                    proto_mode;
+    uint16_t                  mtu;              // negotiated ATT MTU
+    uint16_t                  tx_octets;        // LL payload per packet, device to host
+    uint16_t                  rx_octets;        // LL payload per packet, host to device
+    uint8_t                    tx_phy;
+    uint8_t                    rx_phy;
+    bool                        suspended;        // host wrote Suspend to the Control Point
+    uint16_t                  notify_off;       // bit per hid_rpt_map entry whose CCCD the host cleared
+    uint16_t                  input_frames;     // frames written to the input service, numbers the next one
 
 } hidd_clcb_t;
 
@@ -321,6 +379,9 @@ typedef struct {
     hidd_inst_t                  hidd_inst;
     esp_hidd_event_cb_t          hidd_cb;
     uint8_t                      inst_id;
+    uint16_t                     dle_conn_id;   // connection of the last data length request
+    uint8_t                      touchpad_mode;     // input mode feature the host last wrote
+    uint8_t                      touchpad_switch;   // surface and button switches the host last wrote
 } hidd_le_env_t;
 
 extern hidd_le_env_t hidd_le_env;
@@ -331,12 +392,25 @@ void hidd_clcb_alloc (uint16_t conn_id, esp_bd_addr_t bda);
 
 bool hidd_clcb_dealloc (uint16_t conn_id);
 
+hidd_clcb_t *hidd_clcb_find(uint16_t conn_id);
+
+hidd_clcb_t *hidd_clcb_find_by_bda(esp_bd_addr_t bda);
+
+uint8_t hidd_clcb_proto_mode(uint16_t conn_id);
+
+/// True if the host on conn_id turned off notifications of hid_rpt_map entry rpt
+bool hidd_clcb_notify_off(uint16_t conn_id, uint8_t rpt);
+
 void hidd_le_create_service(esp_gatt_if_t gatts_if);
 
 void hidd_set_attr_value(uint16_t handle, uint16_t val_len, const uint8_t *value);
 
 void hidd_get_attr_value(uint16_t handle, uint16_t *length, uint8_t **value);
 
+void hidd_set_battery_level(uint8_t level);
+
+void hidd_input_frame_dropped(uint16_t conn_id, uint16_t seq);
+
 esp_err_t hidd_register_cb(void);
 
 
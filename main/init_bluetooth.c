@@ -10,12 +10,26 @@
 #include "esp_bt_main.h"
 #include "esp_hidd_prf_api.h"
 #include "esp_gap_ble_api.h"
+#include "esp_timer.h"
 #include <string.h>
 
 #include "ble_kbm_types.h"
 #include "commands.h"
 
 #include "hid_dev.h"
+#include "hid_tx_sched.h"
+#include "hid_stats.h"
+#include "input_ring.h"
+#include "capture.h"
+#include "input_frame.h"
+#include "phy_policy.h"
+#include "boot_time.h"
+#include "resume.h"
+#include "power.h"
+#include "gamepad_stream.h"
+#include "led_events.h"
+#include "typing.h"
+#include "accel.h"
 
 /******************************************************************************
  * File variables
@@ -43,9 +57,34 @@ static uint8_t hidd_service_uuid128[] = {
     0x00,
 };
 
+/* High duty cycle directed advertising is stopped by the controller after 1.28 s */
+#define DIRECTED_ADV_TIMEOUT_MS 1300
+
+/* Retry period while reports are held back by congestion or a full stack buffer */
+#define HID_TASK_RETRY_MS 10
+
 static bool sec_conn = false;
+static bool connected = false;
 static uint16_t hid_conn_id = 0;
 
+/* Identity of the bonded host and the link parameters, saved before deep sleep */
+static esp_bd_addr_t peer_identity;
+static esp_ble_addr_type_t peer_identity_type;
+static bool has_peer_identity = false;
+static uint16_t conn_int, conn_latency, conn_timeout;
+
+/* Set on a deep sleep wake until the first link is up */
+static bool resuming = false;
+static esp_timer_handle_t directed_adv_timer;
+
+/* Advertising starts once both are set, so no central connects before the HID service exists */
+static bool adv_data_set = false;
+static bool hid_service_started = false;
+
+/* Last peer seen, to tell a reconnect from a new central */
+static esp_bd_addr_t last_peer_bda;
+static bool has_last_peer = false;
+
 static esp_bd_addr_t passkey_requester_addr;
 
 static esp_ble_adv_params_t hidd_adv_params = {
@@ -79,9 +118,11 @@ static esp_ble_adv_data_t hidd_adv_data = {
  * External variables
  *****************************************************************************/
 extern QueueHandle_t passkey_queue;
-extern QueueHandle_t keyboard_queue;
-extern QueueHandle_t mouse_queue;
+extern input_ring_t console_input_ring;
+extern input_ring_t ble_input_ring;
+extern input_ring_t script_input_ring;
 extern QueueHandle_t commands_queue;
+extern QueueHandle_t typing_queue;
 
 /******************************************************************************
  * External functions
@@ -93,12 +134,22 @@ extern QueueHandle_t commands_queue;
 static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *param);
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
 static char *esp_auth_req_to_str(esp_ble_auth_req_t auth_req);
+static bool handle_input_event(const input_event_t *event);
+static bool drain_input_ring(input_ring_t *ring);
+static void bluetooth_start_advertising_when_ready(void);
+static void bluetooth_resume_advertising(const resume_state_t *resume);
+static void bluetooth_resume_link(esp_bd_addr_t bda);
+static void directed_adv_timeout(void *arg);
 
 void initialise_bluetooth();
 bool has_ble_secure_connection();
+const char *bluetooth_phy_to_str(uint8_t phy);
+uint16_t bluetooth_get_conn_id();
+uint16_t bluetooth_get_conn_interval();
 void bluetooth_send_passkey(uint32_t passkey);
 void bluetooth_show_bonded_devices(void);
 void bluetooth_send_character(char);
+void bluetooth_prepare_sleep(resume_state_t *state);
 
 /******************************************************************************
  * Function implementation
@@ -111,9 +162,7 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
     {
         if (param->init_finish.state == ESP_HIDD_INIT_OK)
         {
-            //esp_bd_addr_t rand_addr = {0x04,0x11,0x11,0x11,0x11,0x05};
-            esp_ble_gap_set_device_name(HIDD_DEVICE_NAME);
-            esp_ble_gap_config_adv_data(&hidd_adv_data);
+            boot_time_mark(BOOT_MARK_GATT_REGISTERED);
         }
         break;
     }
@@ -121,19 +170,40 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
     {
         break;
     }
+    case ESP_HIDD_EVENT_BLE_SERVICE_STARTED:
+        hid_service_started = true;
+        bluetooth_start_advertising_when_ready();
+        break;
     case ESP_HIDD_EVENT_DEINIT_FINISH:
         break;
     case ESP_HIDD_EVENT_BLE_CONNECT:
     {
         ESP_LOGI(TAG, "ESP_HIDD_EVENT_BLE_CONNECT");
         hid_conn_id = param->connect.conn_id;
+        connected = true;
+        boot_time_mark(BOOT_MARK_CONNECTED);
+        if (resuming)
+        {
+            bluetooth_resume_link(param->connect.remote_bda);
+        }
 
+        hid_stats_inc(HID_STAT_CONNECT);
+        if (has_last_peer && memcmp(last_peer_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t)) == 0)
+        {
+            hid_stats_inc(HID_STAT_RECONNECT);
+        }
+        memcpy(last_peer_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+        has_last_peer = true;
         break;
     }
     case ESP_HIDD_EVENT_BLE_DISCONNECT:
     {
         sec_conn = false;
+        connected = false;
         ESP_LOGI(TAG, "ESP_HIDD_EVENT_BLE_DISCONNECT");
+        hid_stats_inc(HID_STAT_DISCONNECT);
+        gamepad_stream_stop();
+        accel_clear_peer();
         esp_ble_gap_start_advertising(&hidd_adv_params);
 
         disable_led_notifications();
@@ -141,22 +211,36 @@ static void hidd_event_callback(esp_hidd_cb_event_t event, esp_hidd_cb_param_t *
     }
     case ESP_HIDD_EVENT_BLE_VENDOR_REPORT_WRITE_EVT:
     {
-        ESP_LOGI(TAG, "%s, ESP_HIDD_EVENT_BLE_VENDOR_REPORT_WRITE_EVT", __func__);
-        ESP_LOG_BUFFER_HEX(TAG, param->vendor_write.data, param->vendor_write.length);
+        ESP_LOGD(TAG, "%s, ESP_HIDD_EVENT_BLE_VENDOR_REPORT_WRITE_EVT", __func__);
+        /* The vendor output report carries the same frames as the input service */
+        input_frame_parse(param->vendor_write.data, param->vendor_write.length, &ble_input_ring);
         break;
     }
-    case ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT:
+    case ESP_HIDD_EVENT_BLE_INPUT_FRAME_WRITE_EVT:
     {
-        uint8_t value = param->led_write.data;
-        if (value & 1 << 0) {
-            ESP_LOGI(__func__, "Num lock is on");
+        if (!input_frame_parse(param->input_frame.data, param->input_frame.length, &ble_input_ring))
+        {
+            esp_hidd_input_frame_dropped(param->input_frame.conn_id, param->input_frame.seq);
         }
-        if (value & 1<< 1) {
-            ESP_LOGI(__func__, "Caps lock is on");
+        break;
+    }
+    case ESP_HIDD_EVENT_BLE_SUSPEND:
+    {
+        /* A sleeping host has no use for gamepad reports; stop waking up every connection interval */
+        if (param->suspend.conn_id == hid_conn_id)
+        {
+            gamepad_stream_suspend(param->suspend.suspended);
         }
-        if (value & 1<< 2) {
-            ESP_LOGI(__func__, "Scroll lock is on");
+        break;
+    }
+    case ESP_HIDD_EVENT_BLE_LED_REPORT_WRITE_EVT:
+    {
+        if (param->led_write.length < 1 || param->led_write.data == NULL)
+        {
+            ESP_LOGE(TAG, "Empty LED report write");
+            break;
         }
+        led_events_publish(param->led_write.conn_id, param->led_write.data[0]);
         break;
     }
     default:
@@ -170,8 +254,19 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
     switch (event)
     {
     case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
-        ESP_LOGI(TAG, "Started advertising...");
-        esp_ble_gap_start_advertising(&hidd_adv_params);
+        boot_time_mark(BOOT_MARK_ADV_DATA);
+        adv_data_set = true;
+        bluetooth_start_advertising_when_ready();
+        break;
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+        if (param->adv_start_cmpl.status == ESP_BT_STATUS_SUCCESS)
+        {
+            boot_time_mark(BOOT_MARK_ADVERTISING);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Advertising failed to start: %d", param->adv_start_cmpl.status);
+        }
         break;
     case ESP_GAP_BLE_SEC_REQ_EVT:
         for (int i = 0; i < ESP_BD_ADDR_LEN; i++)
@@ -203,12 +298,62 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
         else
         {
             ESP_LOGI(TAG, "auth mode = %s", esp_auth_req_to_str(param->ble_security.auth_cmpl.auth_mode));
+            memcpy(peer_identity, param->ble_security.auth_cmpl.bd_addr, sizeof(esp_bd_addr_t));
+            peer_identity_type = param->ble_security.auth_cmpl.addr_type;
+            has_peer_identity = true;
+            accel_set_peer(peer_identity);
+        }
+        /* The bond list has not changed across a sleep, skip reading it back */
+        if (!resuming)
+        {
+            bluetooth_show_bonded_devices();
         }
-        bluetooth_show_bonded_devices();
+        resuming = false;
 
         enable_led_notifications();
+        if (param->ble_security.auth_cmpl.success)
+        {
+            boot_time_mark(BOOT_MARK_ENCRYPTED);
+            gamepad_stream_start(hid_conn_id);
+        }
+        break;
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+        ESP_LOGI(TAG, "Connection interval: %d x 1.25 ms, latency: %d",
+                 param->update_conn_params.conn_int, param->update_conn_params.latency);
+        gamepad_stream_set_interval(param->update_conn_params.conn_int);
+        conn_int = param->update_conn_params.conn_int;
+        conn_latency = param->update_conn_params.latency;
+        conn_timeout = param->update_conn_params.timeout;
+        break;
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+        if (param->pkt_data_lenth_cmpl.status != ESP_BT_STATUS_SUCCESS)
+        {
+            ESP_LOGW(TAG, "Data length update failed, status %d", param->pkt_data_lenth_cmpl.status);
+            break;
+        }
+        ESP_LOGI(TAG, "Data length: tx %d, rx %d bytes",
+                 param->pkt_data_lenth_cmpl.params.tx_len, param->pkt_data_lenth_cmpl.params.rx_len);
+        esp_hidd_set_data_len(param->pkt_data_lenth_cmpl.params.tx_len, param->pkt_data_lenth_cmpl.params.rx_len);
+        break;
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+    {
+        uint8_t tx_phy, rx_phy;
+
+        if (phy_policy_update(param->phy_update.status == ESP_BT_STATUS_SUCCESS, param->phy_update.tx_phy,
+                              param->phy_update.rx_phy, &tx_phy, &rx_phy))
+        {
+            ESP_LOGI(TAG, "PHY: tx %s, rx %s", bluetooth_phy_to_str(tx_phy), bluetooth_phy_to_str(rx_phy));
+        }
+        else
+        {
+            ESP_LOGW(TAG, "PHY update failed, status %d, staying on 1M", param->phy_update.status);
+        }
+        esp_hidd_set_phy(param->phy_update.bda, tx_phy, rx_phy);
         break;
     }
+#endif
+    }
 }
 
 static char *esp_auth_req_to_str(esp_ble_auth_req_t auth_req)
@@ -281,6 +426,7 @@ void bluetooth_delete_all_bondings(void)
     }
 
     free(dev_list);
+    accel_forget_all();
     ESP_LOGI(TAG, "All bondings deleted");
 }
 
@@ -303,6 +449,7 @@ void initialise_bluetooth()
         ESP_LOGE(TAG, "%s enable controller failed\n", __func__);
         ESP_ERROR_CHECK(ret);
     }
+    boot_time_mark(BOOT_MARK_CONTROLLER);
 
     ret = esp_bluedroid_init();
     if (ret)
@@ -317,6 +464,7 @@ void initialise_bluetooth()
         ESP_LOGE(TAG, "%s init bluedroid failed\n", __func__);
         ESP_ERROR_CHECK(ret);
     }
+    boot_time_mark(BOOT_MARK_BLUEDROID);
 
     if ((ret = esp_hidd_profile_init()) != ESP_OK)
     {
@@ -328,8 +476,22 @@ void initialise_bluetooth()
     ESP_LOGI(TAG, "Registering callbacks...");
     ///register the callback function to the gap module
     esp_ble_gap_register_callback(gap_event_handler);
+    /*
+        Advertising data only needs GAP, so it goes out before the GATT app registers and the
+        attribute tables are built. Advertising itself waits for the HID service as well.
+    */
+    //esp_bd_addr_t rand_addr = {0x04,0x11,0x11,0x11,0x11,0x05};
+    bluetooth_resume_advertising(resume_get());
+    esp_ble_gap_set_device_name(HIDD_DEVICE_NAME);
+    esp_ble_gap_config_adv_data(&hidd_adv_data);
     esp_hidd_register_callbacks(hidd_event_callback);
 
+    /* The central picks the final MTU in its exchange request; this is the most we accept */
+    if ((ret = esp_ble_gatt_set_local_mtu(CONFIG_KBM_LOCAL_MTU)) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "%s set local MTU failed: %s", __func__, esp_err_to_name(ret));
+    }
+
     ESP_LOGI(TAG, "Setting security config...");
     /* set the security iocap & auth_req & key size & init key response key parameters to the stack*/
     esp_ble_auth_req_t auth_req = ESP_LE_AUTH_REQ_SC_MITM_BOND; //bonding with peer device after authentication
@@ -346,6 +508,125 @@ void initialise_bluetooth()
     and the init key means which key you can distribute to the slave. */
     esp_ble_gap_set_security_param(ESP_BLE_SM_SET_INIT_KEY, &init_key, sizeof(uint8_t));
     esp_ble_gap_set_security_param(ESP_BLE_SM_SET_RSP_KEY, &rsp_key, sizeof(uint8_t));
+
+    gamepad_stream_init();
+    typing_init();
+    if (resuming && resume_get()->conn_int != 0)
+    {
+        gamepad_stream_set_interval(resume_get()->conn_int);
+    }
+}
+
+/* HCI PHY encoding, same on every controller */
+const char *bluetooth_phy_to_str(uint8_t phy)
+{
+    switch (phy)
+    {
+    case 1:
+        return "1M";
+    case 2:
+        return "2M";
+    case 3:
+        return "Coded";
+    default:
+        return "?";
+    }
+}
+
+/*
+    Both callbacks run on the Bluetooth task, so whichever of the advertising data and the HID
+    service finishes last starts advertising
+*/
+static void bluetooth_start_advertising_when_ready(void)
+{
+    if (adv_data_set && hid_service_started)
+    {
+        ESP_LOGI(TAG, "Started advertising...");
+        esp_ble_gap_start_advertising(&hidd_adv_params);
+    }
+}
+
+/*
+    After a deep sleep wake, advertise directly to the last host so it reconnects without a
+    scan. Must run before advertising starts.
+*/
+static void bluetooth_resume_advertising(const resume_state_t *resume)
+{
+    if (resume == NULL || !resume->has_peer)
+    {
+        return;
+    }
+
+    resuming = true;
+    memcpy(peer_identity, resume->peer_bda, sizeof(esp_bd_addr_t));
+    peer_identity_type = resume->peer_addr_type;
+    has_peer_identity = true;
+
+    hidd_adv_params.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+    memcpy(hidd_adv_params.peer_addr, resume->peer_bda, sizeof(esp_bd_addr_t));
+    hidd_adv_params.peer_addr_type = resume->peer_addr_type;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &directed_adv_timeout,
+        .name = "directed_adv"};
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &directed_adv_timer));
+    ESP_ERROR_CHECK(esp_timer_start_once(directed_adv_timer, DIRECTED_ADV_TIMEOUT_MS * 1000));
+    ESP_LOGI(TAG, "Advertising directly to the last host");
+}
+
+/* Hosts using a resolvable private address ignore directed advertising; fall back to everyone */
+static void directed_adv_timeout(void *arg)
+{
+    hidd_adv_params.adv_type = ADV_TYPE_IND;
+    if (!connected && adv_data_set && hid_service_started)
+    {
+        ESP_LOGI(TAG, "Last host did not answer, advertising to all");
+        esp_ble_gap_stop_advertising();
+        esp_ble_gap_start_advertising(&hidd_adv_params);
+    }
+}
+
+/* Ask for the parameters the link ran with before sleep instead of waiting for the host */
+static void bluetooth_resume_link(esp_bd_addr_t bda)
+{
+    const resume_state_t *resume = resume_get();
+
+    if (resume == NULL || resume->conn_int == 0)
+    {
+        return;
+    }
+
+    esp_ble_conn_update_params_t conn_params = {
+        .min_int = resume->conn_int,
+        .max_int = resume->conn_int,
+        .latency = resume->latency,
+        .timeout = resume->supervision_timeout,
+    };
+    memcpy(conn_params.bda, bda, sizeof(esp_bd_addr_t));
+    esp_ble_gap_update_conn_params(&conn_params);
+}
+
+void bluetooth_prepare_sleep(resume_state_t *state)
+{
+    if (has_peer_identity)
+    {
+        memcpy(state->peer_bda, peer_identity, sizeof(esp_bd_addr_t));
+        state->peer_addr_type = peer_identity_type;
+        state->has_peer = true;
+    }
+    state->conn_int = conn_int;
+    state->latency = conn_latency;
+    state->supervision_timeout = conn_timeout;
+
+    /* A clean disconnect lets the host release held keys now rather than on supervision timeout */
+    if (connected)
+    {
+        esp_ble_gap_disconnect(last_peer_bda);
+    }
+    else
+    {
+        esp_ble_gap_stop_advertising();
+    }
 }
 
 bool has_ble_secure_connection()
@@ -353,6 +634,17 @@ bool has_ble_secure_connection()
     return sec_conn;
 }
 
+uint16_t bluetooth_get_conn_id()
+{
+    return hid_conn_id;
+}
+
+/* In 1.25 ms units; the default until the central reports its own */
+uint16_t bluetooth_get_conn_interval()
+{
+    return conn_int != 0 ? conn_int : GAMEPAD_STREAM_DEFAULT_CONN_INT;
+}
+
 void bluetooth_send_passkey(uint32_t passkey)
 {
     ESP_LOGI(TAG, "Replying with passkey: %06d", passkey);
@@ -361,69 +653,155 @@ void bluetooth_send_passkey(uint32_t passkey)
 
 void bluetooth_send_character(char c)
 {
-    uint8_t kbdcmd[] = {28};
-    esp_hidd_send_keyboard_value(hid_conn_id, 0, kbdcmd, 1);
-    kbdcmd[0] = 0;
-    esp_hidd_send_keyboard_value(hid_conn_id, 0, kbdcmd, 1);
+    char text[] = {c, '\0'};
+    typing_type_string(hid_conn_id, text);
+}
+
+/*
+    Queues an event on the scheduler lanes. Returns false, with nothing queued, when its lane
+    is full; the caller leaves the event in its ring and retries it after a flush.
+*/
+static bool handle_input_event(const input_event_t *event)
+{
+    bool queued = false;
+
+    switch (event->type)
+    {
+    case INPUT_EVENT_KEYBOARD:
+    {
+        ESP_LOGD(TAG, "modifier: %d", event->keyboard.modifier);
+        ESP_LOGD(TAG, "keycode: %d", event->keyboard.keycode);
+
+        /*
+            Press and release go in together: pushing the press alone into the last free
+            slot and failing the release left the key down on the host until the next tap.
+        */
+        if (hid_tx_sched_key_space(hid_conn_id) < 2)
+        {
+            break;
+        }
+        uint8_t modifier = event->keyboard.modifier;
+        uint8_t kbdcmd[] = {event->keyboard.keycode};
+        hid_tx_sched_push_key(hid_conn_id, modifier, kbdcmd, 1);
+        kbdcmd[0] = 0;
+        queued = hid_tx_sched_push_key(hid_conn_id, modifier, kbdcmd, 1);
+        break;
+    }
+    case INPUT_EVENT_MOUSE:
+        queued = hid_tx_sched_push_mouse(hid_conn_id, event->mouse.mouse_buttons,
+                                         event->mouse.movement_x, event->mouse.movement_y);
+        break;
+    case INPUT_EVENT_KEY_REPORT:
+    {
+        uint8_t keycode = event->keyboard.keycode;
+        queued = hid_tx_sched_push_key(hid_conn_id, event->keyboard.modifier, &keycode, keycode != 0);
+        break;
+    }
+    case INPUT_EVENT_CONSUMER:
+        queued = hid_tx_sched_push_consumer(hid_conn_id, event->consumer.usage, event->consumer.pressed);
+        break;
+    default:
+        /* Nothing to queue; let it go rather than block the ring */
+        return true;
+    }
+
+    if (!queued)
+    {
+        bool key = event->type == INPUT_EVENT_KEYBOARD || event->type == INPUT_EVENT_KEY_REPORT;
+        ESP_LOGD(TAG, "%s lane full, event held", key ? "Key" : "Button");
+        hid_stats_inc(key ? HID_STAT_HOLD_KEY_LANE : HID_STAT_HOLD_BUTTON_LANE);
+        return false;
+    }
+
+    hid_stats_latency((uint32_t)esp_timer_get_time() - event->timestamp_us);
+    capture_record(event);
+    if (event->type != INPUT_EVENT_CONSUMER)
+    {
+        hid_stats_inc(event->type == INPUT_EVENT_MOUSE ? HID_STAT_RX_MOUSE : HID_STAT_RX_KEYBOARD);
+    }
+    return true;
+}
+
+/* Queues a ring's events in order; one the lanes refuse stays first in the ring. False if held */
+static bool drain_input_ring(input_ring_t *ring)
+{
+    input_event_t event;
+
+    while (input_ring_peek(ring, &event))
+    {
+        if (!handle_input_event(&event))
+        {
+            return false;
+        }
+        input_ring_skip(ring);
+    }
+    return true;
 }
 
 void handle_bluetooth_task()
 {
+    input_ring_set_consumer(&console_input_ring, xTaskGetCurrentTaskHandle());
+    input_ring_set_consumer(&ble_input_ring, xTaskGetCurrentTaskHandle());
+    input_ring_set_consumer(&script_input_ring, xTaskGetCurrentTaskHandle());
+
     while (1)
     {
-        if (passkey_queue != 0)
+        /*
+            A full lane holds its ring back instead of dropping the event: flush, and drain
+            again while the flush makes room. A congested link leaves the rings full, which
+            is what makes the script task wait and what drops BLE frames that no longer fit.
+        */
+        while (1)
         {
-            uint32_t passkey_value;
-
-            if (xQueueReceive(passkey_queue, &passkey_value, (TickType_t)10))
+            bool drained = drain_input_ring(&console_input_ring);
+            drained = drain_input_ring(&ble_input_ring) && drained;
+            drained = drain_input_ring(&script_input_ring) && drained;
+            if (drained)
             {
-                ESP_LOGI(TAG, "Received value %06d", passkey_value);
+                break;
+            }
 
-                bluetooth_send_passkey(passkey_value);
+            uint8_t space = hid_tx_sched_key_space(hid_conn_id);
+            bool button_pending = hid_tx_sched_pending(hid_conn_id);
+            hid_tx_sched_flush(hid_conn_id);
+            if (hid_tx_sched_key_space(hid_conn_id) == space &&
+                hid_tx_sched_pending(hid_conn_id) == button_pending)
+            {
+                break;
             }
         }
 
-        if (keyboard_queue != 0)
+        if (passkey_queue != 0)
         {
-            keyboard_t key_value;
-            if (xQueueReceive(keyboard_queue, &key_value, (TickType_t)10))
-            {
-                ESP_LOGI(TAG, "Received keyboard value");
-
-                ESP_LOGD(TAG, "modifier: %d", key_value.modifier);
-                ESP_LOGD(TAG, "keycode: %d", key_value.keycode);
+            uint32_t passkey_value;
 
-                uint8_t modifier = key_value.modifier;
-                uint8_t keycode = key_value.keycode;
+            if (xQueueReceive(passkey_queue, &passkey_value, (TickType_t)0))
+            {
+                hid_stats_inc(HID_STAT_RX_PASSKEY);
+                ESP_LOGI(TAG, "Received value %06d", passkey_value);
 
-                uint8_t kbdcmd[] = {keycode};
-                esp_hidd_send_keyboard_value(hid_conn_id, modifier, kbdcmd, 1);
-                kbdcmd[0] = 0;
-                esp_hidd_send_keyboard_value(hid_conn_id, modifier, kbdcmd, 1);
-                ESP_LOGI(TAG, "Sent keycode to client");
+                bluetooth_send_passkey(passkey_value);
             }
         }
 
-        if (mouse_queue != 0)
+        if (typing_queue != 0)
         {
-            mouse_t mouse_data;
-            if (xQueueReceive(mouse_queue, &mouse_data, (TickType_t)10))
+            char *text;
+            if (xQueueReceive(typing_queue, &text, (TickType_t)0))
             {
-                uint8_t buttons = mouse_data.mouse_buttons;
-                int8_t x = mouse_data.movement_x;
-                int8_t y = mouse_data.movement_y;
-
-                esp_hidd_send_mouse_value(hid_conn_id, buttons, x, y);
-                ESP_LOGI(TAG, "Sent mouse data to client");
+                hid_stats_inc(HID_STAT_RX_TYPING);
+                size_t reports = typing_type_string(hid_conn_id, text);
+                ESP_LOGI(TAG, "Typed %u characters in %u reports", (unsigned)strlen(text), (unsigned)reports);
+                free(text);
             }
         }
 
         if (commands_queue != 0)
         {
             uint8_t command;
-            uint8_t led_value;
-            if (xQueueReceive(commands_queue, &command, (TickType_t)10))
+            if (xQueueReceive(commands_queue, &command, (TickType_t)0))
             {
+                hid_stats_inc(HID_STAT_RX_COMMANDS);
                 ESP_LOGI(TAG, "Command received");
                 switch (command)
                 {
@@ -433,12 +811,19 @@ void handle_bluetooth_task()
                 case LIST_BONDINGS:
                     bluetooth_show_bonded_devices();
                     break;
-                case GET_LED:
-                    led_value = esp_hidd_get_led_value();
-                    ESP_LOGI(TAG, "LEDs: %x", led_value);
-                    break;
                 }
             }
         }
+
+        hid_tx_sched_flush(hid_conn_id);
+
+        /*
+            Every producer notifies us, so with nothing left to send we block indefinitely and
+            let the CPU scale down or sleep. Held-back reports are retried on a timeout.
+        */
+        bool pending = hid_tx_sched_pending(hid_conn_id);
+        power_set_busy(pending);
+        ulTaskNotifyTake(pdTRUE, pending ? pdMS_TO_TICKS(HID_TASK_RETRY_MS) : portMAX_DELAY);
+        power_set_busy(true);
     }
 }
\ No newline at end of file
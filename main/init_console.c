@@ -3,19 +3,41 @@
  *****************************************************************************/
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/task.h"
 
 #include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
 #include "esp_console.h"
 #include "esp_vfs_dev.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "driver/uart.h"
 #include "linenoise/linenoise.h"
 #include "argtable3/argtable3.h"
 
 #include "hid_dev.h"
+#include "hid_stats.h"
+#include "input_ring.h"
+#include "input_bench.h"
+#include "input_text.h"
+#include "power.h"
+#include "battery.h"
+#include "boot_time.h"
+#include "resume.h"
+#include "script.h"
+#include "macro_store.h"
+#include "capture.h"
+#include "accel.h"
+#include "typing_unicode.h"
+#include "esp_sleep.h"
+#include "driver/rtc_io.h"
+#include "task_layout.h"
 #include "ble_kbm_types.h"
 #include "commands.h"
+#include "gamepad_stream.h"
+#include "led_events.h"
 
 /******************************************************************************
  * File variables
@@ -24,6 +46,12 @@
 
 const char *prompt = LOG_COLOR_I "> " LOG_RESET_COLOR;
 
+/* Terminal failed the escape sequence probe; kept across deep sleep so the wake skips it */
+static bool console_dumb = false;
+
+/* Lines added with 'script add', compiled on 'script run' */
+static char *script_source = NULL;
+
 /** Arguments used by 'passkey' function */
 static struct
 {
@@ -47,19 +75,62 @@ static struct
     struct arg_end *end;
 } mouse_args;
 
+static struct
+{
+    struct arg_int *buttons;
+    struct arg_int *hat;
+    struct arg_int *axes;
+    struct arg_end *end;
+} gamepad_args;
+
+static struct
+{
+    struct arg_lit *reset;
+    struct arg_int *rate;
+    struct arg_end *end;
+} stats_args;
+
+static struct
+{
+    struct arg_str *test;
+    struct arg_int *count;
+    struct arg_end *end;
+} bench_args;
+
+static struct
+{
+    struct arg_int *max_freq;
+    struct arg_int *min_freq;
+    struct arg_int *light_sleep;
+    struct arg_end *end;
+} pm_args;
+
+static struct
+{
+    struct arg_int *wakeup_time;
+    struct arg_int *wakeup_gpio_num;
+    struct arg_int *wakeup_gpio_level;
+    struct arg_end *end;
+} sleep_args;
+
 /******************************************************************************
  * External variables
  *****************************************************************************/
 extern QueueHandle_t passkey_queue;
-extern QueueHandle_t keyboard_queue;
-extern QueueHandle_t mouse_queue;
+extern input_ring_t console_input_ring;
 extern QueueHandle_t commands_queue;
+extern QueueHandle_t typing_queue;
 
 /******************************************************************************
  * External functions
  *****************************************************************************/
 extern void bluetooth_send_passkey(uint32_t passkey);
 extern void bluetooth_send_character(char);
+extern bool has_ble_secure_connection();
+extern uint16_t bluetooth_get_conn_id();
+extern uint16_t bluetooth_get_conn_interval();
+extern const char *bluetooth_phy_to_str(uint8_t phy);
+extern void bluetooth_prepare_sleep(resume_state_t *state);
 
 /******************************************************************************
  * Function declarations
@@ -68,6 +139,8 @@ int reply_with_passkey(int argc, char **argv);
 int send_modifier_keycode(int argc, char **argv);
 void config_prompts();
 void watch_prompts();
+static bool console_fast_run(const char *line);
+static bool script_add_line(const char *line);
 void console_register_bluetooth_commands();
 
 /******************************************************************************
@@ -92,6 +165,10 @@ void initialise_console()
         .data_bits = UART_DATA_8_BITS,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
+#if CONFIG_PM_ENABLE
+        /* Keep the baud rate while frequency scaling changes the APB clock */
+        .source_clk = UART_SCLK_REF_TICK,
+#endif
     };
 
     /* Install UART driver for interrupt-driven reads and writes */
@@ -104,7 +181,11 @@ void initialise_console()
 
     /* Initialize the console */
     esp_console_config_t console_config = {
-        .max_cmdline_args = 8,
+        /*
+            Longest line is "move poly" with every point, plus the NULL after argv; words past
+            the limit are cut off silently
+        */
+        .max_cmdline_args = 4 + 2 * MOUSE_PATH_MAX_POINTS + 1,
         .max_cmdline_length = 256,
 #if CONFIG_LOG_COLORS
         .hint_color = atoi(LOG_COLOR_CYAN)
@@ -128,8 +209,9 @@ void initialise_console()
 
 void config_prompts()
 {
-    /* Figure out if the terminal supports escape sequences */
-    int probe_status = linenoiseProbe();
+    /* Figure out if the terminal supports escape sequences, the probe waits for a reply */
+    const resume_state_t *resume = resume_get();
+    int probe_status = resume != NULL ? resume->console_dumb : linenoiseProbe();
     if (probe_status)
     { /* zero indicates success */
         ESP_LOGI(TAG, "\n"
@@ -137,6 +219,7 @@ void config_prompts()
                       "Line editing and history features are disabled.\n"
                       "On Windows, try using Putty instead.\n");
         linenoiseSetDumbMode(1);
+        console_dumb = true;
 #if CONFIG_LOG_COLORS
         /* Since the terminal doesn't support escape sequences,
          * don't use color codes in the prompt.
@@ -146,6 +229,72 @@ void config_prompts()
     }
 }
 
+/*
+    Hot commands skip esp_console and argtable3: r, k, m, c and gp go through input_text, p, t
+    and 'script add' are handled here. Returns false to hand the line to esp_console.
+*/
+static bool console_fast_run(const char *line)
+{
+    size_t pushed;
+
+    switch (input_text_parse(line, &console_input_ring, &pushed))
+    {
+    case INPUT_TEXT_OK:
+    case INPUT_TEXT_ERROR:
+        return true;
+    case INPUT_TEXT_NOT_HANDLED:
+        break;
+    }
+
+    if (line[0] == 'p' && line[1] == ' ')
+    {
+        char *end;
+        uint32_t value = strtoul(&line[2], &end, 10);
+        if (end == &line[2] || *end != '\0' || value > 999999)
+        {
+            ESP_LOGE(TAG, "Passkey is up to 6 digits");
+            return true;
+        }
+        if (xQueueSend(passkey_queue, &value, (TickType_t)10) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to send passkey to queue");
+            hid_stats_inc(HID_STAT_DROP_PASSKEY);
+            return true;
+        }
+        xTaskNotifyGive(hid_task_handle);
+        return true;
+    }
+
+    /* Script lines are kept exactly as written: repeated spaces, quotes and backslashes are STRING text */
+    if (strncmp(line, "script add", 10) == 0 && (line[10] == ' ' || line[10] == '\0'))
+    {
+        script_add_line(line[10] == ' ' ? &line[11] : "");
+        return true;
+    }
+
+    /* Text is typed exactly as written; quoted text keeps the esp_console unquoting */
+    if (line[0] == 't' && line[1] == ' ' && line[2] != '"' && line[2] != '\0')
+    {
+        char *text = strdup(&line[2]);
+        if (text == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to allocate text buffer");
+            return true;
+        }
+        if (xQueueSend(typing_queue, (void *)&text, (TickType_t)10) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to send text to queue");
+            hid_stats_inc(HID_STAT_DROP_TYPING);
+            free(text);
+            return true;
+        }
+        xTaskNotifyGive(hid_task_handle);
+        return true;
+    }
+
+    return false;
+}
+
 void watch_prompts()
 {
     while (1)
@@ -161,6 +310,11 @@ void watch_prompts()
         {
             linenoiseHistoryAdd(line);
         }
+        if (console_fast_run(line))
+        {
+            linenoiseFree(line);
+            continue;
+        }
         /* Try to run the command */
         int ret;
         esp_err_t err = esp_console_run(line, &ret);
@@ -188,6 +342,13 @@ void watch_prompts()
 /******************************************************************************
  * Console command handlers
  *****************************************************************************/
+/* Only reached when a fast path command has no arguments */
+int fast_command_usage(int argc, char **argv)
+{
+    ESP_LOGE(TAG, "'%s' needs arguments, see 'help'", argv[0]);
+    return 1;
+}
+
 int reply_with_passkey(int argc, char **argv)
 {
     int nerrors = arg_parse(argc, argv, (void **)&passkey_args);
@@ -207,9 +368,12 @@ int reply_with_passkey(int argc, char **argv)
         if (xQueueSend(passkey_queue, (void *)&value, (TickType_t)10) != pdPASS)
         {
             ESP_LOGE(TAG, "Failed to send passkey to queue");
+            hid_stats_inc(HID_STAT_DROP_PASSKEY);
             return 1;
         }
 
+        /* The HID task blocks until woken, it no longer polls its queues */
+        xTaskNotifyGive(hid_task_handle);
         ESP_LOGI(TAG, "Passkey sent to queue");
     }
     return 0;
@@ -230,20 +394,19 @@ int send_modifier_keycode(int argc, char **argv)
     ESP_LOGD(TAG, "modifier: %d", modifier);
     ESP_LOGD(TAG, "keycode: %d", keycode);
 
-    keyboard_t keyboard_value = {
-        .modifier = modifier,
-        .keycode = keycode
+    input_event_t event = {
+        .type = INPUT_EVENT_KEYBOARD,
+        .keyboard = {
+            .modifier = modifier,
+            .keycode = keycode
+        }
     };
 
-    if (keyboard_queue != 0)
+    if (!input_ring_push(&console_input_ring, &event))
     {
-        if (xQueueSend(keyboard_queue, (void *)&keyboard_value, (TickType_t)10) != pdPASS)
-        {
-            ESP_LOGE(TAG, "Failed to send keyboard value to queue");
-            return 1;
-        }
-
-        ESP_LOGI(TAG, "Keyboard value sent to queue");
+        ESP_LOGE(TAG, "Input ring full, keyboard value dropped");
+        hid_stats_inc(HID_STAT_DROP_KEYBOARD);
+        return 1;
     }
     return 0;
 }
@@ -261,21 +424,94 @@ int send_mouse(int argc, char **argv)
     int8_t x = mouse_args.movement_x->ival[0];
     int8_t y = mouse_args.movement_y->ival[0];
 
-    mouse_t mouse_data = {
-        .mouse_buttons = buttons,
-        .movement_x = x,
-        .movement_y = y
+    input_event_t event = {
+        .type = INPUT_EVENT_MOUSE,
+        .mouse = {
+            .mouse_buttons = buttons,
+            .movement_x = x,
+            .movement_y = y
+        }
+    };
+
+    if (!input_ring_push(&console_input_ring, &event))
+    {
+        ESP_LOGE(TAG, "Input ring full, mouse data dropped");
+        hid_stats_inc(HID_STAT_DROP_MOUSE);
+        return 1;
+    }
+    return 0;
+}
+
+int send_gamepad(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&gamepad_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, gamepad_args.end, argv[0]);
+        return 1;
+    }
+
+    gamepad_t gamepad_data = {
+        .buttons = (uint32_t)gamepad_args.buttons->ival[0],
+        .hat = gamepad_args.hat->count ? gamepad_args.hat->ival[0] : HID_GAMEPAD_HAT_CENTERED,
     };
 
-    if (mouse_queue != 0)
+    for (int i = 0; i < gamepad_args.axes->count && i < GAMEPAD_NUM_AXES; i++)
+    {
+        gamepad_data.axes[i] = gamepad_args.axes->ival[i];
+    }
+
+    /* The stream merges this sample and sends it on the next connection event */
+    gamepad_stream_update(&gamepad_data);
+    return 0;
+}
+
+int type_text(int argc, char **argv)
+{
+    size_t len = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        len += strlen(argv[i]) + 1;
+    }
+    if (len == 0)
+    {
+        ESP_LOGE(TAG, "Nothing to type");
+        return 1;
+    }
+
+    /* Arguments are joined back with single spaces; quote the text to keep runs of spaces */
+    char *text = malloc(len);
+    if (text == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate text buffer");
+        return 1;
+    }
+    text[0] = '\0';
+    for (int i = 1; i < argc; i++)
+    {
+        strcat(text, argv[i]);
+        if (i < argc - 1)
+        {
+            strcat(text, " ");
+        }
+    }
+
+    if (typing_queue != 0)
     {
-        if (xQueueSend(mouse_queue, (void *)&mouse_data, (TickType_t)10) != pdPASS)
+        if (xQueueSend(typing_queue, (void *)&text, (TickType_t)10) != pdPASS)
         {
-            ESP_LOGE(TAG, "Failed to send mouse data to queue");
+            ESP_LOGE(TAG, "Failed to send text to queue");
+            hid_stats_inc(HID_STAT_DROP_TYPING);
+            free(text);
             return 1;
         }
 
-        ESP_LOGI(TAG, "Mouse data sent to queue");
+        xTaskNotifyGive(hid_task_handle);
+        ESP_LOGI(TAG, "Text sent to queue");
+    }
+    else
+    {
+        free(text);
     }
     return 0;
 }
@@ -288,9 +524,11 @@ int delete_bondings(int argc, char **argv)
         if (xQueueSend(commands_queue, (void *)&command, (TickType_t)10) != pdPASS)
         {
             ESP_LOGE(TAG, "Failed to send DELETE_BONDING command to queue");
+            hid_stats_inc(HID_STAT_DROP_COMMANDS);
             return 1;
         }
 
+        xTaskNotifyGive(hid_task_handle);
         ESP_LOGI(TAG, "DELETE_BONDING command sent to queue");
     }
     return 0;
@@ -304,9 +542,11 @@ int list_bondings(int argc, char **argv)
         if (xQueueSend(commands_queue, (void *)&command, (TickType_t)10) != pdPASS)
         {
             ESP_LOGE(TAG, "Failed to send LIST_BONDINGS command to queue");
+            hid_stats_inc(HID_STAT_DROP_COMMANDS);
             return 1;
         }
 
+        xTaskNotifyGive(hid_task_handle);
         ESP_LOGI(TAG, "LIST_BONDINGS command sent to queue");
     }
     return 0;
@@ -314,110 +554,1164 @@ int list_bondings(int argc, char **argv)
 
 int get_led(int argc, char **argv)
 {
-    uint8_t command = GET_LED;
-    if (commands_queue != 0)
+    led_event_t event = led_events_last();
+
+    if (event.timestamp_us == 0)
     {
-        if (xQueueSend(commands_queue, (void *)&command, (TickType_t)10) != pdPASS)
+        printf("No LED report received yet\n");
+        return 0;
+    }
+
+    printf("LEDs: 0x%02x (num %d, caps %d, scroll %d), updated %lld us ago\n", event.leds,
+           (event.leds & LED_NUM_LOCK) != 0, (event.leds & LED_CAPS_LOCK) != 0,
+           (event.leds & LED_SCROLL_LOCK) != 0, esp_timer_get_time() - event.timestamp_us);
+    return 0;
+}
+
+int show_stats(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&stats_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, stats_args.end, argv[0]);
+        return 1;
+    }
+
+    uint32_t now[HID_STAT_NUM];
+
+    if (stats_args.rate->count)
+    {
+        uint32_t before[HID_STAT_NUM];
+        int seconds = stats_args.rate->ival[0] > 0 ? stats_args.rate->ival[0] : 1;
+
+        /* Sample over a window; counters keep running for everyone else */
+        hid_stats_snapshot(before);
+        int64_t start = esp_timer_get_time();
+        vTaskDelay(pdMS_TO_TICKS(seconds * 1000));
+        hid_stats_snapshot(now);
+        int64_t elapsed_us = esp_timer_get_time() - start;
+
+        for (int i = 0; i < HID_STAT_NUM; i++)
         {
-            ESP_LOGE(TAG, "Failed to send GET_LED command to queue");
-            return 1;
+            uint32_t delta = now[i] - before[i];
+            if (delta != 0)
+            {
+                printf("%-18s %10.1f/s\n", hid_stats_name(i), delta * 1000000.0 / elapsed_us);
+            }
+        }
+    }
+    else
+    {
+        uint32_t latency[HID_STATS_LATENCY_BUCKETS];
+
+        hid_stats_snapshot(now);
+        for (int i = 0; i < HID_STAT_NUM; i++)
+        {
+            if (now[i] != 0)
+            {
+                printf("%-18s %10" PRIu32 "\n", hid_stats_name(i), now[i]);
+            }
+        }
+
+        esp_hidd_conn_info_t info;
+        if (esp_hidd_get_conn_info(bluetooth_get_conn_id(), &info) == ESP_OK)
+        {
+            printf("phy                tx %s rx %s\n", bluetooth_phy_to_str(info.tx_phy), bluetooth_phy_to_str(info.rx_phy));
+            if (info.suspended)
+            {
+                printf("host               suspended\n");
+            }
+        }
+
+        hid_stats_latency_snapshot(latency);
+        if (hid_stats_latency_percentile(latency, 100) != 0)
+        {
+            printf("latency.p50        < %8" PRIu32 " us\n", hid_stats_latency_percentile(latency, 50) + 1);
+            printf("latency.p99        < %8" PRIu32 " us\n", hid_stats_latency_percentile(latency, 99) + 1);
         }
+    }
 
-        ESP_LOGI(TAG, "GET_LED command sent to queue");
+    if (stats_args.reset->count)
+    {
+        hid_stats_reset();
+        printf("Counters reset\n");
     }
     return 0;
 }
 
-/******************************************************************************
- * Register console commands
- *****************************************************************************/
-void console_register_bluetooth_commands()
+int run_bench(int argc, char **argv)
 {
-    /**
-     * Reply to client with passkey
-     */
-    passkey_args.passkey = arg_int0(NULL, NULL, "<pass>", "passkey");
-    passkey_args.end = arg_end(0);
+    int nerrors = arg_parse(argc, argv, (void **)&bench_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, bench_args.end, argv[0]);
+        return 1;
+    }
 
-    const esp_console_cmd_t passkey_cmd = {
-        .command = "p",
-        .help = "Send a 6-digit passkey",
-        .hint = "p 999999",
-        .func = &reply_with_passkey,
-        .argtable = &passkey_args};
+    const char *test = bench_args.test->count ? bench_args.test->sval[0] : "ring";
+    if (strcmp(test, "ring") == 0)
+    {
+        input_bench_run(bench_args.count->count ? bench_args.count->ival[0] : 10000);
+    }
+    else if (strcmp(test, "latency") == 0)
+    {
+        input_bench_latency(bench_args.count->count ? bench_args.count->ival[0] : 500);
+    }
+    else if (strcmp(test, "typing") == 0)
+    {
+        input_bench_typing(bench_args.count->count ? bench_args.count->ival[0] : 200);
+    }
+    else
+    {
+        printf("Unknown benchmark '%s'\n", test);
+        return 1;
+    }
+    return 0;
+}
 
-    ESP_ERROR_CHECK(esp_console_cmd_register(&passkey_cmd));
+int show_stacks(int argc, char **argv)
+{
+    const TaskHandle_t tasks[] = {hid_task_handle, console_task_handle};
 
-    /**
-     * Send raw keycode value
-     */
-    raw_keycode_args.modifier = arg_int0(NULL, NULL, "<modifier>", "modifier");
-    raw_keycode_args.keycode = arg_int1(NULL, NULL, "<keycode>", "keycode");
-    raw_keycode_args.end = arg_end(1);
+    for (int i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++)
+    {
+        if (tasks[i] == NULL)
+        {
+            continue;
+        }
+        /* High-water mark is the least free stack ever seen, in bytes on ESP-IDF */
+        printf("%-14s %6u bytes never used\n", pcTaskGetTaskName(tasks[i]),
+               (unsigned)uxTaskGetStackHighWaterMark(tasks[i]));
+    }
+    return 0;
+}
 
-    const esp_console_cmd_t raw_keycode_cmd = {
-        .command = "r",
-        .help = "Send raw keycode with modifier and keycode",
-        .hint = "r modifier keycode",
-        .func = &send_modifier_keycode,
-        .argtable = &raw_keycode_args
-    };
+int show_connection(int argc, char **argv)
+{
+    esp_hidd_conn_info_t info;
+    uint16_t conn_id = bluetooth_get_conn_id();
 
-    ESP_ERROR_CHECK(esp_console_cmd_register(&raw_keycode_cmd));
+    if (esp_hidd_get_conn_info(conn_id, &info) != ESP_OK)
+    {
+        printf("Not connected\n");
+        return 0;
+    }
 
-    /**
-     * Send mouse values
-     */
-    mouse_args.mouse_buttons = arg_int0(NULL, NULL, "<btn>", "buttons");
-    mouse_args.movement_x = arg_int1(NULL, NULL, "<x>", "x");
-    mouse_args.movement_y = arg_int1(NULL, NULL, "<y>", "y");
-    mouse_args.end = arg_end(2);
+    printf("conn_id %d, %s, %s protocol mode\n", conn_id, has_ble_secure_connection() ? "encrypted" : "not encrypted",
+           info.proto_mode == HID_PROTOCOL_MODE_BOOT ? "boot" : "report");
+    printf("MTU %d (%d bytes per write), data length tx %d rx %d\n", info.mtu, esp_hidd_get_max_payload(conn_id),
+           info.tx_octets, info.rx_octets);
+    printf("PHY tx %s rx %s\n", bluetooth_phy_to_str(info.tx_phy), bluetooth_phy_to_str(info.rx_phy));
+    return 0;
+}
 
-    const esp_console_cmd_t mouse_cmd = {
-        .command = "m",
-        .help = "Send mouse command",
-        .hint = "m buttons x y",
-        .func = &send_mouse,
-        .argtable = &mouse_args
-    };
+int power_management(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&pm_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, pm_args.end, argv[0]);
+        return 1;
+    }
 
-    ESP_ERROR_CHECK(esp_console_cmd_register(&mouse_cmd));
+    if (pm_args.max_freq->count || pm_args.min_freq->count || pm_args.light_sleep->count)
+    {
+        power_config_t config;
+        power_get_config(&config);
 
-    /**
-     * Delete all bondings
-     */
-    const esp_console_cmd_t delete_bondings_cmd = {
-        .command = "db",
-        .help = "Delete all bondings",
-        .hint = "db",
-        .func = &delete_bondings,
-    };
+        if (pm_args.max_freq->count)
+        {
+            config.max_freq_mhz = pm_args.max_freq->ival[0];
+        }
+        if (pm_args.min_freq->count)
+        {
+            config.min_freq_mhz = pm_args.min_freq->ival[0];
+        }
+        if (pm_args.light_sleep->count)
+        {
+            config.light_sleep = pm_args.light_sleep->ival[0] != 0;
+        }
 
-    ESP_ERROR_CHECK(esp_console_cmd_register(&delete_bondings_cmd));
+        if (power_configure(&config) != ESP_OK)
+        {
+            return 1;
+        }
+    }
 
-    /**
-     * List bondings
-     */
-    const esp_console_cmd_t list_bondings_cmd = {
-        .command = "lb",
-        .help = "List bondings",
-        .hint = "lb",
-        .func = &list_bondings,
-    };
+    power_dump(stdout);
+    return 0;
+}
 
-    ESP_ERROR_CHECK(esp_console_cmd_register(&list_bondings_cmd));
+int show_battery(int argc, char **argv)
+{
+    battery_status_t status;
 
+    battery_sample();
+    battery_get_status(&status);
+    if (status.samples == 0)
+    {
+        printf("Battery monitor disabled\n");
+        return 0;
+    }
 
-    /**
-     * Get LED values
-     */
-    const esp_console_cmd_t get_led_cmd = {
-        .command = "led",
-        .help = "Get LED value",
-        .hint = "led",
-        .func = &get_led,
-    };
+    printf("%" PRIu32 " mV now, %" PRIu32 " mV averaged, level %u%%, reported %u%%\n", status.raw_mv,
+           status.estimate_mv, status.level, status.reported);
+    printf("%" PRIu32 " measurements, %" PRIu32 " level changes reported\n", status.samples,
+           status.notifications);
+    return 0;
+}
 
-    ESP_ERROR_CHECK(esp_console_cmd_register(&get_led_cmd));
+int show_boot_time(int argc, char **argv)
+{
+    boot_time_print();
+    return 0;
+}
+
+int enter_deep_sleep(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&sleep_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, sleep_args.end, argv[0]);
+        return 1;
+    }
+
+    if (sleep_args.wakeup_time->count)
+    {
+        ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup(1000ULL * sleep_args.wakeup_time->ival[0]));
+    }
+    if (sleep_args.wakeup_gpio_num->count)
+    {
+        int io_num = sleep_args.wakeup_gpio_num->ival[0];
+        int level = sleep_args.wakeup_gpio_level->count ? sleep_args.wakeup_gpio_level->ival[0] : 0;
+        if (!rtc_gpio_is_valid_gpio(io_num) || (level != 0 && level != 1))
+        {
+            ESP_LOGE(TAG, "GPIO %d level %d cannot wake the chip", io_num, level);
+            return 1;
+        }
+        ESP_ERROR_CHECK(esp_sleep_enable_ext1_wakeup(1ULL << io_num, level));
+    }
+
+    /* Zeroed first, the checksum covers padding */
+    resume_state_t state;
+    memset(&state, 0, sizeof(state));
+    bluetooth_prepare_sleep(&state);
+    state.leds = led_events_last().leds;
+    state.console_dumb = console_dumb;
+    resume_save(&state);
+
+    ESP_LOGI(TAG, "Entering deep sleep");
+    /* Let the disconnect reach the host and the log leave the UART */
+    vTaskDelay(pdMS_TO_TICKS(100));
+    uart_wait_tx_idle_polling(CONFIG_ESP_CONSOLE_UART_NUM);
+    esp_deep_sleep_start();
+    return 0;
+}
+
+/* Decodes a string of hex digit pairs into a heap buffer the caller frees */
+static bool console_parse_hex(const char *hex, uint8_t **data, size_t *len)
+{
+    size_t digits = strlen(hex);
+    if (digits == 0 || digits % 2 != 0)
+    {
+        ESP_LOGE(TAG, "Expected an even number of hex digits");
+        return false;
+    }
+    *data = malloc(digits / 2);
+    if (*data == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes", (unsigned)(digits / 2));
+        return false;
+    }
+    for (size_t i = 0; i < digits / 2; i++)
+    {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+        char *end;
+        (*data)[i] = strtoul(byte, &end, 16);
+        if (*end != '\0')
+        {
+            ESP_LOGE(TAG, "Not a hex digit at %u", (unsigned)(2 * i));
+            free(*data);
+            return false;
+        }
+    }
+    *len = digits / 2;
+    return true;
+}
+
+/* Appends one source line for 'script run' */
+static bool script_add_line(const char *line)
+{
+    size_t len = script_source != NULL ? strlen(script_source) : 0;
+    char *source = realloc(script_source, len + strlen(line) + 2);
+
+    if (source == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate script source");
+        return false;
+    }
+    script_source = source;
+    strcpy(&script_source[len], line);
+    strcat(script_source, "\n");
+    return true;
+}
+
+int run_script(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        ESP_LOGE(TAG, "Expected add, list, clear, run, load, stop or status");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "add") == 0)
+    {
+        /* Only reached when console_fast_run did not take the line; words joined back with single spaces */
+        char line[256] = "";
+        size_t len = 0;
+        for (int i = 2; i < argc && len < sizeof(line); i++)
+        {
+            len += snprintf(&line[len], sizeof(line) - len, i < argc - 1 ? "%s " : "%s", argv[i]);
+        }
+        return script_add_line(line) ? 0 : 1;
+    }
+    if (strcmp(argv[1], "list") == 0)
+    {
+        printf("%s", script_source != NULL ? script_source : "");
+        return 0;
+    }
+    if (strcmp(argv[1], "clear") == 0)
+    {
+        free(script_source);
+        script_source = NULL;
+        return 0;
+    }
+    if (strcmp(argv[1], "run") == 0)
+    {
+        script_compile_result_t result;
+        esp_err_t ret = script_run_source(script_source != NULL ? script_source : "", &result);
+        if (ret == ESP_ERR_INVALID_ARG)
+        {
+            ESP_LOGE(TAG, "Line %d: %s", result.line, result.error);
+            return 1;
+        }
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "A script is already running");
+            return 1;
+        }
+        ESP_LOGI(TAG, "Running %u bytes of bytecode", (unsigned)result.len);
+        return 0;
+    }
+    if (strcmp(argv[1], "load") == 0)
+    {
+        /* Bytecode from a host build of the compiler, as one hex string */
+        uint8_t *code;
+        size_t len;
+        if (argc != 3 || !console_parse_hex(argv[2], &code, &len))
+        {
+            return 1;
+        }
+        esp_err_t ret = script_run_code(code, len);
+        free(code);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Cannot run bytecode: %s", esp_err_to_name(ret));
+            return 1;
+        }
+        return 0;
+    }
+    if (strcmp(argv[1], "stop") == 0)
+    {
+        script_stop();
+        return 0;
+    }
+    if (strcmp(argv[1], "status") == 0)
+    {
+        script_result_t result;
+        script_last_result(&result);
+        printf("%s; last program: %s at offset %u after %" PRIu32 " instructions\n",
+               script_running() ? "running" : "idle", script_status_to_str(result.status),
+               (unsigned)result.pc, result.steps);
+        return 0;
+    }
+
+    ESP_LOGE(TAG, "Unknown script command '%s'", argv[1]);
+    return 1;
+}
+
+int manage_macros(int argc, char **argv)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (argc < 2 || strcmp(argv[1], "list") == 0)
+    {
+        macro_store_usage_t usage;
+        macro_t macro;
+        for (size_t i = 0; macro_store_get(i, &macro) == ESP_OK; i++)
+        {
+            printf("%-*s %6" PRIu32 " bytes\n", MACRO_STORE_MAX_NAME, macro.name, macro.len);
+        }
+        macro_store_usage(&usage);
+        printf("%u macros, %u bytes live, %u of %u bytes used\n", (unsigned)usage.entries,
+               (unsigned)usage.live, (unsigned)usage.used, (unsigned)usage.capacity);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "save") == 0 && argc == 3)
+    {
+        /* Compiles the lines collected with 'script add' */
+        uint8_t *code = malloc(CONFIG_KBM_SCRIPT_MAX_SIZE);
+        script_compile_result_t result;
+        if (code == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to allocate bytecode buffer");
+            return 1;
+        }
+        if (!script_compile(script_source != NULL ? script_source : "", code, CONFIG_KBM_SCRIPT_MAX_SIZE, &result))
+        {
+            ESP_LOGE(TAG, "Line %d: %s", result.line, result.error);
+            free(code);
+            return 1;
+        }
+        ret = macro_store_append(argv[2], MACRO_TYPE_SCRIPT, code, result.len);
+        free(code);
+    }
+    else if (strcmp(argv[1], "begin") == 0 && argc == 4)
+    {
+        ret = macro_store_begin(argv[2], MACRO_TYPE_SCRIPT, strtoul(argv[3], NULL, 0));
+    }
+    else if (strcmp(argv[1], "write") == 0 && argc == 3)
+    {
+        uint8_t *data;
+        size_t len;
+        if (!console_parse_hex(argv[2], &data, &len))
+        {
+            return 1;
+        }
+        ret = macro_store_write(data, len);
+        free(data);
+    }
+    else if (strcmp(argv[1], "commit") == 0)
+    {
+        ret = macro_store_commit();
+    }
+    else if (strcmp(argv[1], "abort") == 0)
+    {
+        macro_store_abort();
+    }
+    else if (strcmp(argv[1], "run") == 0 && argc == 3)
+    {
+        macro_t macro;
+        ret = macro_store_find(argv[2], &macro);
+        if (ret == ESP_OK)
+        {
+            /* Played straight from the mapped partition */
+            ret = macro.type == MACRO_TYPE_CAPTURE ? script_replay(macro.data, macro.len / sizeof(input_event_t))
+                                                   : script_run_mapped(macro.data, macro.len);
+        }
+    }
+    else if (strcmp(argv[1], "delete") == 0 && argc == 3)
+    {
+        ret = macro_store_delete(argv[2]);
+    }
+    else if (strcmp(argv[1], "compact") == 0)
+    {
+        /* Compaction moves the records a running macro reads */
+        ret = script_running() ? ESP_ERR_INVALID_STATE : macro_store_compact();
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Unknown macro command or wrong number of arguments");
+        return 1;
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "macro %s failed: %s", argv[1], esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
+
+int manage_capture(int argc, char **argv)
+{
+    const input_event_t *events;
+    size_t count;
+    esp_err_t ret = ESP_OK;
+
+    if (argc < 2 || strcmp(argv[1], "status") == 0)
+    {
+        count = capture_get(&events);
+        printf("%s; %u events held, %" PRIu32 " overwritten\n", capture_active() ? "capturing" : "stopped",
+               (unsigned)count, capture_overwritten());
+        return 0;
+    }
+
+    if (strcmp(argv[1], "start") == 0)
+    {
+        /* A replay reads the buffer a new capture would overwrite */
+        ret = script_running() ? ESP_ERR_INVALID_STATE : capture_start();
+    }
+    else if (strcmp(argv[1], "stop") == 0)
+    {
+        capture_stop();
+    }
+    else if (strcmp(argv[1], "dump") == 0)
+    {
+        /* One line per event for the host: microseconds since the first event, type, payload */
+        count = capture_get(&events);
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint8_t *payload = (const uint8_t *)&events[i].keyboard;
+            printf("%" PRIu32 " %u %02x %02x %02x\n", events[i].timestamp_us - events[0].timestamp_us,
+                   events[i].type, payload[0], payload[1], payload[2]);
+        }
+    }
+    else if (strcmp(argv[1], "replay") == 0)
+    {
+        count = capture_get(&events);
+        ret = count == 0 ? ESP_ERR_NOT_FOUND : script_replay(events, count);
+    }
+    else if (strcmp(argv[1], "save") == 0 && argc == 3)
+    {
+        count = capture_get(&events);
+        ret = count == 0 ? ESP_ERR_NOT_FOUND
+                         : macro_store_append(argv[2], MACRO_TYPE_CAPTURE, events, count * sizeof(input_event_t));
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Unknown capture command or wrong number of arguments");
+        return 1;
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "capture %s failed: %s", argv[1], esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
+
+int move_mouse(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *name;
+        mouse_path_kind_t kind;
+    } kinds[] = {
+        {"line", MOUSE_PATH_LINE},
+        {"bezier", MOUSE_PATH_BEZIER},
+        {"poly", MOUSE_PATH_POLYLINE},
+    };
+    mouse_point_t points[MOUSE_PATH_MAX_POINTS];
+    size_t num_points = (argc - 4) / 2;
+    size_t k;
+    long values[3 + 2 * MOUSE_PATH_MAX_POINTS];
+
+    for (k = 0; argc > 1 && k < sizeof(kinds) / sizeof(kinds[0]); k++)
+    {
+        if (strcmp(argv[1], kinds[k].name) == 0)
+        {
+            break;
+        }
+    }
+    if (argc < 6 || argc % 2 != 0 || num_points > MOUSE_PATH_MAX_POINTS || k == sizeof(kinds) / sizeof(kinds[0]))
+    {
+        ESP_LOGE(TAG, "Expected line, bezier or poly, then ms, buttons and x y pairs");
+        return 1;
+    }
+
+    /* By hand: argtable3 would take negative coordinates for options */
+    for (int i = 2; i < argc; i++)
+    {
+        char *end;
+        values[i - 2] = strtol(argv[i], &end, 0);
+        if (*end != '\0')
+        {
+            ESP_LOGE(TAG, "Not a number: '%s'", argv[i]);
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < num_points; i++)
+    {
+        points[i].x = values[2 + 2 * i];
+        points[i].y = values[3 + 2 * i];
+    }
+
+    /* One report per connection event */
+    uint32_t interval_us = bluetooth_get_conn_interval() * 1250;
+    mouse_path_t path;
+    if (values[0] < 0 || !mouse_path_init(&path, kinds[k].kind, points, num_points, values[0] * 1000 / interval_us))
+    {
+        ESP_LOGE(TAG, "%s takes %s", kinds[k].name,
+                 kinds[k].kind == MOUSE_PATH_BEZIER ? "two control points and an end point" :
+                 kinds[k].kind == MOUSE_PATH_LINE   ? "one end point" : "up to 8 points");
+        return 1;
+    }
+
+    esp_err_t ret = script_move(&path, values[1], interval_us, true);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "A script is running");
+        return 1;
+    }
+    return 0;
+}
+
+int accel_command(int argc, char **argv)
+{
+    esp_err_t ret = ESP_OK;
+    long values[3] = {0, 0, 0};
+
+    for (int i = 2; i < argc && i < 5; i++)
+    {
+        char *end;
+        values[i - 2] = strtol(argv[i], &end, 0);
+        if (*end != '\0' || values[i - 2] < 0)
+        {
+            ESP_LOGE(TAG, "Not a count: '%s'", argv[i]);
+            return 1;
+        }
+    }
+
+    if (argc == 1)
+    {
+        accel_dump(stdout);
+    }
+    else if (strcmp(argv[1], "probe") == 0 && (argc == 3 || argc == 4))
+    {
+        /* Equal raw reports, one per connection event, for the host to measure */
+        long counts = values[0];
+        long reports = argc == 4 ? values[1] : ACCEL_PROBE_REPORTS;
+        uint32_t interval_us = bluetooth_get_conn_interval() * 1250;
+        mouse_point_t end = {counts * reports, 0};
+        mouse_path_t path;
+
+        if (counts < 1 || counts > 127 || reports < 1)
+        {
+            ESP_LOGE(TAG, "Counts from 1 to 127, at least one report");
+            return 1;
+        }
+        mouse_path_init(&path, MOUSE_PATH_LINE, &end, 1, reports);
+        ret = script_move(&path, 0, interval_us, false);
+    }
+    else if (strcmp(argv[1], "sample") == 0 && (argc == 4 || argc == 5))
+    {
+        if (values[0] > 127)
+        {
+            ESP_LOGE(TAG, "Counts from 1 to 127");
+            return 1;
+        }
+        ret = accel_add_sample(values[0], argc == 5 ? values[2] : ACCEL_PROBE_REPORTS, values[1]);
+    }
+    else if (strcmp(argv[1], "fit") == 0 && argc == 2)
+    {
+        ret = accel_fit();
+        if (ret == ESP_OK)
+        {
+            accel_dump(stdout);
+        }
+    }
+    else if (strcmp(argv[1], "clear") == 0 && argc == 2)
+    {
+        accel_clear_samples();
+    }
+    else if (strcmp(argv[1], "forget") == 0 && argc == 2)
+    {
+        ret = accel_forget();
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Unknown accel command or wrong number of arguments");
+        return 1;
+    }
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "accel %s failed: %s", argv[1], esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
+
+int gesture_command(int argc, char **argv)
+{
+    long values[4] = {0, 0, 0, 0};
+    touch_gesture_t gesture;
+    bool valid;
+
+    /* By hand, like move: negative distances would be taken for options */
+    for (int i = 2; i < argc && i < 6; i++)
+    {
+        char *end;
+        values[i - 2] = strtol(argv[i], &end, 0);
+        if (*end != '\0')
+        {
+            ESP_LOGE(TAG, "Not a number: '%s'", argv[i]);
+            return 1;
+        }
+    }
+    if (argc < 4 || values[0] < 0)
+    {
+        ESP_LOGE(TAG, "Expected scroll, pinch or swipe, then ms");
+        return 1;
+    }
+
+    /* One frame per connection event */
+    uint32_t interval_us = bluetooth_get_conn_interval() * 1250;
+    uint32_t steps = values[0] * 1000 / interval_us;
+
+    if (strcmp(argv[1], "scroll") == 0 && argc == 5)
+    {
+        valid = touch_gesture_init(&gesture, TOUCH_GESTURE_SCROLL, 2, values[1], values[2], 0, steps);
+    }
+    else if (strcmp(argv[1], "pinch") == 0 && argc == 4)
+    {
+        valid = touch_gesture_init(&gesture, TOUCH_GESTURE_PINCH, 2, 0, 0, values[1], steps);
+    }
+    else if (strcmp(argv[1], "swipe") == 0 && argc == 6)
+    {
+        valid = touch_gesture_init(&gesture, TOUCH_GESTURE_SWIPE, values[1], values[2], values[3], 0, steps);
+    }
+    else
+    {
+        valid = false;
+    }
+    if (!valid)
+    {
+        ESP_LOGE(TAG, "scroll takes dx dy, pinch a spread, swipe 3 or 4 fingers and dx dy");
+        return 1;
+    }
+
+    if (script_gesture(&gesture, interval_us) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "A script is running");
+        return 1;
+    }
+    return 0;
+}
+
+int unicode_command(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *name;
+        uint8_t methods;
+    } hosts[] = {
+        {"off", 0},
+        {"windows", TYPING_UNICODE_WIN_ALT},
+        {"windows-hex", TYPING_UNICODE_WIN_ALT | TYPING_UNICODE_WIN_HEX},
+        {"linux", TYPING_UNICODE_LINUX},
+        {"macos", TYPING_UNICODE_MACOS},
+    };
+    uint8_t methods = 0;
+
+    /* Several names add up, for a host set up for more than one method */
+    for (int i = 1; i < argc; i++)
+    {
+        size_t k = 0;
+        while (k < sizeof(hosts) / sizeof(hosts[0]) && strcmp(argv[i], hosts[k].name) != 0)
+        {
+            k++;
+        }
+        if (k == sizeof(hosts) / sizeof(hosts[0]))
+        {
+            ESP_LOGE(TAG, "Unknown host '%s', expected off, windows, windows-hex, linux or macos", argv[i]);
+            return 1;
+        }
+        methods |= hosts[k].methods;
+    }
+    if (argc > 1)
+    {
+        typing_unicode_set_methods(methods);
+    }
+
+    methods = typing_unicode_methods();
+    printf("Unicode input:%s%s%s%s%s\n", methods == 0 ? " off" : "",
+           methods & TYPING_UNICODE_WIN_ALT ? " windows-alt" : "",
+           methods & TYPING_UNICODE_WIN_HEX ? " windows-hex" : "",
+           methods & TYPING_UNICODE_LINUX ? " linux" : "",
+           methods & TYPING_UNICODE_MACOS ? " macos" : "");
+    return 0;
+}
+
+/* Pushed by led_events on every host LED write, no polling involved */
+static void console_on_led_event(const led_event_t *event, void *ctx)
+{
+    if (event->changed & LED_NUM_LOCK)
+    {
+        ESP_LOGI(TAG, "Num lock is %s", event->leds & LED_NUM_LOCK ? "on" : "off");
+    }
+    if (event->changed & LED_CAPS_LOCK)
+    {
+        ESP_LOGI(TAG, "Caps lock is %s", event->leds & LED_CAPS_LOCK ? "on" : "off");
+    }
+    if (event->changed & LED_SCROLL_LOCK)
+    {
+        ESP_LOGI(TAG, "Scroll lock is %s", event->leds & LED_SCROLL_LOCK ? "on" : "off");
+    }
+}
+
+/******************************************************************************
+ * Register console commands
+ *****************************************************************************/
+void console_register_bluetooth_commands()
+{
+    /**
+     * Reply to client with passkey
+     */
+    passkey_args.passkey = arg_int0(NULL, NULL, "<pass>", "passkey");
+    passkey_args.end = arg_end(0);
+
+    const esp_console_cmd_t passkey_cmd = {
+        .command = "p",
+        .help = "Send a 6-digit passkey",
+        .hint = "p 999999",
+        .func = &reply_with_passkey,
+        .argtable = &passkey_args};
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&passkey_cmd));
+
+    /**
+     * Send raw keycode value
+     */
+    raw_keycode_args.modifier = arg_int0(NULL, NULL, "<modifier>", "modifier");
+    raw_keycode_args.keycode = arg_int1(NULL, NULL, "<keycode>", "keycode");
+    raw_keycode_args.end = arg_end(1);
+
+    const esp_console_cmd_t raw_keycode_cmd = {
+        .command = "r",
+        .help = "Send raw keycode with modifier and keycode. Separate more taps with ';'",
+        .hint = "r modifier keycode",
+        .func = &send_modifier_keycode,
+        .argtable = &raw_keycode_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&raw_keycode_cmd));
+
+    /**
+     * Send mouse values
+     */
+    mouse_args.mouse_buttons = arg_int0(NULL, NULL, "<btn>", "buttons");
+    mouse_args.movement_x = arg_int1(NULL, NULL, "<x>", "x");
+    mouse_args.movement_y = arg_int1(NULL, NULL, "<y>", "y");
+    mouse_args.end = arg_end(2);
+
+    const esp_console_cmd_t mouse_cmd = {
+        .command = "m",
+        .help = "Send mouse command, x and y from -127 to 127. Separate more moves with ';'",
+        .hint = "m buttons x y[; buttons x y...]",
+        .func = &send_mouse,
+        .argtable = &mouse_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&mouse_cmd));
+
+    /**
+     * Mouse gestures expanded on the device
+     */
+    const esp_console_cmd_t move_cmd = {
+        .command = "move",
+        .help = "Move the mouse along a line, cubic Bezier or polyline over ms milliseconds, one report "
+                "per connection interval. Points are relative to the start; buttons are held for a drag.",
+        .hint = "move <line|bezier|poly> <ms> <buttons> <x> <y> [<x> <y>...]",
+        .func = &move_mouse,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&move_cmd));
+
+    /**
+     * Host pointer acceleration calibration
+     */
+    const esp_console_cmd_t accel_cmd = {
+        .command = "accel",
+        .help = "Calibrate 'move' for the host's pointer acceleration. 'probe' sends reports of counts each "
+                "(20 by default), the host measures how many pixels the pointer went and passes them to "
+                "'sample'. 'fit' builds the curve and stores it for this host. No arguments shows the curve.",
+        .hint = "accel [probe <counts> [reports] | sample <counts> <pixels> [reports] | fit | clear | forget]",
+        .func = &accel_command,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&accel_cmd));
+
+    /**
+     * Precision Touchpad gestures
+     */
+    const esp_console_cmd_t gesture_cmd = {
+        .command = "gesture",
+        .help = "Touchpad gesture over ms milliseconds, one contact frame per connection interval. The pad "
+                "is 1000 x 1000 with fingers starting at its centre; 'pinch' spreads the two fingers apart, "
+                "or together when negative. Needs a host that uses the touchpad, e.g. Windows.",
+        .hint = "gesture <scroll <ms> <dx> <dy> | pinch <ms> <spread> | swipe <ms> <3|4> <dx> <dy>>",
+        .func = &gesture_command,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&gesture_cmd));
+
+    /**
+     * Type text
+     */
+    const esp_console_cmd_t type_cmd = {
+        .command = "t",
+        .help = "Type text using the host's current Caps Lock state",
+        .hint = "t \"Hello, World\"",
+        .func = &type_text,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&type_cmd));
+
+    /**
+     * Unicode input method of the host, for text outside ASCII
+     */
+    const esp_console_cmd_t unicode_cmd = {
+        .command = "unicode",
+        .help = "Set how 't' and scripts type characters outside ASCII. With several, each run of "
+                "characters takes the method needing the fewest reports. No arguments shows the setting.",
+        .hint = "unicode [off | windows | windows-hex | linux | macos]...",
+        .func = &unicode_command,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&unicode_cmd));
+
+    /**
+     * Held keyboard reports and consumer keys, parsed by input_text only
+     */
+    const esp_console_cmd_t report_cmd = {
+        .command = "k",
+        .help = "Send a keyboard report that stays down until the next one; 'k 0 0' releases. "
+                "Separate more reports with ';'",
+        .hint = "k modifier keycode[; modifier keycode...]",
+        .func = &fast_command_usage,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&report_cmd));
+
+    const esp_console_cmd_t consumer_cmd = {
+        .command = "c",
+        .help = "Send a consumer control key, tapped unless pressed is given. Separate more keys with ';'",
+        .hint = "c usage [pressed][; usage [pressed]...]",
+        .func = &fast_command_usage,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&consumer_cmd));
+
+    /**
+     * Update gamepad state
+     */
+    gamepad_args.buttons = arg_int1(NULL, NULL, "<buttons>", "button bitmask");
+    gamepad_args.hat = arg_int0(NULL, NULL, "<hat>", "hat direction 0-7, 8 centered");
+    gamepad_args.axes = arg_intn(NULL, NULL, "<axis>", 0, GAMEPAD_NUM_AXES, "X Y Z Rx Ry Rz");
+    gamepad_args.end = arg_end(3);
+
+    const esp_console_cmd_t gamepad_cmd = {
+        .command = "gp",
+        .help = "Update gamepad state, streamed at the connection interval",
+        .hint = "gp <buttons> [<hat> [<x> <y> <z> <rx> <ry> <rz>]]",
+        .func = &send_gamepad,
+        .argtable = &gamepad_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&gamepad_cmd));
+
+    /**
+     * Delete all bondings
+     */
+    const esp_console_cmd_t delete_bondings_cmd = {
+        .command = "db",
+        .help = "Delete all bondings",
+        .hint = "db",
+        .func = &delete_bondings,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&delete_bondings_cmd));
+
+    /**
+     * List bondings
+     */
+    const esp_console_cmd_t list_bondings_cmd = {
+        .command = "lb",
+        .help = "List bondings",
+        .hint = "lb",
+        .func = &list_bondings,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&list_bondings_cmd));
+
+
+    /**
+     * Get LED values
+     */
+    const esp_console_cmd_t get_led_cmd = {
+        .command = "led",
+        .help = "Get LED value",
+        .hint = "led",
+        .func = &get_led,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&get_led_cmd));
+
+    /**
+     * Pipeline statistics
+     */
+    stats_args.reset = arg_lit0("r", "reset", "reset counters after printing");
+    stats_args.rate = arg_int0(NULL, "rate", "<seconds>", "print per-second rates over a window");
+    stats_args.end = arg_end(2);
+
+    const esp_console_cmd_t stats_cmd = {
+        .command = "stats",
+        .help = "Show HID pipeline counters; zero counters are omitted",
+        .hint = "stats [-r] [--rate <seconds>]",
+        .func = &show_stats,
+        .argtable = &stats_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&stats_cmd));
+
+    /**
+     * Input path benchmark
+     */
+    bench_args.test = arg_str0(NULL, NULL, "<ring|latency|typing>", "benchmark to run, default ring");
+    bench_args.count = arg_int0("n", NULL, "<events>", "events per run");
+    bench_args.end = arg_end(2);
+
+    const esp_console_cmd_t bench_cmd = {
+        .command = "bench",
+        .help = "'ring' compares input ring and FreeRTOS queue cost per event, "
+                "'latency' compares latency distributions of the task layouts, "
+                "'typing' compares cold and cached typing",
+        .hint = "bench [ring|latency|typing] [-n events]",
+        .func = &run_bench,
+        .argtable = &bench_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&bench_cmd));
+
+    /**
+     * Connection parameters
+     */
+    const esp_console_cmd_t conn_cmd = {
+        .command = "conn",
+        .help = "Show negotiated parameters of the current connection",
+        .hint = "conn",
+        .func = &show_connection,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&conn_cmd));
+
+    /**
+     * Stack high-water marks
+     */
+    const esp_console_cmd_t stacks_cmd = {
+        .command = "stacks",
+        .help = "Show unused stack of the HID and console tasks",
+        .hint = "stacks",
+        .func = &show_stacks,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&stacks_cmd));
+
+    /**
+     * Power management
+     */
+    pm_args.max_freq = arg_int0(NULL, "max", "<MHz>", "CPU frequency while busy");
+    pm_args.min_freq = arg_int0(NULL, "min", "<MHz>", "CPU frequency while idle");
+    pm_args.light_sleep = arg_int0(NULL, "sleep", "<0|1>", "automatic light sleep when idle");
+    pm_args.end = arg_end(3);
+
+    const esp_console_cmd_t pm_cmd = {
+        .command = "pm",
+        .help = "Show or change frequency scaling and light sleep, and the power locks held",
+        .hint = "pm [--max <MHz>] [--min <MHz>] [--sleep <0|1>]",
+        .func = &power_management,
+        .argtable = &pm_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&pm_cmd));
+
+    /**
+     * Battery monitor
+     */
+    const esp_console_cmd_t battery_cmd = {
+        .command = "battery",
+        .help = "Measure the battery now and show the level reported to the host",
+        .hint = "battery",
+        .func = &show_battery,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&battery_cmd));
+
+    /**
+     * Boot milestones
+     */
+    const esp_console_cmd_t boot_cmd = {
+        .command = "boot",
+        .help = "Show when each boot milestone was reached, from app_main to the first encrypted link",
+        .hint = "boot",
+        .func = &show_boot_time,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&boot_cmd));
+
+    /**
+     * Deep sleep with resume state
+     */
+    sleep_args.wakeup_time = arg_int0("t", "time", "<ms>", "wake up after this many ms");
+    sleep_args.wakeup_gpio_num = arg_int0(NULL, "io", "<n>", "wake up on this RTC GPIO");
+    sleep_args.wakeup_gpio_level = arg_int0(NULL, "io_level", "<0|1>", "GPIO level that wakes, default 0");
+    sleep_args.end = arg_end(3);
+
+    const esp_console_cmd_t sleep_cmd = {
+        .command = "sleep",
+        .help = "Disconnect, save the link and lock state to RTC memory and enter deep sleep. "
+                "On wake the device advertises directly to the last host.",
+        .hint = "sleep [-t <ms>] [--io <n>] [--io_level <0|1>]",
+        .func = &enter_deep_sleep,
+        .argtable = &sleep_args
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&sleep_cmd));
+
+    /**
+     * Input programs
+     */
+    const esp_console_cmd_t script_cmd = {
+        .command = "script",
+        .help = "Build a DuckyScript-style program line by line with 'add', then 'run' it. "
+                "'load' runs bytecode compiled on a PC, 'stop' aborts at the next wait or loop.",
+        .hint = "script <add <line>|list|clear|run|load <hex>|stop|status>",
+        .func = &run_script,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&script_cmd));
+
+    /**
+     * Macro library in flash
+     */
+    const esp_console_cmd_t macro_cmd = {
+        .command = "macro",
+        .help = "Keep script programs in the macros partition and play them from flash. 'save' stores the "
+                "lines collected with 'script add'; 'begin', 'write' and 'commit' upload bytecode in pieces.",
+        .hint = "macro [list|save <name>|begin <name> <bytes>|write <hex>|commit|abort|run <name>|delete <name>|compact]",
+        .func = &manage_macros,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&macro_cmd));
+
+    /**
+     * Input capture and replay
+     */
+    const esp_console_cmd_t capture_cmd = {
+        .command = "capture",
+        .help = "Record every input event with its device timestamp, then replay it with the original "
+                "timing, print it for the host, or save it as a macro",
+        .hint = "capture [start|stop|status|dump|replay|save <name>]",
+        .func = &manage_capture,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&capture_cmd));
+
+    /* Log LED changes as the host reports them */
+    ESP_ERROR_CHECK(led_events_subscribe(&console_on_led_event, NULL));
 
 }
\ No newline at end of file
@@ -0,0 +1,350 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "input_ring.h"
+#include "input_bench.h"
+#include "task_layout.h"
+#include "typing.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_BENCH"
+
+#define BENCH_CONSUMER_STACK    2048
+#define BENCH_CONSUMER_PRIORITY 5
+/* Consumer on the other core so both sides really run concurrently */
+#define BENCH_CONSUMER_CORE     (portNUM_PROCESSORS > 1 ? !xPortGetCoreID() : tskNO_AFFINITY)
+
+typedef struct
+{
+    const char *name;
+    BaseType_t producer_core;
+    BaseType_t consumer_core;
+} bench_layout_t;
+
+static const bench_layout_t bench_layouts[] = {
+#if !CONFIG_FREERTOS_UNICORE
+    {"split", !CONFIG_BT_BLUEDROID_PINNED_TO_CORE, CONFIG_BT_BLUEDROID_PINNED_TO_CORE},
+    {"same core", CONFIG_BT_BLUEDROID_PINNED_TO_CORE, CONFIG_BT_BLUEDROID_PINNED_TO_CORE},
+#endif
+    {"unpinned", tskNO_AFFINITY, tskNO_AFFINITY},
+};
+
+typedef struct
+{
+    uint32_t count;
+    input_ring_t *ring;
+    QueueHandle_t queue;
+    SemaphoreHandle_t done;
+    uint32_t checksum;
+    uint32_t *latency_us;
+} bench_ctx_t;
+
+/* Too large for the console task's stack */
+static input_ring_t bench_ring;
+
+/* What typing workloads repeat: a login, a shell command and a form value */
+static const char *const bench_texts[] = {
+    "operator@example.com\tCorrect-Horse-Battery-Staple!7\n",
+    "sudo systemctl restart nginx && journalctl -u nginx --since \"5 min ago\" | tail -n 50\n",
+    "Dear Customer, THANK YOU for your ORDER #10462. It ships within 2-3 business days.",
+};
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void bench_ring_consumer(void *arg);
+static void bench_queue_consumer(void *arg);
+static int64_t bench_run_ring(bench_ctx_t *ctx);
+static int64_t bench_run_queue(bench_ctx_t *ctx);
+static void bench_latency_producer(void *arg);
+static void bench_latency_consumer(void *arg);
+static int bench_compare_u32(const void *a, const void *b);
+static void bench_typing_sink(uint8_t modifier, uint8_t keycode, void *ctx);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static void bench_ring_consumer(void *arg)
+{
+    bench_ctx_t *ctx = arg;
+    input_event_t event;
+    uint32_t received = 0;
+
+    input_ring_set_consumer(ctx->ring, xTaskGetCurrentTaskHandle());
+    xSemaphoreGive(ctx->done);
+
+    while (received < ctx->count)
+    {
+        while (input_ring_pop(ctx->ring, &event))
+        {
+            ctx->checksum += event.keyboard.keycode;
+            received++;
+        }
+        if (received < ctx->count)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void bench_queue_consumer(void *arg)
+{
+    bench_ctx_t *ctx = arg;
+    input_event_t event;
+
+    xSemaphoreGive(ctx->done);
+    for (uint32_t received = 0; received < ctx->count; received++)
+    {
+        xQueueReceive(ctx->queue, &event, portMAX_DELAY);
+        ctx->checksum += event.keyboard.keycode;
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static int64_t bench_run_ring(bench_ctx_t *ctx)
+{
+    input_event_t event = {.type = INPUT_EVENT_KEYBOARD};
+
+    input_ring_init(&bench_ring);
+    ctx->ring = &bench_ring;
+    ctx->checksum = 0;
+
+    xTaskCreatePinnedToCore(&bench_ring_consumer, "bench_ring", BENCH_CONSUMER_STACK, ctx,
+                            BENCH_CONSUMER_PRIORITY, NULL, BENCH_CONSUMER_CORE);
+    xSemaphoreTake(ctx->done, portMAX_DELAY);
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < ctx->count; i++)
+    {
+        event.keyboard.keycode = (uint8_t)i;
+        while (!input_ring_push(&bench_ring, &event))
+        {
+            /* Full: let the consumer catch up, as a producer task would */
+            taskYIELD();
+        }
+    }
+    xSemaphoreTake(ctx->done, portMAX_DELAY);
+    return esp_timer_get_time() - start;
+}
+
+static int64_t bench_run_queue(bench_ctx_t *ctx)
+{
+    input_event_t event = {.type = INPUT_EVENT_KEYBOARD};
+
+    ctx->queue = xQueueCreate(INPUT_RING_SIZE, sizeof(input_event_t));
+    if (ctx->queue == NULL)
+    {
+        return -1;
+    }
+    ctx->checksum = 0;
+
+    xTaskCreatePinnedToCore(&bench_queue_consumer, "bench_queue", BENCH_CONSUMER_STACK, ctx,
+                            BENCH_CONSUMER_PRIORITY, NULL, BENCH_CONSUMER_CORE);
+    xSemaphoreTake(ctx->done, portMAX_DELAY);
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < ctx->count; i++)
+    {
+        event.keyboard.keycode = (uint8_t)i;
+        xQueueSend(ctx->queue, &event, portMAX_DELAY);
+    }
+    xSemaphoreTake(ctx->done, portMAX_DELAY);
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    vQueueDelete(ctx->queue);
+    return elapsed;
+}
+
+void input_bench_run(uint32_t count)
+{
+    bench_ctx_t ctx = {.count = count};
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    ctx.done = xSemaphoreCreateBinary();
+    if (ctx.done == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create semaphore");
+        return;
+    }
+
+    int64_t ring_us = bench_run_ring(&ctx);
+    uint32_t ring_checksum = ctx.checksum;
+    int64_t queue_us = bench_run_queue(&ctx);
+
+    if (queue_us < 0 || ring_checksum != ctx.checksum)
+    {
+        ESP_LOGE(TAG, "Benchmark failed");
+    }
+    else
+    {
+        printf("%" PRIu32 " events, depth %d\n", count, INPUT_RING_SIZE);
+        printf("ring:  %8lld us  %6.3f us/event\n", ring_us, (double)ring_us / count);
+        printf("queue: %8lld us  %6.3f us/event\n", queue_us, (double)queue_us / count);
+    }
+
+    vSemaphoreDelete(ctx.done);
+}
+
+static void bench_latency_producer(void *arg)
+{
+    bench_ctx_t *ctx = arg;
+    input_event_t event = {.type = INPUT_EVENT_MOUSE};
+
+    for (uint32_t i = 0; i < ctx->count; i++)
+    {
+        /* Paced like real input, so every sample includes the consumer's wakeup */
+        vTaskDelay(1);
+        while (!input_ring_push(ctx->ring, &event))
+        {
+            vTaskDelay(1);
+        }
+    }
+
+    /* The consumer reports completion once it has seen the last event */
+    vTaskDelete(NULL);
+}
+
+static void bench_latency_consumer(void *arg)
+{
+    bench_ctx_t *ctx = arg;
+    input_event_t event;
+    uint32_t received = 0;
+
+    input_ring_set_consumer(ctx->ring, xTaskGetCurrentTaskHandle());
+    xSemaphoreGive(ctx->done);
+
+    while (received < ctx->count)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (received < ctx->count && input_ring_pop(ctx->ring, &event))
+        {
+            ctx->latency_us[received++] = (uint32_t)esp_timer_get_time() - event.timestamp_us;
+        }
+    }
+
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static int bench_compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+void input_bench_latency(uint32_t samples)
+{
+    bench_ctx_t ctx = {.count = samples, .ring = &bench_ring};
+
+    if (samples == 0)
+    {
+        return;
+    }
+
+    ctx.done = xSemaphoreCreateBinary();
+    ctx.latency_us = malloc(samples * sizeof(uint32_t));
+    if (ctx.done == NULL || ctx.latency_us == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate benchmark state");
+        goto cleanup;
+    }
+
+    printf("%-10s %8s %8s %8s %8s  (us, %" PRIu32 " samples)\n", "layout", "p50", "p90", "p99", "max", samples);
+    for (int i = 0; i < sizeof(bench_layouts) / sizeof(bench_layouts[0]); i++)
+    {
+        const bench_layout_t *layout = &bench_layouts[i];
+
+        input_ring_init(&bench_ring);
+        xTaskCreatePinnedToCore(&bench_latency_consumer, "bench_cons", BENCH_CONSUMER_STACK, &ctx,
+                                CONFIG_KBM_HID_TASK_PRIORITY, NULL, layout->consumer_core);
+        xSemaphoreTake(ctx.done, portMAX_DELAY);
+        xTaskCreatePinnedToCore(&bench_latency_producer, "bench_prod", BENCH_CONSUMER_STACK, &ctx,
+                                CONFIG_KBM_CONSOLE_TASK_PRIORITY, NULL, layout->producer_core);
+
+        xSemaphoreTake(ctx.done, portMAX_DELAY);
+
+        qsort(ctx.latency_us, samples, sizeof(uint32_t), &bench_compare_u32);
+        printf("%-10s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", layout->name,
+               ctx.latency_us[samples / 2], ctx.latency_us[samples * 9 / 10],
+               ctx.latency_us[samples * 99 / 100], ctx.latency_us[samples - 1]);
+    }
+
+cleanup:
+    free(ctx.latency_us);
+    if (ctx.done != NULL)
+    {
+        vSemaphoreDelete(ctx.done);
+    }
+}
+
+static void bench_typing_sink(uint8_t modifier, uint8_t keycode, void *ctx)
+{
+    (*(uint32_t *)ctx)++;
+}
+
+void input_bench_typing(uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    printf("%" PRIu32 " runs per text, reports discarded\n", count);
+    printf("%5s %8s %12s %12s %8s\n", "chars", "reports", "cold us/run", "warm us/run", "speedup");
+    for (int i = 0; i < sizeof(bench_texts) / sizeof(bench_texts[0]); i++)
+    {
+        const char *text = bench_texts[i];
+        size_t len = strlen(text);
+        uint32_t reports = 0;
+        bool caps = false;
+
+        /* Cold: every run plans from scratch and fills a cache slot */
+        int64_t start = esp_timer_get_time();
+        for (uint32_t n = 0; n < count; n++)
+        {
+            typing_cache_clear();
+            caps = false;
+            typing_plan(text, len, &caps, &bench_typing_sink, &reports);
+        }
+        int64_t cold_us = esp_timer_get_time() - start;
+
+        /* Warm: the text is cached, every run replays it */
+        start = esp_timer_get_time();
+        for (uint32_t n = 0; n < count; n++)
+        {
+            caps = false;
+            typing_plan(text, len, &caps, &bench_typing_sink, &reports);
+        }
+        int64_t warm_us = esp_timer_get_time() - start;
+
+        printf("%5u %8" PRIu32 " %12.1f %12.1f %7.1fx\n", (unsigned)len, reports / (2 * count),
+               (double)cold_us / count, (double)warm_us / count, warm_us > 0 ? (double)cold_us / warm_us : 0.0);
+    }
+
+    typing_cache_clear();
+}
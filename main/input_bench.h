@@ -0,0 +1,28 @@
+#ifndef INPUT_BENCH_H
+#define INPUT_BENCH_H
+
+#include <stdint.h>
+
+/*
+    Pushes count events through an input ring and through a FreeRTOS queue of the same depth,
+    each to a consumer task on the other core, and prints the cost per event of both paths.
+    Runs on the calling task; only meant for the console.
+*/
+void input_bench_run(uint32_t count);
+
+/*
+    Measures push-to-pop latency through an input ring for each task layout: producer and
+    consumer on separate cores as in KBM_TASK_LAYOUT_PINNED, both on the Bluedroid core, and
+    both unpinned. Tasks use the configured console and HID priorities, the producer sends one
+    event per tick, and the distribution is printed per layout.
+*/
+void input_bench_latency(uint32_t samples);
+
+/*
+    Plans sample texts count times each with an empty typing cache, then count times with
+    the text cached, and prints the time per run of both. Clears the typing cache, and the
+    runs show up in the typing cache counters.
+*/
+void input_bench_typing(uint32_t count);
+
+#endif
@@ -0,0 +1,89 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "esp_log.h"
+
+#include "hid_stats.h"
+#include "input_frame.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_FRAME"
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+/* Length of the record at data[pos], 0 if it is of an unknown type or runs past len */
+static size_t record_length(const uint8_t *data, size_t len, size_t pos)
+{
+    size_t record_len;
+
+    switch (data[pos])
+    {
+    case INPUT_FRAME_KEY:
+        record_len = 3;
+        break;
+    case INPUT_FRAME_MOUSE:
+        record_len = 4;
+        break;
+    default:
+        return 0;
+    }
+
+    return pos + record_len > len ? 0 : record_len;
+}
+
+bool input_frame_parse(const uint8_t *data, size_t len, input_ring_t *ring)
+{
+    size_t records = 0;
+    size_t valid_len = 0;
+    size_t record_len;
+
+    hid_stats_inc(HID_STAT_RX_FRAME);
+
+    /* Validate first, so the frame goes into the ring whole or not at all */
+    while (valid_len < len && (record_len = record_length(data, len, valid_len)) != 0)
+    {
+        valid_len += record_len;
+        records++;
+    }
+
+    if (valid_len < len)
+    {
+        ESP_LOGW(TAG, "Malformed record at offset %u of %u, rest of frame ignored", (unsigned)valid_len, (unsigned)len);
+        hid_stats_inc(HID_STAT_FRAME_ERROR);
+    }
+
+    if (records > input_ring_space(ring))
+    {
+        ESP_LOGD(TAG, "Frame of %u records rejected, ring has room for %u", (unsigned)records,
+                 (unsigned)input_ring_space(ring));
+        hid_stats_inc(HID_STAT_DROP_FRAME);
+        return false;
+    }
+
+    for (size_t pos = 0; pos < valid_len; pos += record_length(data, len, pos))
+    {
+        input_event_t event;
+
+        if (data[pos] == INPUT_FRAME_KEY)
+        {
+            event.type = INPUT_EVENT_KEYBOARD;
+            event.keyboard.modifier = data[pos + 1];
+            event.keyboard.keycode = data[pos + 2];
+        }
+        else
+        {
+            event.type = INPUT_EVENT_MOUSE;
+            event.mouse.mouse_buttons = data[pos + 1];
+            event.mouse.movement_x = (int8_t)data[pos + 2];
+            event.mouse.movement_y = (int8_t)data[pos + 3];
+        }
+
+        /* Cannot fail: only this task pushes, and the space checked above only grows */
+        input_ring_push(ring, &event);
+    }
+
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef INPUT_FRAME_H
+#define INPUT_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "input_ring.h"
+
+/*
+    Batched input frames, as written to the input characteristic of the vendor GATT service
+    (CONFIG_KBM_BLE_INPUT_SERVICE). The HID vendor output report took them too, but no longer
+    fits the report map, see SUPPORT_REPORT_VENDOR. One write carries any number of records
+    back to back, up to the negotiated MTU:
+
+        0x01 <modifier> <keycode>       key tap, pressed and released
+        0x02 <buttons> <dx> <dy>        mouse, dx and dy signed
+
+    Parsing stops at the first unknown type or truncated record; everything before it is kept.
+
+    A frame goes into the ring whole or not at all. When the ring cannot take every record,
+    the frame is dropped and the input service notifies its Frame Status characteristic with
+    the 16-bit little endian sequence number of the dropped write, counted from 0 for the
+    first frame written on the connection. Writes without response arrive in order, so the
+    central knows exactly which frames to send again.
+*/
+
+#define INPUT_FRAME_KEY     0x01
+#define INPUT_FRAME_MOUSE   0x02
+
+/* Pushes the frame's records to ring. Returns false, pushing nothing, when they do not all fit */
+bool input_frame_parse(const uint8_t *data, size_t len, input_ring_t *ring);
+
+#endif
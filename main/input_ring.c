@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <string.h>
+#include "esp_timer.h"
+
+#include "input_ring.h"
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void input_ring_init(input_ring_t *ring)
+{
+    memset(ring->events, 0, sizeof(ring->events));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->consumer = NULL;
+}
+
+void input_ring_set_consumer(input_ring_t *ring, TaskHandle_t consumer)
+{
+    ring->consumer = consumer;
+}
+
+bool input_ring_push(input_ring_t *ring, const input_event_t *event)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail == INPUT_RING_SIZE)
+    {
+        return false;
+    }
+
+    input_event_t *slot = &ring->events[head & (INPUT_RING_SIZE - 1)];
+    *slot = *event;
+    slot->timestamp_us = (uint32_t)esp_timer_get_time();
+
+    /*
+        Sequentially consistent store and load: either the consumer sees the new head before
+        it goes to sleep, or we see that it had already emptied the ring and wake it.
+    */
+    atomic_store_explicit(&ring->head, head + 1, memory_order_seq_cst);
+    tail = atomic_load_explicit(&ring->tail, memory_order_seq_cst);
+
+    if (tail == head && ring->consumer != NULL)
+    {
+        xTaskNotifyGive(ring->consumer);
+    }
+    return true;
+}
+
+uint32_t input_ring_space(input_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    return INPUT_RING_SIZE - (head - tail);
+}
+
+bool input_ring_pop(input_ring_t *ring, input_event_t *event)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_seq_cst);
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    *event = ring->events[tail & (INPUT_RING_SIZE - 1)];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_seq_cst);
+    return true;
+}
+
+bool input_ring_peek(input_ring_t *ring, input_event_t *event)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_seq_cst);
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    *event = ring->events[tail & (INPUT_RING_SIZE - 1)];
+    return true;
+}
+
+void input_ring_skip(input_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_seq_cst);
+}
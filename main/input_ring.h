@@ -0,0 +1,56 @@
+#ifndef INPUT_RING_H
+#define INPUT_RING_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "sdkconfig.h"
+#include "ble_kbm_types.h"
+
+/*
+    Single-producer/single-consumer ring of input events. Exactly one task pushes and
+    exactly one task pops, so neither side takes a lock or enters a critical section. The
+    producer wakes the consumer with a task notification when the ring goes from empty to
+    non-empty; the consumer drains the ring fully before it waits again, or, when it has to
+    leave an event in the ring, waits with a timeout and retries it.
+
+    Give every producing task its own ring.
+*/
+
+#define INPUT_RING_SIZE CONFIG_KBM_INPUT_RING_SIZE
+
+_Static_assert((INPUT_RING_SIZE & (INPUT_RING_SIZE - 1)) == 0, "CONFIG_KBM_INPUT_RING_SIZE must be a power of two");
+
+typedef struct
+{
+    atomic_uint_least32_t head;     /* next slot to write, producer only */
+    atomic_uint_least32_t tail;     /* next slot to read, consumer only */
+    TaskHandle_t consumer;
+    input_event_t events[INPUT_RING_SIZE];
+} input_ring_t;
+
+void input_ring_init(input_ring_t *ring);
+
+/* Called by the consumer before it starts waiting; pushes before that are picked up on its first drain */
+void input_ring_set_consumer(input_ring_t *ring, TaskHandle_t consumer);
+
+/* Producer side. Returns false when the ring is full */
+bool input_ring_push(input_ring_t *ring, const input_event_t *event);
+
+/* Producer side. Free slots; only grows until the next push */
+uint32_t input_ring_space(input_ring_t *ring);
+
+/* Consumer side. Returns false when the ring is empty */
+bool input_ring_pop(input_ring_t *ring, input_event_t *event);
+
+/* Consumer side. Copies the oldest event without removing it; false when the ring is empty */
+bool input_ring_peek(input_ring_t *ring, input_event_t *event);
+
+/* Consumer side. Removes the event input_ring_peek() returned */
+void input_ring_skip(input_ring_t *ring);
+
+#endif
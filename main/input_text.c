@@ -0,0 +1,234 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+
+#include "esp_hidd_prf_api.h"
+#include "gamepad_stream.h"
+#include "hid_stats.h"
+#include "input_text.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_TEXT"
+
+#define INPUT_TEXT_MAX_VALUES 3
+
+/* A line must fit the ring whole */
+#define INPUT_TEXT_LINE_EVENTS \
+    (INPUT_TEXT_MAX_EVENTS < INPUT_RING_SIZE ? INPUT_TEXT_MAX_EVENTS : INPUT_RING_SIZE)
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static bool is_space(char c);
+static int parse_record(const char **pos, long *values);
+static bool in_range(long value, long min, long max);
+static input_text_result_t parse_gamepad(const char *line);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/* Reads values up to the next ';' or the end of the line, returns how many or -1 on garbage */
+static int parse_record(const char **pos, long *values)
+{
+    const char *p = *pos;
+    int count = 0;
+
+    while (1)
+    {
+        while (is_space(*p))
+        {
+            p++;
+        }
+        if (*p == '\0' || *p == ';')
+        {
+            break;
+        }
+        if (count == INPUT_TEXT_MAX_VALUES)
+        {
+            return -1;
+        }
+
+        /* strtol takes the sign, so "-30" is a value and never an option */
+        char *end;
+        values[count] = strtol(p, &end, 0);
+        if (end == p || (*end != '\0' && *end != ';' && !is_space(*end)))
+        {
+            return -1;
+        }
+        count++;
+        p = end;
+    }
+
+    *pos = *p == ';' ? p + 1 : p;
+    return count;
+}
+
+static bool in_range(long value, long min, long max)
+{
+    return value >= min && value <= max;
+}
+
+/* "gp ..." is one gamepad state; it bypasses the ring and goes to the stream, which merges samples */
+static input_text_result_t parse_gamepad(const char *line)
+{
+    long long values[2 + GAMEPAD_NUM_AXES] = {0, HID_GAMEPAD_HAT_CENTERED};
+    const char *p = &line[3];
+    int count = 0;
+
+    while (1)
+    {
+        while (is_space(*p))
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        /* Buttons take all 32 bits, more than a long holds here */
+        char *end;
+        long long value = strtoll(p, &end, 0);
+        long long min = count < 2 ? 0 : -32767;
+        long long max = count == 0 ? UINT32_MAX : count == 1 ? HID_GAMEPAD_HAT_CENTERED : 32767;
+        if (count == 2 + GAMEPAD_NUM_AXES || end == p || (*end != '\0' && !is_space(*end)) || value < min ||
+            value > max)
+        {
+            ESP_LOGE(TAG, "Bad gamepad value at column %d of '%s'", (int)(p - line) + 1, line);
+            return INPUT_TEXT_ERROR;
+        }
+        values[count++] = value;
+        p = end;
+    }
+
+    if (count == 0)
+    {
+        ESP_LOGE(TAG, "'gp' needs at least the buttons");
+        return INPUT_TEXT_ERROR;
+    }
+
+    gamepad_t sample = {.buttons = values[0], .hat = values[1]};
+    for (int i = 0; i < GAMEPAD_NUM_AXES; i++)
+    {
+        sample.axes[i] = values[2 + i];
+    }
+    gamepad_stream_update(&sample);
+    return INPUT_TEXT_OK;
+}
+
+input_text_result_t input_text_parse(const char *line, input_ring_t *ring, size_t *pushed)
+{
+    input_event_t events[INPUT_TEXT_MAX_EVENTS];
+    size_t count = 0;
+    char cmd = line[0];
+
+    *pushed = 0;
+
+    if (cmd == 'g' && line[1] == 'p' && is_space(line[2]))
+    {
+        return parse_gamepad(line);
+    }
+
+    if ((cmd != 'r' && cmd != 'k' && cmd != 'm' && cmd != 'c') || !is_space(line[1]))
+    {
+        return INPUT_TEXT_NOT_HANDLED;
+    }
+
+    const char *pos = &line[2];
+    while (*pos != '\0')
+    {
+        const char *record = pos;
+        long values[INPUT_TEXT_MAX_VALUES];
+        int n = parse_record(&pos, values);
+        input_event_t *event = &events[count];
+
+        if (n == 0)
+        {
+            /* Empty record, e.g. a trailing ';' */
+            continue;
+        }
+        if (count + (cmd == 'c' ? 2 : 1) > INPUT_TEXT_LINE_EVENTS)
+        {
+            ESP_LOGE(TAG, "More than %d events on one line", INPUT_TEXT_LINE_EVENTS);
+            return INPUT_TEXT_ERROR;
+        }
+
+        bool valid = false;
+        switch (cmd)
+        {
+        case 'r':
+        case 'k':
+            valid = n == 2 && in_range(values[0], 0, UINT8_MAX) && in_range(values[1], 0, UINT8_MAX);
+            event->type = cmd == 'r' ? INPUT_EVENT_KEYBOARD : INPUT_EVENT_KEY_REPORT;
+            event->keyboard.modifier = values[0];
+            event->keyboard.keycode = values[1];
+            count++;
+            break;
+        case 'm':
+            valid = n == 3 && in_range(values[0], 0, UINT8_MAX) && in_range(values[1], -127, 127) &&
+                    in_range(values[2], -127, 127);
+            event->type = INPUT_EVENT_MOUSE;
+            event->mouse.mouse_buttons = values[0];
+            event->mouse.movement_x = values[1];
+            event->mouse.movement_y = values[2];
+            count++;
+            break;
+        case 'c':
+            valid = (n == 1 || (n == 2 && in_range(values[1], 0, 1))) && in_range(values[0], 0, UINT8_MAX);
+            event->type = INPUT_EVENT_CONSUMER;
+            event->consumer.usage = values[0];
+            event->consumer.pressed = n == 2 ? values[1] : 1;
+            count++;
+            if (n == 1)
+            {
+                events[count] = *event;
+                events[count].consumer.pressed = 0;
+                count++;
+            }
+            break;
+        }
+
+        if (!valid)
+        {
+            ESP_LOGE(TAG, "Bad record at column %d of '%s'", (int)(record - line) + 1, line);
+            return INPUT_TEXT_ERROR;
+        }
+    }
+
+    if (count == 0)
+    {
+        ESP_LOGE(TAG, "'%c' needs at least one record", cmd);
+        return INPUT_TEXT_ERROR;
+    }
+
+    /* The HID task frees slots as the link drains; half a line would leave keys held */
+    TickType_t start = xTaskGetTickCount();
+    while (input_ring_space(ring) < count)
+    {
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(INPUT_TEXT_WAIT_MS))
+        {
+            ESP_LOGE(TAG, "Input ring full, %u events dropped", (unsigned)count);
+            hid_stats_inc(cmd == 'm' ? HID_STAT_DROP_MOUSE : HID_STAT_DROP_KEYBOARD);
+            return INPUT_TEXT_ERROR;
+        }
+        vTaskDelay(1);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        input_ring_push(ring, &events[i]);
+    }
+    *pushed = count;
+    return INPUT_TEXT_OK;
+}
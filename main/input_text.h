@@ -0,0 +1,42 @@
+#ifndef INPUT_TEXT_H
+#define INPUT_TEXT_H
+
+#include <stddef.h>
+
+#include "input_ring.h"
+
+/*
+    Fast path for the hot console commands, parsed by hand before a line reaches esp_console
+    and argtable3. Each command takes any number of records separated by ';'. Values are
+    decimal or 0x hex, and dx and dy may be negative:
+
+        r <modifier> <keycode>          key tap, pressed and released
+        k <modifier> <keycode>          keyboard report, held until the next one; "k 0 0" releases
+        m <buttons> <dx> <dy>           mouse, e.g. "m 0 -30 0; 0 -30 0; 1 0 0"
+        c <usage> [<pressed>]           consumer control, a tap without pressed
+        gp <buttons> [<hat> [<x> <y> <z> <rx> <ry> <rz>]]
+                                        gamepad state, one record; axes -32767 to 32767,
+                                        hat 8 centered
+
+    The whole line is parsed before anything is pushed, so a typo sends nothing, and the
+    events then go to the ring back to back and wake the HID task once. A line goes in
+    whole or not at all: when the ring lacks room it waits up to INPUT_TEXT_WAIT_MS for
+    the HID task to make some, then gives up without pushing. gp goes to the gamepad
+    stream instead of the ring.
+*/
+
+/* Records per line; a consumer tap counts twice */
+#define INPUT_TEXT_MAX_EVENTS 32
+#define INPUT_TEXT_WAIT_MS    200
+
+typedef enum
+{
+    INPUT_TEXT_NOT_HANDLED,     /* not a fast path command, hand the line to esp_console */
+    INPUT_TEXT_OK,
+    INPUT_TEXT_ERROR,           /* malformed or no room, nothing pushed */
+} input_text_result_t;
+
+/* *pushed is the number of events the ring accepted, all of the line's or none */
+input_text_result_t input_text_parse(const char *line, input_ring_t *ring, size_t *pushed);
+
+#endif
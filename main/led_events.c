@@ -0,0 +1,109 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+#include "led_events.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_LED"
+
+typedef struct
+{
+    led_event_cb_t cb;
+    void *ctx;
+} led_subscriber_t;
+
+static portMUX_TYPE led_lock = portMUX_INITIALIZER_UNLOCKED;
+static led_subscriber_t subscribers[LED_EVENTS_MAX_SUBSCRIBERS];
+static led_event_t last_event;
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+esp_err_t led_events_subscribe(led_event_cb_t cb, void *ctx)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    portENTER_CRITICAL(&led_lock);
+    for (int i = 0; i < LED_EVENTS_MAX_SUBSCRIBERS; i++)
+    {
+        if (subscribers[i].cb == NULL)
+        {
+            subscribers[i].cb = cb;
+            subscribers[i].ctx = ctx;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&led_lock);
+
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "No free LED subscriber slot");
+    }
+    return ret;
+}
+
+void led_events_unsubscribe(led_event_cb_t cb, void *ctx)
+{
+    portENTER_CRITICAL(&led_lock);
+    for (int i = 0; i < LED_EVENTS_MAX_SUBSCRIBERS; i++)
+    {
+        if (subscribers[i].cb == cb && subscribers[i].ctx == ctx)
+        {
+            subscribers[i].cb = NULL;
+            subscribers[i].ctx = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&led_lock);
+}
+
+void led_events_publish(uint16_t conn_id, uint8_t leds)
+{
+    led_event_t event;
+    led_subscriber_t targets[LED_EVENTS_MAX_SUBSCRIBERS];
+
+    portENTER_CRITICAL(&led_lock);
+    event.timestamp_us = esp_timer_get_time();
+    event.conn_id = conn_id;
+    event.leds = leds;
+    event.changed = leds ^ last_event.leds;
+    last_event = event;
+    memcpy(targets, subscribers, sizeof(targets));
+    portEXIT_CRITICAL(&led_lock);
+
+    /* Callbacks run outside the lock so they may subscribe or read led_events_last() */
+    for (int i = 0; i < LED_EVENTS_MAX_SUBSCRIBERS; i++)
+    {
+        if (targets[i].cb != NULL)
+        {
+            targets[i].cb(&event, targets[i].ctx);
+        }
+    }
+}
+
+void led_events_restore(uint8_t leds)
+{
+    portENTER_CRITICAL(&led_lock);
+    last_event.leds = leds;
+    portEXIT_CRITICAL(&led_lock);
+}
+
+led_event_t led_events_last(void)
+{
+    led_event_t event;
+
+    portENTER_CRITICAL(&led_lock);
+    event = last_event;
+    portEXIT_CRITICAL(&led_lock);
+
+    return event;
+}
@@ -0,0 +1,40 @@
+#ifndef LED_EVENTS_H
+#define LED_EVENTS_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "hid_codes.h"
+
+#define LED_EVENTS_MAX_SUBSCRIBERS 4
+
+typedef struct
+{
+    int64_t timestamp_us;   /* esp_timer time the host write was received */
+    uint16_t conn_id;
+    uint8_t leds;           /* LED_* bits as written by the host */
+    uint8_t changed;        /* bits that differ from the previous event */
+} led_event_t;
+
+/*
+    Subscribers are called from the Bluetooth stack's callback context as soon as the host
+    writes the LED report. Keep them short: copy what is needed and hand off to your own task.
+*/
+typedef void (*led_event_cb_t)(const led_event_t *event, void *ctx);
+
+esp_err_t led_events_subscribe(led_event_cb_t cb, void *ctx);
+void led_events_unsubscribe(led_event_cb_t cb, void *ctx);
+
+void led_events_publish(uint16_t conn_id, uint8_t leds);
+
+/*
+    Seeds the LED state from before a deep sleep without notifying anyone. Subscribers that
+    care read led_events_last() when they start; the timestamp stays 0 until the host writes.
+*/
+void led_events_restore(uint8_t leds);
+
+/* Most recent event, timestamp 0 if the host has not written LEDs yet */
+led_event_t led_events_last(void);
+
+#endif
@@ -0,0 +1,590 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "esp32/rom/crc.h"
+
+#include "macro_store.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_MACRO"
+
+#define MACRO_RECORD_MAGIC  0x4d41434b  /* "KCAM" */
+#define MACRO_HALF_MAGIC    0x464c484b  /* "KHLF" */
+#define MACRO_ERASED_WORD   0xffffffff
+
+/* Each state only clears bits of the one before, so it is programmed without an erase */
+#define RECORD_WRITING      0xfe
+#define RECORD_LIVE         0xfc
+#define RECORD_DEAD         0xf8
+
+#define ALIGN_UP(x, a)      (((x) + (a) - 1) & ~((a) - 1))
+#define ALIGN_DOWN(x, a)    ((x) & ~((a) - 1))
+
+/*
+    Starts each half of the partition. The log lives in the half with the newest valid header;
+    compaction copies it to the other half and writes that half's header last, so a reset at
+    any point leaves one complete library.
+*/
+typedef struct
+{
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t reserved;
+    uint32_t crc;           /* crc32_le over the fields above */
+} macro_half_t;
+
+_Static_assert(sizeof(macro_half_t) == 16, "macro_half_t is stored in flash");
+
+/* Followed by the name, then the data, padded to a word */
+typedef struct
+{
+    uint32_t magic;
+    uint8_t state;
+    uint8_t type;
+    uint8_t name_len;
+    uint8_t reserved;
+    uint32_t len;
+    uint32_t crc;           /* crc32_le over name and data, written at commit */
+} macro_record_t;
+
+_Static_assert(sizeof(macro_record_t) == 16, "macro_record_t is stored in flash");
+
+static const esp_partition_t *partition;
+static spi_flash_mmap_handle_t mmap_handle;
+static const uint8_t *base;
+
+static uint32_t half_size;
+static uint32_t half_base;      /* start of the active half */
+static uint32_t generation;
+
+/* Offsets of live records, ascending */
+static uint32_t index_offset[MACRO_STORE_MAX_ENTRIES];
+static size_t index_len;
+
+/* Records of the active half lie in [log_start, log_end) */
+static size_t log_start;
+static size_t log_end;
+/* Unreadable data past log_end; appends wait for a compaction */
+static bool log_broken;
+
+static struct
+{
+    bool active;
+    uint32_t offset;
+    uint32_t written;
+    uint32_t crc;
+} upload;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static const macro_record_t *record_at(uint32_t offset);
+static size_t record_size(const macro_record_t *record);
+static esp_err_t set_state(uint32_t offset, uint8_t state);
+static int index_find(const char *name);
+static void index_remove(int i);
+static void index_append(uint32_t offset);
+static void fill_macro(uint32_t offset, macro_t *macro);
+static bool half_header(uint32_t offset, uint32_t *gen);
+static esp_err_t half_erase(uint32_t offset);
+static esp_err_t half_open(uint32_t offset, uint32_t gen);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static const macro_record_t *record_at(uint32_t offset)
+{
+    return (const macro_record_t *)(base + offset);
+}
+
+static size_t record_size(const macro_record_t *record)
+{
+    return sizeof(macro_record_t) + ALIGN_UP((size_t)record->name_len + record->len, 4);
+}
+
+static esp_err_t set_state(uint32_t offset, uint8_t state)
+{
+    return esp_partition_write(partition, offset + offsetof(macro_record_t, state), &state, 1);
+}
+
+static int index_find(const char *name)
+{
+    size_t len = strlen(name);
+
+    for (size_t i = 0; i < index_len; i++)
+    {
+        const macro_record_t *record = record_at(index_offset[i]);
+        if (record->name_len == len && memcmp(record + 1, name, len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void index_remove(int i)
+{
+    memmove(&index_offset[i], &index_offset[i + 1], (index_len - i - 1) * sizeof(index_offset[0]));
+    index_len--;
+}
+
+/* A record of the same name earlier in the log is superseded */
+static void index_append(uint32_t offset)
+{
+    const macro_record_t *record = record_at(offset);
+    char name[MACRO_STORE_MAX_NAME + 1];
+
+    memcpy(name, record + 1, record->name_len);
+    name[record->name_len] = '\0';
+
+    int i = index_find(name);
+    if (i >= 0)
+    {
+        index_remove(i);
+    }
+    if (index_len == MACRO_STORE_MAX_ENTRIES)
+    {
+        ESP_LOGW(TAG, "Index full, '%s' is not reachable", name);
+        return;
+    }
+    index_offset[index_len++] = offset;
+}
+
+static void fill_macro(uint32_t offset, macro_t *macro)
+{
+    const macro_record_t *record = record_at(offset);
+
+    memcpy(macro->name, record + 1, record->name_len);
+    macro->name[record->name_len] = '\0';
+    macro->type = record->type;
+    macro->data = (const uint8_t *)(record + 1) + record->name_len;
+    macro->len = record->len;
+}
+
+static bool half_header(uint32_t offset, uint32_t *gen)
+{
+    const macro_half_t *header = (const macro_half_t *)(base + offset);
+
+    if (header->magic != MACRO_HALF_MAGIC ||
+        header->crc != crc32_le(0, (const uint8_t *)header, offsetof(macro_half_t, crc)))
+    {
+        return false;
+    }
+    *gen = header->generation;
+    return true;
+}
+
+/* Erases the sectors of a half that are not blank already; a mostly unused half is quick */
+static esp_err_t half_erase(uint32_t offset)
+{
+    for (uint32_t sector = offset; sector < offset + half_size; sector += SPI_FLASH_SEC_SIZE)
+    {
+        const uint32_t *word = (const uint32_t *)(base + sector);
+        size_t i = 0;
+
+        while (i < SPI_FLASH_SEC_SIZE / sizeof(uint32_t) && word[i] == MACRO_ERASED_WORD)
+        {
+            i++;
+        }
+        if (i < SPI_FLASH_SEC_SIZE / sizeof(uint32_t))
+        {
+            esp_err_t ret = esp_partition_erase_range(partition, sector, SPI_FLASH_SEC_SIZE);
+            if (ret != ESP_OK)
+            {
+                return ret;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+/* Writes the header that makes an erased or freshly filled half the active one */
+static esp_err_t half_open(uint32_t offset, uint32_t gen)
+{
+    macro_half_t header = {
+        .magic = MACRO_HALF_MAGIC,
+        .generation = gen,
+        .reserved = MACRO_ERASED_WORD,
+    };
+    header.crc = crc32_le(0, (const uint8_t *)&header, offsetof(macro_half_t, crc));
+
+    return esp_partition_write(partition, offset, &header, sizeof(header));
+}
+
+esp_err_t macro_store_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, MACRO_STORE_PARTITION_SUBTYPE,
+                                         MACRO_STORE_PARTITION_LABEL);
+    if (partition == NULL)
+    {
+        ESP_LOGW(TAG, "No '%s' partition, macros cannot be stored", MACRO_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr;
+    esp_err_t ret = esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &ptr, &mmap_handle);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map %u bytes: %s", partition->size, esp_err_to_name(ret));
+        partition = NULL;
+        return ret;
+    }
+    base = ptr;
+    half_size = ALIGN_DOWN(partition->size / 2, SPI_FLASH_SEC_SIZE);
+
+    uint32_t gen_a, gen_b;
+    bool valid_a = half_header(0, &gen_a);
+    bool valid_b = half_header(half_size, &gen_b);
+    if (valid_a && (!valid_b || (int32_t)(gen_a - gen_b) > 0))
+    {
+        half_base = 0;
+        generation = gen_a;
+    }
+    else if (valid_b)
+    {
+        half_base = half_size;
+        generation = gen_b;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "No macro library found, formatting");
+        half_base = 0;
+        generation = 1;
+        ret = half_erase(half_base);
+        if (ret == ESP_OK)
+        {
+            ret = half_open(half_base, generation);
+        }
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to format: %s", esp_err_to_name(ret));
+            partition = NULL;
+            return ret;
+        }
+    }
+    log_start = half_base + sizeof(macro_half_t);
+
+    /* Only headers are touched; the data stays in flash until it is played */
+    uint32_t offset = log_start;
+    size_t log_limit = half_base + half_size;
+    while (offset + sizeof(macro_record_t) <= log_limit)
+    {
+        const macro_record_t *record = record_at(offset);
+
+        if (record->magic == MACRO_ERASED_WORD)
+        {
+            break;
+        }
+        if (record->magic != MACRO_RECORD_MAGIC || record->name_len == 0 ||
+            record->name_len > MACRO_STORE_MAX_NAME || record->len > half_size ||
+            offset + record_size(record) > log_limit)
+        {
+            ESP_LOGW(TAG, "Unreadable record at 0x%x, compact to reuse the space after it", offset);
+            log_broken = true;
+            break;
+        }
+        if (record->state == RECORD_LIVE)
+        {
+            if (crc32_le(0, (const uint8_t *)(record + 1), record->name_len + record->len) == record->crc)
+            {
+                index_append(offset);
+            }
+            else
+            {
+                ESP_LOGW(TAG, "Checksum mismatch at 0x%x, record skipped", offset);
+            }
+        }
+        offset += record_size(record);
+    }
+    log_end = offset;
+
+    ESP_LOGI(TAG, "%u macros, %u of %u bytes used in half %u", index_len, log_end - log_start,
+             half_size - sizeof(macro_half_t), half_base / half_size);
+    return ESP_OK;
+}
+
+esp_err_t macro_store_find(const char *name, macro_t *macro)
+{
+    if (partition == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int i = index_find(name);
+    if (i < 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    fill_macro(index_offset[i], macro);
+    return ESP_OK;
+}
+
+esp_err_t macro_store_get(size_t index, macro_t *macro)
+{
+    if (partition == NULL || index >= index_len)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    fill_macro(index_offset[index], macro);
+    return ESP_OK;
+}
+
+esp_err_t macro_store_begin(const char *name, macro_type_t type, uint32_t len)
+{
+    size_t name_len = strlen(name);
+
+    if (partition == NULL || upload.active || log_broken)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (name_len == 0 || name_len > MACRO_STORE_MAX_NAME)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Committing it anyway would store a macro the index cannot reach and compaction then erases */
+    if (index_len == MACRO_STORE_MAX_ENTRIES && index_find(name) < 0)
+    {
+        ESP_LOGW(TAG, "Library holds %d macros, delete one to store '%s'", MACRO_STORE_MAX_ENTRIES, name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    const macro_record_t header = {
+        .magic = MACRO_RECORD_MAGIC,
+        .state = RECORD_WRITING,
+        .type = type,
+        .name_len = name_len,
+        .reserved = 0xff,
+        .len = len,
+        .crc = MACRO_ERASED_WORD,
+    };
+    if (len > half_size || log_end + record_size(&header) > half_base + half_size)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* The header goes first, so a reset from here on leaves a record that can be skipped */
+    esp_err_t ret = esp_partition_write(partition, log_end, &header, sizeof(header));
+    if (ret == ESP_OK)
+    {
+        ret = esp_partition_write(partition, log_end + sizeof(header), name, name_len);
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to write header at 0x%x: %s", log_end, esp_err_to_name(ret));
+        log_broken = true;
+        return ret;
+    }
+
+    upload.active = true;
+    upload.offset = log_end;
+    upload.written = 0;
+    upload.crc = crc32_le(0, (const uint8_t *)name, name_len);
+    log_end += record_size(&header);
+    return ESP_OK;
+}
+
+esp_err_t macro_store_write(const void *data, size_t len)
+{
+    if (!upload.active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const macro_record_t *record = record_at(upload.offset);
+    if (upload.written + len > record->len)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = esp_partition_write(partition, upload.offset + sizeof(macro_record_t) + record->name_len +
+                                        upload.written, data, len);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    upload.crc = crc32_le(upload.crc, data, len);
+    upload.written += len;
+    return ESP_OK;
+}
+
+esp_err_t macro_store_commit(void)
+{
+    if (!upload.active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const macro_record_t *record = record_at(upload.offset);
+    if (upload.written != record->len)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t ret = esp_partition_write(partition, upload.offset + offsetof(macro_record_t, crc), &upload.crc,
+                                        sizeof(upload.crc));
+    if (ret == ESP_OK)
+    {
+        ret = set_state(upload.offset, RECORD_LIVE);
+    }
+    if (ret != ESP_OK)
+    {
+        macro_store_abort();
+        return ret;
+    }
+
+    /* The new record is live before the old one dies; a reset in between keeps the newer */
+    char name[MACRO_STORE_MAX_NAME + 1];
+    memcpy(name, record + 1, record->name_len);
+    name[record->name_len] = '\0';
+    int old = index_find(name);
+    if (old >= 0)
+    {
+        set_state(index_offset[old], RECORD_DEAD);
+    }
+
+    index_append(upload.offset);
+    upload.active = false;
+    ESP_LOGI(TAG, "Stored '%s', %u bytes", name, record->len);
+    return ESP_OK;
+}
+
+void macro_store_abort(void)
+{
+    if (upload.active)
+    {
+        set_state(upload.offset, RECORD_DEAD);
+        upload.active = false;
+    }
+}
+
+esp_err_t macro_store_append(const char *name, macro_type_t type, const void *data, uint32_t len)
+{
+    esp_err_t ret = macro_store_begin(name, type, len);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    ret = macro_store_write(data, len);
+    if (ret != ESP_OK)
+    {
+        macro_store_abort();
+        return ret;
+    }
+    return macro_store_commit();
+}
+
+esp_err_t macro_store_delete(const char *name)
+{
+    if (partition == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int i = index_find(name);
+    if (i < 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = set_state(index_offset[i], RECORD_DEAD);
+    if (ret == ESP_OK)
+    {
+        index_remove(i);
+    }
+    return ret;
+}
+
+esp_err_t macro_store_compact(void)
+{
+    if (partition == NULL || upload.active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t *copy_buf = malloc(SPI_FLASH_SEC_SIZE);
+    if (copy_buf == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /*
+        Live records are copied in log order into the other half through a sector of RAM; the
+        active half is only read. The other half's header goes last, so until it is written a
+        reset comes back to the library as it was.
+    */
+    uint32_t other = half_base == 0 ? half_size : 0;
+    size_t dst = other + sizeof(macro_half_t);
+    esp_err_t ret = half_erase(other);
+
+    for (size_t i = 0; i < index_len && ret == ESP_OK; i++)
+    {
+        const uint8_t *src = base + index_offset[i];
+        size_t remaining = record_size(record_at(index_offset[i]));
+
+        while (remaining > 0 && ret == ESP_OK)
+        {
+            size_t chunk = remaining < SPI_FLASH_SEC_SIZE ? remaining : SPI_FLASH_SEC_SIZE;
+
+            memcpy(copy_buf, src, chunk);
+            ret = esp_partition_write(partition, dst, copy_buf, chunk);
+            src += chunk;
+            dst += chunk;
+            remaining -= chunk;
+        }
+    }
+    free(copy_buf);
+
+    if (ret == ESP_OK)
+    {
+        ret = half_open(other, generation + 1);
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Compaction failed, library unchanged: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    /* The old half keeps its records until the next compaction erases it */
+    ESP_LOGI(TAG, "Compacted %u bytes into %u", log_end - log_start, dst - other - sizeof(macro_half_t));
+    size_t offset = other + sizeof(macro_half_t);
+    for (size_t i = 0; i < index_len; i++)
+    {
+        size_t size = record_size(record_at(index_offset[i]));
+        index_offset[i] = offset;
+        offset += size;
+    }
+    half_base = other;
+    generation++;
+    log_start = other + sizeof(macro_half_t);
+    log_end = dst;
+    log_broken = false;
+    return ESP_OK;
+}
+
+void macro_store_usage(macro_store_usage_t *usage)
+{
+    memset(usage, 0, sizeof(*usage));
+    if (partition == NULL)
+    {
+        return;
+    }
+
+    usage->capacity = half_size - sizeof(macro_half_t);
+    usage->used = log_end - log_start;
+    usage->entries = index_len;
+    for (size_t i = 0; i < index_len; i++)
+    {
+        usage->live += record_size(record_at(index_offset[i]));
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef MACRO_STORE_H
+#define MACRO_STORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/*
+    Library of named macros in the "macros" data partition (see partitions.csv). The
+    partition is memory mapped once at init, so a macro is read in place from flash; nothing
+    is copied to the heap. It is split in two halves, and the library is an append-only log
+    of records in one of them.
+
+    Deleting or replacing a macro only marks the old record dead. macro_store_compact()
+    copies the live records into the other half to reclaim the space.
+
+    Not thread safe; the console task owns the store.
+*/
+
+#define MACRO_STORE_PARTITION_LABEL     "macros"
+#define MACRO_STORE_PARTITION_SUBTYPE   0x40
+
+#define MACRO_STORE_MAX_NAME            31
+#define MACRO_STORE_MAX_ENTRIES         64
+
+typedef enum
+{
+    MACRO_TYPE_SCRIPT = 1,          /* script_vm bytecode */
+    MACRO_TYPE_CAPTURE = 2,         /* input_event_t records, see capture.h */
+} macro_type_t;
+
+typedef struct
+{
+    char name[MACRO_STORE_MAX_NAME + 1];
+    macro_type_t type;
+    const uint8_t *data;            /* mapped flash, valid until the next compaction */
+    uint32_t len;
+} macro_t;
+
+typedef struct
+{
+    size_t capacity;                /* partition size */
+    size_t used;                    /* end of the log */
+    size_t live;                    /* bytes in live records, headers included */
+    size_t entries;
+} macro_store_usage_t;
+
+/* Finds, maps and indexes the partition. ESP_ERR_NOT_FOUND when the partition table has none */
+esp_err_t macro_store_init(void);
+
+/* Looks a macro up by name; the data points into flash */
+esp_err_t macro_store_find(const char *name, macro_t *macro);
+
+/* i-th live macro in log order, for listing */
+esp_err_t macro_store_get(size_t index, macro_t *macro);
+
+/*
+    Appends a macro in pieces, e.g. as an upload arrives: begin with the final length, write
+    exactly that many bytes, then commit. Until the commit succeeds an older macro of the same
+    name stays in place, and a write cut short by a reset leaves only a dead record.
+
+    Begin fails with ESP_ERR_NO_MEM when the record does not fit, or when a new name would
+    exceed MACRO_STORE_MAX_ENTRIES; replacing an existing macro is always allowed.
+*/
+esp_err_t macro_store_begin(const char *name, macro_type_t type, uint32_t len);
+esp_err_t macro_store_write(const void *data, size_t len);
+esp_err_t macro_store_commit(void);
+void macro_store_abort(void);
+
+/* Convenience for data already in RAM */
+esp_err_t macro_store_append(const char *name, macro_type_t type, const void *data, uint32_t len);
+
+esp_err_t macro_store_delete(const char *name);
+
+/*
+    Copies the live records into the other half and switches to it. Invalidates every data
+    pointer handed out before, so nothing may be playing from flash. A reset or a failure part
+    way through leaves the library as it was.
+*/
+esp_err_t macro_store_compact(void);
+
+void macro_store_usage(macro_store_usage_t *usage);
+
+#endif
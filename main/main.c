@@ -18,6 +18,15 @@
 
 #include "ble_kbm_types.h"
 #include "commands.h"
+#include "battery.h"
+#include "boot_time.h"
+#include "input_ring.h"
+#include "script.h"
+#include "macro_store.h"
+#include "power.h"
+#include "resume.h"
+#include "led_events.h"
+#include "task_layout.h"
 
 #define TAG "ESP32_KBM"
 
@@ -37,33 +46,61 @@ extern void handle_bluetooth_task();
 void hid_task(void *pvParameters);
 void console_task(void *pvParameters);
 
-QueueHandle_t passkey_queue, keyboard_queue, mouse_queue, commands_queue;
+QueueHandle_t passkey_queue, commands_queue, typing_queue;
+
+/* Keyboard and mouse events from the console task to the HID task */
+input_ring_t console_input_ring;
+/* Input frames written over GATT, produced on the Bluedroid task */
+input_ring_t ble_input_ring;
+/* Programs run by the 'script' console command */
+input_ring_t script_input_ring;
+
+TaskHandle_t hid_task_handle, console_task_handle;
 
 void app_main(void)
 {
+    boot_time_mark(BOOT_MARK_APP_MAIN);
+    resume_init();
+    if (resume_get() != NULL)
+    {
+        led_events_restore(resume_get()->leds);
+    }
+
     initialise_nvs();
+    boot_time_mark(BOOT_MARK_NVS);
 
     /* Initialise queues */
     passkey_queue = xQueueCreate(1, sizeof(uint32_t));
-    keyboard_queue = xQueueCreate(8, sizeof(keyboard_t));
-    mouse_queue = xQueueCreate(8, sizeof(mouse_t));
+    input_ring_init(&console_input_ring);
+    input_ring_init(&ble_input_ring);
+    input_ring_init(&script_input_ring);
     commands_queue = xQueueCreate(1, sizeof(uint8_t));
-
-    initialise_bluetooth();
-    
-    initialise_console();
-    config_prompts();
-    /* Register console commands */
-    esp_console_register_help_command();
-    console_register_bluetooth_commands();
-
+    /* Carries heap-allocated strings, freed by the receiver */
+    typing_queue = xQueueCreate(4, sizeof(char *));
 
     /* 
         Low priority numbers denote low priority tasks. The idle task has priority zero (tskIDLE_PRIORITY). 
         https://www.freertos.org/RTOS-task-priority.html
+
+        Core, priority and stack size of both tasks come from the "ESP32 KBM" menu in menuconfig.
+
+        The HID task starts first because console commands notify it. It blocks until then, and
+        anything sent before a connection exists is dropped by the scheduler. The console task
+        sets up the UART and probes the terminal while the controller and Bluedroid come up here.
+    */
+    xTaskCreatePinnedToCore(&hid_task, "hid_task", CONFIG_KBM_HID_TASK_STACK_SIZE, NULL,
+                            CONFIG_KBM_HID_TASK_PRIORITY, &hid_task_handle, KBM_HID_TASK_CORE);
+    xTaskCreatePinnedToCore(&console_task, "console_task", CONFIG_KBM_CONSOLE_TASK_STACK_SIZE, NULL,
+                            CONFIG_KBM_CONSOLE_TASK_PRIORITY, &console_task_handle, KBM_CONSOLE_TASK_CORE);
+    script_init();
+
+    initialise_bluetooth();
+    /*
+        After Bluetooth so the ADC readings do not hold up advertising. The first level goes to
+        the Battery Service table whether or not the stack has built it yet, and advertising
+        waits for the HID service, which is created after it, so a host never reads the default.
     */
-    xTaskCreate(&hid_task, "hid_task", 2048, NULL, 5, NULL);
-    xTaskCreate(&console_task, "console_task", 4096, NULL, 4, NULL);
+    battery_init();
 }
 
 void hid_task(void *pvParameters)
@@ -74,6 +111,18 @@ void hid_task(void *pvParameters)
 
 void console_task(void *pvParameters)
 {
+    initialise_console();
+    config_prompts();
+    /* Register console commands */
+    esp_console_register_help_command();
+    console_register_bluetooth_commands();
+
+    /* After the console UART is up, so activity on it can wake the chip */
+    power_init();
+    /* Only maps the partition and reads record headers */
+    macro_store_init();
+    boot_time_mark(BOOT_MARK_CONSOLE);
+
     watch_prompts();
     vTaskDelete(NULL);
 }
\ No newline at end of file
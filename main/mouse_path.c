@@ -0,0 +1,124 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <math.h>
+#include <string.h>
+
+#include "mouse_path.h"
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void evaluate(const mouse_path_t *path, float t, float *x, float *y);
+static int8_t clamp_delta(int32_t delta);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+bool mouse_path_init(mouse_path_t *path, mouse_path_kind_t kind, const mouse_point_t *points, size_t num_points,
+                     uint32_t steps)
+{
+    size_t expected_min = kind == MOUSE_PATH_BEZIER ? 3 : 1;
+    size_t expected_max = kind == MOUSE_PATH_POLYLINE ? MOUSE_PATH_MAX_POINTS : expected_min;
+
+    if (num_points < expected_min || num_points > expected_max)
+    {
+        return false;
+    }
+
+    memset(path, 0, sizeof(*path));
+    path->kind = kind;
+    path->num_points = num_points;
+    path->steps = steps > 0 ? steps : 1;
+    memcpy(path->points, points, num_points * sizeof(points[0]));
+
+    float total = 0;
+    mouse_point_t prev = {0, 0};
+    for (size_t i = 0; i < num_points; i++)
+    {
+        total += hypotf(points[i].x - prev.x, points[i].y - prev.y);
+        path->length[i] = total;
+        prev = points[i];
+    }
+    return true;
+}
+
+static void evaluate(const mouse_path_t *path, float t, float *x, float *y)
+{
+    const mouse_point_t *p = path->points;
+
+    switch (path->kind)
+    {
+    case MOUSE_PATH_LINE:
+        *x = t * p[0].x;
+        *y = t * p[0].y;
+        break;
+    case MOUSE_PATH_BEZIER:
+    {
+        /* Start point is the origin, so its term drops out */
+        float u = 1 - t;
+        float b1 = 3 * u * u * t;
+        float b2 = 3 * u * t * t;
+        float b3 = t * t * t;
+        *x = b1 * p[0].x + b2 * p[1].x + b3 * p[2].x;
+        *y = b1 * p[0].y + b2 * p[1].y + b3 * p[2].y;
+        break;
+    }
+    case MOUSE_PATH_POLYLINE:
+    {
+        float total = path->length[path->num_points - 1];
+        float at = t * total;
+        size_t i = 0;
+
+        while (i < path->num_points - 1 && path->length[i] < at)
+        {
+            i++;
+        }
+
+        float from_x = i > 0 ? p[i - 1].x : 0;
+        float from_y = i > 0 ? p[i - 1].y : 0;
+        float start = i > 0 ? path->length[i - 1] : 0;
+        float span = path->length[i] - start;
+        float f = span > 0 ? (at - start) / span : 1;
+        *x = from_x + f * (p[i].x - from_x);
+        *y = from_y + f * (p[i].y - from_y);
+        break;
+    }
+    }
+}
+
+static int8_t clamp_delta(int32_t delta)
+{
+    return delta > 127 ? 127 : delta < -127 ? -127 : delta;
+}
+
+bool mouse_path_next(mouse_path_t *path, int8_t *dx, int8_t *dy)
+{
+    const mouse_point_t *end = &path->points[path->num_points - 1];
+    int32_t target_x = end->x;
+    int32_t target_y = end->y;
+
+    if (path->step >= path->steps && path->sent_x == end->x && path->sent_y == end->y)
+    {
+        return false;
+    }
+
+    /* The last step aims at the end point itself, not at a rounded float */
+    if (path->step < path->steps)
+    {
+        path->step++;
+        if (path->step < path->steps)
+        {
+            float x = 0, y = 0;
+            evaluate(path, (float)path->step / path->steps, &x, &y);
+            target_x = lroundf(x);
+            target_y = lroundf(y);
+        }
+    }
+
+    *dx = clamp_delta(target_x - path->sent_x);
+    *dy = clamp_delta(target_y - path->sent_y);
+    path->sent_x += *dx;
+    path->sent_y += *dy;
+    return true;
+}
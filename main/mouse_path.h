@@ -0,0 +1,59 @@
+#ifndef MOUSE_PATH_H
+#define MOUSE_PATH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+    Expands a mouse gesture into relative HID deltas, one per connection interval. Points are
+    in pixels relative to where the pointer starts:
+
+        LINE        to points[0]
+        BEZIER      cubic curve with control points points[0], points[1], ending at points[2]
+        POLYLINE    through every point in turn, at constant speed along the whole path
+
+    Each step aims at the rounded position on the curve and sends the difference from what
+    was sent so far, so rounding never accumulates and the deltas add up exactly to the end
+    point. A step that would exceed the int8 range of a report is clamped and the rest
+    carried into the next; the path then takes a few extra steps past its nominal count.
+
+    No ESP-IDF dependencies, so it builds and runs on a PC as well.
+*/
+
+#define MOUSE_PATH_MAX_POINTS 8
+
+typedef enum
+{
+    MOUSE_PATH_LINE,
+    MOUSE_PATH_BEZIER,
+    MOUSE_PATH_POLYLINE,
+} mouse_path_kind_t;
+
+typedef struct
+{
+    int32_t x;
+    int32_t y;
+} mouse_point_t;
+
+typedef struct
+{
+    mouse_path_kind_t kind;
+    mouse_point_t points[MOUSE_PATH_MAX_POINTS];
+    size_t num_points;
+    uint32_t steps;
+    float length[MOUSE_PATH_MAX_POINTS];    /* POLYLINE: path length up to each point */
+
+    uint32_t step;
+    int32_t sent_x;
+    int32_t sent_y;
+} mouse_path_t;
+
+/* Returns false if the point count does not fit the kind */
+bool mouse_path_init(mouse_path_t *path, mouse_path_kind_t kind, const mouse_point_t *points, size_t num_points,
+                     uint32_t steps);
+
+/* Next delta; returns false once the end point has been reached */
+bool mouse_path_next(mouse_path_t *path, int8_t *dx, int8_t *dy);
+
+#endif
@@ -0,0 +1,39 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "hid_stats.h"
+#include "phy_policy.h"
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+bool phy_policy_connect(bool ble5, uint8_t *pref_mask)
+{
+    if (!ble5)
+    {
+        /* No update will ever come; the link is on 1M for good */
+        hid_stats_inc(HID_STAT_PHY_1M);
+        return false;
+    }
+
+    /* The controller moves to 2M only if the central supports it */
+    *pref_mask = PHY_POLICY_1M_PREF_MASK | PHY_POLICY_2M_PREF_MASK;
+    return true;
+}
+
+bool phy_policy_update(bool success, uint8_t tx_phy, uint8_t rx_phy, uint8_t *link_tx_phy, uint8_t *link_rx_phy)
+{
+    if (!success)
+    {
+        /* Central refused or cannot do 2M; the link simply stays on 1M */
+        *link_tx_phy = PHY_POLICY_1M;
+        *link_rx_phy = PHY_POLICY_1M;
+        hid_stats_inc(HID_STAT_PHY_1M);
+        return false;
+    }
+
+    *link_tx_phy = tx_phy;
+    *link_rx_phy = rx_phy;
+    hid_stats_inc(tx_phy == PHY_POLICY_2M ? HID_STAT_PHY_2M : HID_STAT_PHY_1M);
+    return true;
+}
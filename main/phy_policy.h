@@ -0,0 +1,38 @@
+#ifndef PHY_POLICY_H
+#define PHY_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Which PHY a link asks for and what is recorded once the controller answers. Every link
+    starts on 1M; a BLE 5 controller offers 2M alongside it and moves only if the central
+    agrees. A refused or failed update leaves the link on 1M, as does a controller without
+    BLE 5 support, which never asks. Each link is counted once in conn.phy_2m or conn.phy_1m.
+
+    No ESP-IDF dependencies, so it builds and runs on a PC as well.
+*/
+
+/* HCI PHY encoding, same on every controller */
+#define PHY_POLICY_1M               1
+#define PHY_POLICY_2M               2
+#define PHY_POLICY_CODED            3
+
+/* HCI preferred PHY bits, as ESP_BLE_GAP_PHY_*_PREF_MASK */
+#define PHY_POLICY_1M_PREF_MASK     (1 << 0)
+#define PHY_POLICY_2M_PREF_MASK     (1 << 1)
+#define PHY_POLICY_CODED_PREF_MASK  (1 << 2)
+
+/*
+    Called on a new link. Returns true with the preferred PHYs for both directions when an
+    update should be requested; false, and the link is counted as 1M, when ble5 is false.
+*/
+bool phy_policy_connect(bool ble5, uint8_t *pref_mask);
+
+/*
+    Called with the outcome of the update. Sets the PHYs to record for the link and returns
+    false when the update failed and the link stays on 1M.
+*/
+bool phy_policy_update(bool success, uint8_t tx_phy, uint8_t rx_phy, uint8_t *link_tx_phy, uint8_t *link_rx_phy);
+
+#endif
@@ -0,0 +1,145 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "driver/uart.h"
+#include "sdkconfig.h"
+
+#include "power.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_POWER"
+
+/* RX edges that wake the chip; the first character is swallowed either way */
+#define POWER_UART_WAKEUP_THRESHOLD 3
+
+#if CONFIG_PM_ENABLE
+static power_config_t power_config;
+static esp_pm_lock_handle_t busy_lock;
+static bool busy = false;
+#endif
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+#if CONFIG_PM_ENABLE
+
+esp_err_t power_init(void)
+{
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "hid_busy", &busy_lock));
+
+#if !CONFIG_BTDM_LPCLK_SEL_EXT_32K_XTAL
+    ESP_LOGW(TAG, "Bluetooth sleep clock is the main crystal, the controller will block light sleep");
+#endif
+
+    ESP_ERROR_CHECK(uart_set_wakeup_threshold(CONFIG_ESP_CONSOLE_UART_NUM, POWER_UART_WAKEUP_THRESHOLD));
+    ESP_ERROR_CHECK(esp_sleep_enable_uart_wakeup(CONFIG_ESP_CONSOLE_UART_NUM));
+
+    const power_config_t config = {
+        .max_freq_mhz = CONFIG_KBM_PM_MAX_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_KBM_PM_MIN_FREQ_MHZ,
+#if CONFIG_KBM_PM_LIGHT_SLEEP
+        .light_sleep = true,
+#endif
+    };
+    return power_configure(&config);
+}
+
+esp_err_t power_configure(const power_config_t *config)
+{
+    esp_pm_config_esp32_t pm_config = {
+        .max_freq_mhz = config->max_freq_mhz,
+        .min_freq_mhz = config->min_freq_mhz,
+        .light_sleep_enable = config->light_sleep,
+    };
+
+#if !CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    if (config->light_sleep)
+    {
+        ESP_LOGE(TAG, "Light sleep needs FREERTOS_USE_TICKLESS_IDLE");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Rejected %d-%d MHz, light sleep %s: %s", config->min_freq_mhz,
+                 config->max_freq_mhz, config->light_sleep ? "on" : "off", esp_err_to_name(ret));
+        return ret;
+    }
+
+    power_config = *config;
+    ESP_LOGI(TAG, "CPU %d-%d MHz, light sleep %s", config->min_freq_mhz, config->max_freq_mhz,
+             config->light_sleep ? "on" : "off");
+    return ESP_OK;
+}
+
+void power_get_config(power_config_t *config)
+{
+    *config = power_config;
+}
+
+void power_set_busy(bool is_busy)
+{
+    if (busy_lock == NULL || busy == is_busy)
+    {
+        return;
+    }
+
+    busy = is_busy;
+    if (busy)
+    {
+        esp_pm_lock_acquire(busy_lock);
+    }
+    else
+    {
+        esp_pm_lock_release(busy_lock);
+    }
+}
+
+void power_dump(FILE *stream)
+{
+    fprintf(stream, "CPU %d-%d MHz, light sleep %s, HID task %s\n", power_config.min_freq_mhz,
+            power_config.max_freq_mhz, power_config.light_sleep ? "on" : "off",
+            busy ? "busy" : "idle");
+    esp_pm_dump_locks(stream);
+}
+
+#else
+
+esp_err_t power_init(void)
+{
+    ESP_LOGW(TAG, "Power management disabled, enable PM_ENABLE in menuconfig");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t power_configure(const power_config_t *config)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void power_get_config(power_config_t *config)
+{
+    config->max_freq_mhz = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ;
+    config->min_freq_mhz = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ;
+    config->light_sleep = false;
+}
+
+void power_set_busy(bool is_busy)
+{
+}
+
+void power_dump(FILE *stream)
+{
+    fprintf(stream, "Power management disabled, CPU fixed at %d MHz\n", CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ);
+}
+
+#endif
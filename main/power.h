@@ -0,0 +1,37 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+typedef struct
+{
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep;
+} power_config_t;
+
+/*
+    Applies the KBM_PM_* defaults from menuconfig and arms UART wake-up on the console, so a
+    keystroke brings the chip out of automatic light sleep. The character that wakes the chip
+    is lost. Returns ESP_ERR_NOT_SUPPORTED when power management is not built in.
+*/
+esp_err_t power_init(void);
+
+/* Changes frequency limits and light sleep at runtime */
+esp_err_t power_configure(const power_config_t *config);
+void power_get_config(power_config_t *config);
+
+/*
+    Keeps the CPU at its maximum frequency while the HID task has work queued. Calls are not
+    counted; the last one wins.
+*/
+void power_set_busy(bool busy);
+
+/* Prints the configuration and the held PM locks; with PM_PROFILING also time spent per mode */
+void power_dump(FILE *stream);
+
+#endif
@@ -0,0 +1,70 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <stddef.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp32/rom/crc.h"
+
+#include "resume.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_RESUME"
+
+#define RESUME_MAGIC 0x4b424d31 /* "KBM1", bump when resume_state_t changes */
+
+static RTC_DATA_ATTR resume_state_t rtc_state;
+
+/* Copy taken at boot, so a later resume_save() does not change what this boot resumed from */
+static resume_state_t resumed;
+static bool is_resumed = false;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static uint32_t resume_crc(const resume_state_t *state);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void resume_init(void)
+{
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED)
+    {
+        return;
+    }
+    if (rtc_state.magic != RESUME_MAGIC || rtc_state.crc != resume_crc(&rtc_state))
+    {
+        ESP_LOGW(TAG, "Woke from sleep without valid saved state");
+        return;
+    }
+
+    resumed = rtc_state;
+    is_resumed = true;
+    /* Used once; a crash before the next sleep must not replay it */
+    rtc_state.magic = 0;
+    ESP_LOGI(TAG, "Resuming after sleep %u, host %s", resumed.sleep_count, resumed.has_peer ? "known" : "unknown");
+}
+
+const resume_state_t *resume_get(void)
+{
+    return is_resumed ? &resumed : NULL;
+}
+
+void resume_save(const resume_state_t *state)
+{
+    /* The checksum covers padding too; callers memset their copy before filling it */
+    memcpy(&rtc_state, state, sizeof(rtc_state));
+    rtc_state.magic = RESUME_MAGIC;
+    rtc_state.sleep_count = (is_resumed ? resumed.sleep_count : 0) + 1;
+    rtc_state.crc = resume_crc(&rtc_state);
+}
+
+static uint32_t resume_crc(const resume_state_t *state)
+{
+    return crc32_le(0, (const uint8_t *)state, offsetof(resume_state_t, crc));
+}
@@ -0,0 +1,43 @@
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_bt_defs.h"
+
+/*
+    State kept in RTC slow memory across deep sleep. Everything here can be rebuilt the slow
+    way; it only lets the wake path skip work and reconnect straight to the last host.
+*/
+typedef struct
+{
+    uint32_t magic;
+    esp_bd_addr_t peer_bda;         /* identity of the last bonded host */
+    uint8_t peer_addr_type;
+    bool has_peer;
+    uint8_t leds;                   /* LED_* bits last written by the host */
+    bool console_dumb;              /* terminal failed the escape sequence probe */
+    uint16_t conn_int;              /* connection parameters in use, 0 if unknown */
+    uint16_t latency;
+    uint16_t supervision_timeout;
+    uint32_t sleep_count;
+    uint32_t crc;
+} resume_state_t;
+
+/*
+    Validates the saved state once, early in app_main. It only counts after a deep sleep
+    wake; a power-on or reset starts from scratch even if RTC memory survived.
+*/
+void resume_init(void);
+
+/* State saved before the last deep sleep, NULL on a cold boot */
+const resume_state_t *resume_get(void);
+
+/*
+    Checksums and stores state for the next wake; call right before esp_deep_sleep_start().
+    magic, sleep_count and crc are filled in here.
+*/
+void resume_save(const resume_state_t *state);
+
+#endif
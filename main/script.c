@@ -0,0 +1,507 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <math.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "esp_hidd_prf_api.h"
+
+#include "input_ring.h"
+#include "led_events.h"
+#include "task_layout.h"
+#include "typing.h"
+#include "accel.h"
+#include "script.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_SCRIPT"
+
+#define SCRIPT_TASK_STACK_SIZE 3072
+
+/* Slack on the tick timeout backing up the wait timer, should its notification get lost */
+#define SCRIPT_WAIT_SLACK_TICKS 2
+
+/* Most extra reports a compensated move sends after the path to reach its end point */
+#define SCRIPT_ACCEL_SETTLE_REPORTS 4
+
+static uint8_t script_code[CONFIG_KBM_SCRIPT_MAX_SIZE];
+/* script_code, or a program mapped from flash */
+static const uint8_t *program;
+static size_t program_len;
+static enum
+{
+    PROGRAM_BYTECODE,
+    PROGRAM_CAPTURE,        /* program holds program_len input_event_t records */
+    PROGRAM_MOUSE_PATH,     /* mouse_path below */
+    PROGRAM_GESTURE,        /* touch_gesture below */
+} program_kind;
+static mouse_path_t mouse_path;
+static uint32_t mouse_path_interval_us;
+static uint8_t mouse_path_buttons;
+static bool mouse_path_compensate;
+static touch_gesture_t touch_gesture;
+static uint32_t touch_gesture_interval_us;
+static script_result_t last_result;
+
+static TaskHandle_t script_task_handle;
+/* One-shot timer ending a wait; sub-tick waits sleep on it instead of spinning */
+static esp_timer_handle_t wait_timer;
+/* Set while a program is loaded or running; only the console starts programs */
+static atomic_bool running;
+static atomic_bool stop_requested;
+
+/******************************************************************************
+ * External variables
+ *****************************************************************************/
+extern input_ring_t script_input_ring;
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+extern uint16_t bluetooth_get_conn_id();
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void script_task(void *pvParameters);
+static void script_wait_timeout(void *arg);
+static void script_emit(const input_event_t *event, void *ctx);
+static void script_emit_report(uint8_t modifier, uint8_t keycode, void *ctx);
+static void script_type_text(const char *text, size_t len, void *ctx);
+static uint64_t script_now_us(void *ctx);
+static void script_wait_until(uint64_t deadline_us, void *ctx);
+static uint8_t script_leds(void *ctx);
+static bool script_should_stop(void *ctx);
+static void script_replay_events(const uint8_t *data, size_t count, script_result_t *result);
+static void script_move_mouse(script_result_t *result);
+static void script_send_touch_frame(const touch_frame_t *frame, uint16_t scan_time);
+static void script_touch_gesture(script_result_t *result);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void script_init(void)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = &script_wait_timeout,
+        .name = "script_wait"};
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &wait_timer));
+
+    xTaskCreatePinnedToCore(&script_task, "script_task", SCRIPT_TASK_STACK_SIZE, NULL,
+                            CONFIG_KBM_SCRIPT_TASK_PRIORITY, &script_task_handle, KBM_CONSOLE_TASK_CORE);
+}
+
+/* The ring is the only way to the HID task; when it is full, let the HID task catch up */
+static void script_emit(const input_event_t *event, void *ctx)
+{
+    while (!input_ring_push(&script_input_ring, event))
+    {
+        vTaskDelay(1);
+    }
+}
+
+static void script_emit_report(uint8_t modifier, uint8_t keycode, void *ctx)
+{
+    input_event_t event = {.type = INPUT_EVENT_KEY_REPORT};
+
+    event.keyboard.modifier = modifier;
+    event.keyboard.keycode = keycode;
+    script_emit(&event, ctx);
+}
+
+static void script_type_text(const char *text, size_t len, void *ctx)
+{
+    bool caps = typing_host_caps_lock();
+
+    typing_plan(text, len, &caps, &script_emit_report, ctx);
+}
+
+static uint64_t script_now_us(void *ctx)
+{
+    return esp_timer_get_time();
+}
+
+static void script_wait_timeout(void *arg)
+{
+    xTaskNotifyGive(script_task_handle);
+}
+
+/*
+    Blocks on a one-shot esp_timer, so a wait shorter than a tick still sleeps and the
+    console and idle tasks on this core keep running through LED polls and paced moves.
+    script_stop() notifies as well, so a long DELAY ends early; a notification left over
+    from an earlier wait only costs one more pass round the loop.
+*/
+static void script_wait_until(uint64_t deadline_us, void *ctx)
+{
+    int64_t remaining;
+
+    while ((remaining = (int64_t)(deadline_us - esp_timer_get_time())) > 0 && !atomic_load(&stop_requested))
+    {
+        esp_timer_stop(wait_timer);
+        if (esp_timer_start_once(wait_timer, remaining) != ESP_OK)
+        {
+            vTaskDelay(1);
+            continue;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining / 1000) + SCRIPT_WAIT_SLACK_TICKS);
+    }
+    esp_timer_stop(wait_timer);
+}
+
+static uint8_t script_leds(void *ctx)
+{
+    return led_events_last().leds;
+}
+
+static bool script_should_stop(void *ctx)
+{
+    return atomic_load(&stop_requested);
+}
+
+/* Each event is sent at its original offset from the first one */
+static void script_replay_events(const uint8_t *data, size_t count, script_result_t *result)
+{
+    uint64_t start = esp_timer_get_time();
+    uint32_t first = 0;
+    input_event_t event;
+
+    memset(result, 0, sizeof(*result));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        /* Records in the macro store are not word aligned */
+        memcpy(&event, &data[i * sizeof(event)], sizeof(event));
+        if (i == 0)
+        {
+            first = event.timestamp_us;
+        }
+
+        script_wait_until(start + (uint32_t)(event.timestamp_us - first), NULL);
+        if (atomic_load(&stop_requested))
+        {
+            result->status = SCRIPT_STOPPED;
+            break;
+        }
+        script_emit(&event, NULL);
+        result->pc = i + 1;
+        result->steps++;
+    }
+}
+
+/* One report per connection interval, buttons held throughout and released at the end */
+static void script_move_mouse(script_result_t *result)
+{
+    uint64_t deadline = esp_timer_get_time();
+    input_event_t event = {.type = INPUT_EVENT_MOUSE};
+    accel_comp_t comp;
+    int8_t dx, dy;
+    bool more = true;
+
+    memset(result, 0, sizeof(*result));
+    event.mouse.mouse_buttons = mouse_path_buttons;
+    accel_comp_init(&comp);
+    if (!mouse_path_compensate)
+    {
+        comp.curve.valid = false;
+    }
+
+    /* A few reports past the path's end settle what the host's acceleration left over */
+    for (int settle = 0; settle < SCRIPT_ACCEL_SETTLE_REPORTS; )
+    {
+        int8_t cx, cy;
+
+        if (more && !mouse_path_next(&mouse_path, &dx, &dy))
+        {
+            more = false;
+        }
+        if (!more)
+        {
+            if (fabsf(comp.residual_x) < 0.5f && fabsf(comp.residual_y) < 0.5f)
+            {
+                break;
+            }
+            dx = dy = 0;
+            settle++;
+        }
+        if (atomic_load(&stop_requested))
+        {
+            result->status = SCRIPT_STOPPED;
+            break;
+        }
+
+        accel_compensate(&comp, dx, dy, &cx, &cy);
+        if (cx != 0 || cy != 0 || more)
+        {
+            event.mouse.movement_x = cx;
+            event.mouse.movement_y = cy;
+            script_emit(&event, NULL);
+            result->steps++;
+
+            deadline += mouse_path_interval_us;
+            script_wait_until(deadline, NULL);
+        }
+    }
+
+    if (mouse_path_buttons != 0)
+    {
+        event.mouse.mouse_buttons = 0;
+        event.mouse.movement_x = 0;
+        event.mouse.movement_y = 0;
+        script_emit(&event, NULL);
+    }
+}
+
+/* Splits a frame into two-contact reports; only the first carries the frame's contact count */
+static void script_send_touch_frame(const touch_frame_t *frame, uint16_t scan_time)
+{
+    uint16_t conn_id = bluetooth_get_conn_id();
+
+    for (uint8_t i = 0; i < frame->count; i += HID_TOUCHPAD_CONTACTS_PER_REPORT)
+    {
+        uint8_t num = frame->count - i;
+        num = num > HID_TOUCHPAD_CONTACTS_PER_REPORT ? HID_TOUCHPAD_CONTACTS_PER_REPORT : num;
+        esp_hidd_send_touchpad_value(conn_id, &frame->contacts[i], num, i == 0 ? frame->count : 0, scan_time,
+                                     false);
+    }
+}
+
+/*
+    One frame per connection interval, sent straight to the touchpad report like
+    gamepad_stream does: the contacts of a frame belong together and must not be merged or
+    reordered with queued mouse and keyboard input.
+*/
+static void script_touch_gesture(script_result_t *result)
+{
+    uint64_t deadline = esp_timer_get_time();
+    touch_frame_t frame;
+
+    memset(result, 0, sizeof(*result));
+    while (touch_gesture_next(&touch_gesture, &frame))
+    {
+        if (atomic_load(&stop_requested))
+        {
+            /* Lift where the fingers are so the host does not keep them down */
+            frame = touch_gesture.last;
+            for (uint8_t i = 0; i < frame.count; i++)
+            {
+                frame.contacts[i].tip = false;
+            }
+            script_send_touch_frame(&frame, (esp_timer_get_time() / 100) & 0xFFFF);
+            result->status = SCRIPT_STOPPED;
+            break;
+        }
+
+        /* Scan time counts 100 us and wraps, the same for every report of a frame */
+        script_send_touch_frame(&frame, (deadline / 100) & 0xFFFF);
+        result->steps++;
+
+        deadline += touch_gesture_interval_us;
+        script_wait_until(deadline, NULL);
+    }
+}
+
+static void script_task(void *pvParameters)
+{
+    const script_host_t host = {
+        .emit = &script_emit,
+        .type_text = &script_type_text,
+        .now_us = &script_now_us,
+        .wait_until = &script_wait_until,
+        .leds = &script_leds,
+        .should_stop = &script_should_stop,
+    };
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!atomic_load(&running))
+        {
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        script_result_t result;
+        switch (program_kind)
+        {
+        case PROGRAM_BYTECODE:
+            script_vm_run(program, program_len, &host, &result);
+            break;
+        case PROGRAM_CAPTURE:
+            script_replay_events(program, program_len, &result);
+            break;
+        case PROGRAM_MOUSE_PATH:
+            script_move_mouse(&result);
+            break;
+        case PROGRAM_GESTURE:
+            script_touch_gesture(&result);
+            break;
+        }
+
+        /* A stopped program may have left keys held */
+        const input_event_t release = {.type = INPUT_EVENT_KEY_REPORT};
+        script_emit(&release, NULL);
+
+        last_result = result;
+        if (result.status == SCRIPT_OK)
+        {
+            ESP_LOGI(TAG, "Finished after %" PRIu32 " instructions in %lld ms", result.steps,
+                     (esp_timer_get_time() - start) / 1000);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Ended at offset %u: %s", (unsigned)result.pc, script_status_to_str(result.status));
+        }
+        atomic_store(&running, false);
+    }
+}
+
+esp_err_t script_run_code(const uint8_t *code, size_t len)
+{
+    bool idle = false;
+
+    if (len > sizeof(script_code))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!atomic_compare_exchange_strong(&running, &idle, true))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memcpy(script_code, code, len);
+    program = script_code;
+    program_len = len;
+    program_kind = PROGRAM_BYTECODE;
+    atomic_store(&stop_requested, false);
+    xTaskNotifyGive(script_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t script_run_mapped(const uint8_t *code, size_t len)
+{
+    bool idle = false;
+
+    if (!atomic_compare_exchange_strong(&running, &idle, true))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    program = code;
+    program_len = len;
+    program_kind = PROGRAM_BYTECODE;
+    atomic_store(&stop_requested, false);
+    xTaskNotifyGive(script_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t script_run_source(const char *src, script_compile_result_t *result)
+{
+    bool idle = false;
+
+    if (!atomic_compare_exchange_strong(&running, &idle, true))
+    {
+        memset(result, 0, sizeof(*result));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Compiled in place; the buffer is ours while running is set */
+    if (!script_compile(src, script_code, sizeof(script_code), result))
+    {
+        atomic_store(&running, false);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    program = script_code;
+    program_len = result->len;
+    program_kind = PROGRAM_BYTECODE;
+    atomic_store(&stop_requested, false);
+    xTaskNotifyGive(script_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t script_replay(const void *events, size_t count)
+{
+    bool idle = false;
+
+    if (!atomic_compare_exchange_strong(&running, &idle, true))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    program = events;
+    program_len = count;
+    program_kind = PROGRAM_CAPTURE;
+    atomic_store(&stop_requested, false);
+    xTaskNotifyGive(script_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t script_move(const mouse_path_t *path, uint8_t buttons, uint32_t interval_us, bool compensate)
+{
+    bool idle = false;
+
+    if (!atomic_compare_exchange_strong(&running, &idle, true))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    mouse_path = *path;
+    mouse_path_buttons = buttons;
+    mouse_path_interval_us = interval_us;
+    mouse_path_compensate = compensate;
+    program_kind = PROGRAM_MOUSE_PATH;
+    atomic_store(&stop_requested, false);
+    xTaskNotifyGive(script_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t script_gesture(const touch_gesture_t *gesture, uint32_t interval_us)
+{
+    bool idle = false;
+
+    if (!atomic_compare_exchange_strong(&running, &idle, true))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (esp_hidd_get_touchpad_mode() != HID_TOUCHPAD_MODE_TOUCHPAD)
+    {
+        ESP_LOGW(TAG, "Host has not selected touchpad input mode, it may ignore the gesture");
+    }
+
+    touch_gesture = *gesture;
+    touch_gesture_interval_us = interval_us;
+    program_kind = PROGRAM_GESTURE;
+    atomic_store(&stop_requested, false);
+    xTaskNotifyGive(script_task_handle);
+    return ESP_OK;
+}
+
+void script_stop(void)
+{
+    atomic_store(&stop_requested, true);
+    xTaskNotifyGive(script_task_handle);
+}
+
+bool script_running(void)
+{
+    return atomic_load(&running);
+}
+
+void script_last_result(script_result_t *result)
+{
+    *result = last_result;
+}
@@ -0,0 +1,60 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "script_vm.h"
+#include "script_compiler.h"
+#include "mouse_path.h"
+#include "touch_gesture.h"
+
+/*
+    Runs script_vm programs on their own task, one at a time. Input goes to the HID task
+    through script_input_ring; waits are timed with esp_timer, so a DELAY does not depend on
+    how long the previous line took to send.
+*/
+void script_init(void);
+
+/* Compiles source and starts it. result holds the error line when compilation fails */
+esp_err_t script_run_source(const char *src, script_compile_result_t *result);
+
+/* Starts precompiled bytecode, e.g. from a host build of script_compiler.c */
+esp_err_t script_run_code(const uint8_t *code, size_t len);
+
+/* Runs bytecode in place, e.g. from macro_store; code must stay valid while script_running() */
+esp_err_t script_run_mapped(const uint8_t *code, size_t len);
+
+/*
+    Replays count captured input_event_t records with their original spacing, see capture.h.
+    events need not be aligned and must stay valid while script_running().
+*/
+esp_err_t script_replay(const void *events, size_t count);
+
+/*
+    Moves the mouse along path, one report every interval_us, ideally the connection
+    interval. buttons are held for the whole move, for a drag, and released at the end.
+    With compensate, path is in screen pixels and goes through the host's acceleration
+    curve (accel.h); without, it is in report counts.
+*/
+esp_err_t script_move(const mouse_path_t *path, uint8_t buttons, uint32_t interval_us, bool compensate);
+
+/*
+    Plays a touchpad gesture on the Precision Touchpad collection, one contact frame every
+    interval_us, ideally the connection interval. Only has an effect once the host has
+    switched the touchpad to its touchpad input mode.
+*/
+esp_err_t script_gesture(const touch_gesture_t *gesture, uint32_t interval_us);
+
+/* Asks the running program to stop at its next jump or wait and releases all keys */
+void script_stop(void);
+
+bool script_running(void);
+
+/* Result of the last finished program */
+void script_last_result(script_result_t *result);
+
+#endif
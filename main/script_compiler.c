@@ -0,0 +1,696 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "hid_codes.h"
+#include "script_vm.h"
+#include "script_compiler.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define SCRIPT_MAX_LINE     256
+#define SCRIPT_MAX_NESTING  8
+#define SCRIPT_TEXT_CHUNK   255
+
+/* REPEAT counts in the last variable, named variables get the others */
+#define SCRIPT_REPEAT_VAR   (SCRIPT_NUM_VARS - 1)
+#define SCRIPT_NAMED_VARS   (SCRIPT_NUM_VARS - 1)
+#define SCRIPT_MAX_VAR_NAME 16
+
+typedef struct
+{
+    const char *name;
+    uint8_t code;
+} script_name_t;
+
+static const script_name_t modifier_names[] = {
+    {"CTRL", LEFT_CONTROL_KEY_MASK},
+    {"CONTROL", LEFT_CONTROL_KEY_MASK},
+    {"SHIFT", LEFT_SHIFT_KEY_MASK},
+    {"ALT", LEFT_ALT_KEY_MASK},
+    {"OPTION", LEFT_ALT_KEY_MASK},
+    {"GUI", LEFT_GUI_KEY_MASK},
+    {"WINDOWS", LEFT_GUI_KEY_MASK},
+    {"COMMAND", LEFT_GUI_KEY_MASK},
+};
+
+static const script_name_t key_names[] = {
+    {"ENTER", HID_KEY_RETURN},
+    {"ESC", HID_KEY_ESCAPE},
+    {"ESCAPE", HID_KEY_ESCAPE},
+    {"BACKSPACE", HID_KEY_DELETE},
+    {"TAB", HID_KEY_TAB},
+    {"SPACE", HID_KEY_SPACEBAR},
+    {"CAPSLOCK", HID_KEY_CAPS_LOCK},
+    {"PRINTSCREEN", HID_KEY_PRNT_SCREEN},
+    {"SCROLLLOCK", HID_KEY_SCROLL_LOCK},
+    {"PAUSE", HID_KEY_PAUSE},
+    {"BREAK", HID_KEY_PAUSE},
+    {"INSERT", HID_KEY_INSERT},
+    {"HOME", HID_KEY_HOME},
+    {"PAGEUP", HID_KEY_PAGE_UP},
+    {"DELETE", HID_KEY_DELETE_FWD},
+    {"DEL", HID_KEY_DELETE_FWD},
+    {"END", HID_KEY_END},
+    {"PAGEDOWN", HID_KEY_PAGE_DOWN},
+    {"RIGHT", HID_KEY_RIGHT_ARROW},
+    {"RIGHTARROW", HID_KEY_RIGHT_ARROW},
+    {"LEFT", HID_KEY_LEFT_ARROW},
+    {"LEFTARROW", HID_KEY_LEFT_ARROW},
+    {"DOWN", HID_KEY_DOWN_ARROW},
+    {"DOWNARROW", HID_KEY_DOWN_ARROW},
+    {"UP", HID_KEY_UP_ARROW},
+    {"UPARROW", HID_KEY_UP_ARROW},
+    {"NUMLOCK", HID_KEY_NUM_LOCK},
+    {"MENU", 101},  /* Keyboard Application */
+    {"APP", 101},
+};
+
+static const script_name_t media_names[] = {
+    {"VOLUMEUP", HID_CONSUMER_VOLUME_UP},
+    {"VOLUMEDOWN", HID_CONSUMER_VOLUME_DOWN},
+    {"MUTE", HID_CONSUMER_MUTE},
+    {"PLAYPAUSE", HID_CONSUMER_PLAY_PAUSE},
+    {"NEXT", HID_CONSUMER_SCAN_NEXT_TRK},
+    {"PREV", HID_CONSUMER_SCAN_PREV_TRK},
+    {"STOP", HID_CONSUMER_STOP},
+};
+
+static const script_name_t led_names[] = {
+    {"CAPS", LED_CAPS_LOCK},
+    {"NUM", LED_NUM_LOCK},
+    {"SCROLL", LED_SCROLL_LOCK},
+};
+
+typedef struct
+{
+    uint8_t *code;
+    size_t cap;
+    size_t len;
+    uint32_t default_delay_ms;
+
+    /* Bytecode of the previous line, for REPEAT; len 0 when it cannot be repeated */
+    size_t last_start;
+    size_t last_len;
+
+    char var_names[SCRIPT_NAMED_VARS][SCRIPT_MAX_VAR_NAME];
+    int num_vars;
+
+    /* Open WHILE loops: loop start and the JZ target to patch at END_WHILE */
+    size_t loop_start[SCRIPT_MAX_NESTING];
+    size_t loop_patch[SCRIPT_MAX_NESTING];
+    int depth;
+
+    const char *error;
+} script_ctx_t;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static bool put(script_ctx_t *ctx, const uint8_t *bytes, size_t n);
+static bool put_op(script_ctx_t *ctx, uint8_t op, const uint8_t *operands, size_t n);
+static bool put_u16_at(script_ctx_t *ctx, size_t at, size_t value);
+static bool put_wait_ms(script_ctx_t *ctx, uint32_t ms);
+static bool lookup(const script_name_t *names, size_t n, const char *name, uint8_t *code);
+static bool parse_int(const char *s, int32_t *value);
+static int find_var(script_ctx_t *ctx, const char *name, bool create);
+static char *next_token(char **s);
+static bool compile_line(script_ctx_t *ctx, char *line, bool *sends_input, bool *repeatable);
+static bool compile_keys(script_ctx_t *ctx, char *rest, const char *first, uint8_t op);
+static bool compile_text(script_ctx_t *ctx, const char *text, bool newline);
+static bool compile_assign(script_ctx_t *ctx, const char *name, char *rest);
+static bool compile_repeat(script_ctx_t *ctx, int32_t count);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+#define SCRIPT_NAMES(table) (table), sizeof(table) / sizeof((table)[0])
+
+static bool put(script_ctx_t *ctx, const uint8_t *bytes, size_t n)
+{
+    if (ctx->len + n > ctx->cap)
+    {
+        ctx->error = "program too large";
+        return false;
+    }
+    memcpy(&ctx->code[ctx->len], bytes, n);
+    ctx->len += n;
+    return true;
+}
+
+static bool put_op(script_ctx_t *ctx, uint8_t op, const uint8_t *operands, size_t n)
+{
+    return put(ctx, &op, 1) && put(ctx, operands, n);
+}
+
+static bool put_u16_at(script_ctx_t *ctx, size_t at, size_t value)
+{
+    if (value > UINT16_MAX)
+    {
+        ctx->error = "jump beyond 64 KiB";
+        return false;
+    }
+    ctx->code[at] = value & 0xff;
+    ctx->code[at + 1] = value >> 8;
+    return true;
+}
+
+static bool put_wait_ms(script_ctx_t *ctx, uint32_t ms)
+{
+    /* Longer than the u32 microsecond operand holds: split */
+    while (ms > 0)
+    {
+        uint32_t chunk = ms > UINT32_MAX / 1000 ? UINT32_MAX / 1000 : ms;
+        uint32_t us = chunk * 1000;
+        uint8_t operands[] = {us & 0xff, (us >> 8) & 0xff, (us >> 16) & 0xff, us >> 24};
+
+        if (!put_op(ctx, SCRIPT_OP_WAIT, operands, sizeof(operands)))
+        {
+            return false;
+        }
+        ms -= chunk;
+    }
+    return true;
+}
+
+static bool lookup(const script_name_t *names, size_t n, const char *name, uint8_t *code)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (strcasecmp(names[i].name, name) == 0)
+        {
+            *code = names[i].code;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_int(const char *s, int32_t *value)
+{
+    char *end;
+
+    if (s == NULL || *s == '\0')
+    {
+        return false;
+    }
+    long v = strtol(s, &end, 0);
+    if (*end != '\0' || v < INT32_MIN || v > INT32_MAX)
+    {
+        return false;
+    }
+    *value = (int32_t)v;
+    return true;
+}
+
+static int find_var(script_ctx_t *ctx, const char *name, bool create)
+{
+    if (name[0] != '$' || strlen(name) >= SCRIPT_MAX_VAR_NAME)
+    {
+        ctx->error = "bad variable name";
+        return -1;
+    }
+    for (int i = 0; i < ctx->num_vars; i++)
+    {
+        if (strcmp(ctx->var_names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    if (!create)
+    {
+        ctx->error = "undeclared variable";
+        return -1;
+    }
+    if (ctx->num_vars == SCRIPT_NAMED_VARS)
+    {
+        ctx->error = "too many variables";
+        return -1;
+    }
+    strcpy(ctx->var_names[ctx->num_vars], name);
+    return ctx->num_vars++;
+}
+
+/* Splits off the next space-separated token, NULL at the end of the line */
+static char *next_token(char **s)
+{
+    char *p = *s;
+
+    while (*p == ' ' || *p == '\t')
+    {
+        p++;
+    }
+    if (*p == '\0')
+    {
+        *s = p;
+        return NULL;
+    }
+
+    char *start = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t')
+    {
+        p++;
+    }
+    if (*p != '\0')
+    {
+        *p++ = '\0';
+    }
+    *s = p;
+    return start;
+}
+
+static bool compile_text(script_ctx_t *ctx, const char *text, bool newline)
+{
+    size_t len = strlen(text);
+
+    while (len > 0)
+    {
+        uint8_t chunk = len > SCRIPT_TEXT_CHUNK ? SCRIPT_TEXT_CHUNK : len;
+        if (!put_op(ctx, SCRIPT_OP_TEXT, &chunk, 1) || !put(ctx, (const uint8_t *)text, chunk))
+        {
+            return false;
+        }
+        text += chunk;
+        len -= chunk;
+    }
+    if (newline)
+    {
+        const uint8_t enter[] = {0, HID_KEY_RETURN};
+        return put_op(ctx, SCRIPT_OP_KEY, enter, sizeof(enter));
+    }
+    return true;
+}
+
+/* Modifiers followed by at most one key; "GUI" on its own taps the modifier */
+static bool compile_keys(script_ctx_t *ctx, char *rest, const char *first, uint8_t op)
+{
+    uint8_t operands[2] = {0, 0};
+    const char *token = first;
+
+    while (token != NULL)
+    {
+        uint8_t code;
+
+        if (operands[1] != 0)
+        {
+            ctx->error = "only one key per line";
+            return false;
+        }
+        if (lookup(SCRIPT_NAMES(modifier_names), token, &code))
+        {
+            operands[0] |= code;
+        }
+        else if (lookup(SCRIPT_NAMES(key_names), token, &code))
+        {
+            operands[1] = code;
+        }
+        else if ((token[0] == 'F' || token[0] == 'f') && atoi(&token[1]) >= 1 && atoi(&token[1]) <= 12)
+        {
+            operands[1] = HID_KEY_F1 + atoi(&token[1]) - 1;
+        }
+        else if (token[1] == '\0' && isalpha((unsigned char)token[0]))
+        {
+            operands[1] = HID_KEY_A + (tolower((unsigned char)token[0]) - 'a');
+        }
+        else if (token[1] == '\0' && token[0] >= '1' && token[0] <= '9')
+        {
+            operands[1] = HID_KEY_1 + (token[0] - '1');
+        }
+        else if (strcmp(token, "0") == 0)
+        {
+            operands[1] = HID_KEY_0;
+        }
+        else
+        {
+            ctx->error = "unknown key";
+            return false;
+        }
+        token = next_token(&rest);
+    }
+
+    return put_op(ctx, op, operands, sizeof(operands));
+}
+
+/* "$x = 5", "$x = $x + 5" and "$x = $x - 5" */
+static bool compile_assign(script_ctx_t *ctx, const char *name, char *rest)
+{
+    int var = find_var(ctx, name, false);
+    char *eq = next_token(&rest);
+    char *value = next_token(&rest);
+    char *sign = next_token(&rest);
+    char *amount = next_token(&rest);
+    int32_t n;
+
+    if (var < 0)
+    {
+        return false;
+    }
+    if (eq == NULL || strcmp(eq, "=") != 0 || value == NULL)
+    {
+        ctx->error = "expected '$var = value'";
+        return false;
+    }
+
+    uint8_t op = SCRIPT_OP_SET;
+    if (sign != NULL)
+    {
+        if (strcmp(value, name) != 0 || amount == NULL || (strcmp(sign, "+") != 0 && strcmp(sign, "-") != 0) ||
+            !parse_int(amount, &n) || next_token(&rest) != NULL)
+        {
+            ctx->error = "only '$var = $var + n' and '$var = $var - n' are supported";
+            return false;
+        }
+        op = SCRIPT_OP_ADD;
+        n = strcmp(sign, "-") == 0 ? -n : n;
+    }
+    else if (!parse_int(value, &n))
+    {
+        ctx->error = "expected an integer";
+        return false;
+    }
+
+    uint8_t operands[] = {var, n & 0xff, (n >> 8) & 0xff, (n >> 16) & 0xff, ((uint32_t)n >> 24) & 0xff};
+    return put_op(ctx, op, operands, sizeof(operands));
+}
+
+/* Loops over a copy of the previous line's bytecode */
+static bool compile_repeat(script_ctx_t *ctx, int32_t count)
+{
+    if (ctx->last_len == 0)
+    {
+        ctx->error = "nothing to repeat";
+        return false;
+    }
+    if (count <= 0)
+    {
+        return true;
+    }
+
+    uint8_t set[] = {SCRIPT_REPEAT_VAR, count & 0xff, (count >> 8) & 0xff, (count >> 16) & 0xff, (uint32_t)count >> 24};
+    if (!put_op(ctx, SCRIPT_OP_SET, set, sizeof(set)))
+    {
+        return false;
+    }
+
+    size_t body = ctx->len;
+    if (ctx->len + ctx->last_len > ctx->cap)
+    {
+        ctx->error = "program too large";
+        return false;
+    }
+    memmove(&ctx->code[ctx->len], &ctx->code[ctx->last_start], ctx->last_len);
+    ctx->len += ctx->last_len;
+
+    uint8_t djnz[] = {SCRIPT_REPEAT_VAR, 0, 0};
+    if (!put_op(ctx, SCRIPT_OP_DJNZ, djnz, sizeof(djnz)))
+    {
+        return false;
+    }
+    return put_u16_at(ctx, ctx->len - 2, body);
+}
+
+static bool compile_line(script_ctx_t *ctx, char *line, bool *sends_input, bool *repeatable)
+{
+    char *rest = line;
+    char *cmd = next_token(&rest);
+    int32_t n;
+
+    *sends_input = false;
+    *repeatable = false;
+
+    if (cmd == NULL || strcmp(cmd, "REM") == 0)
+    {
+        return true;
+    }
+
+    /* STRING keeps the text exactly as written after the single separating space */
+    if (strcmp(cmd, "STRING") == 0 || strcmp(cmd, "STRINGLN") == 0)
+    {
+        *sends_input = *repeatable = true;
+        return compile_text(ctx, rest, strcmp(cmd, "STRINGLN") == 0);
+    }
+
+    if (strcmp(cmd, "DELAY") == 0)
+    {
+        if (!parse_int(next_token(&rest), &n) || n < 0)
+        {
+            ctx->error = "DELAY takes milliseconds";
+            return false;
+        }
+        *repeatable = true;
+        return put_wait_ms(ctx, n);
+    }
+    if (strcmp(cmd, "DEFAULT_DELAY") == 0 || strcmp(cmd, "DEFAULTDELAY") == 0)
+    {
+        if (!parse_int(next_token(&rest), &n) || n < 0)
+        {
+            ctx->error = "DEFAULT_DELAY takes milliseconds";
+            return false;
+        }
+        ctx->default_delay_ms = n;
+        return true;
+    }
+    if (strcmp(cmd, "REPEAT") == 0)
+    {
+        if (!parse_int(next_token(&rest), &n))
+        {
+            ctx->error = "REPEAT takes a count";
+            return false;
+        }
+        return compile_repeat(ctx, n);
+    }
+    if (strcmp(cmd, "HOLD") == 0)
+    {
+        *sends_input = *repeatable = true;
+        return compile_keys(ctx, rest, next_token(&rest), SCRIPT_OP_KEY_DOWN);
+    }
+    if (strcmp(cmd, "RELEASE") == 0)
+    {
+        *sends_input = *repeatable = true;
+        return put_op(ctx, SCRIPT_OP_KEY_UP, NULL, 0);
+    }
+    if (strcmp(cmd, "MOUSE") == 0)
+    {
+        int32_t dx, dy;
+        if (!parse_int(next_token(&rest), &dx) || !parse_int(next_token(&rest), &dy))
+        {
+            ctx->error = "MOUSE takes dx dy";
+            return false;
+        }
+        *sends_input = *repeatable = true;
+        /* One report carries at most +-127 per axis */
+        do
+        {
+            int8_t sx = dx > 127 ? 127 : dx < -127 ? -127 : dx;
+            int8_t sy = dy > 127 ? 127 : dy < -127 ? -127 : dy;
+            uint8_t operands[] = {0, (uint8_t)sx, (uint8_t)sy};
+            if (!put_op(ctx, SCRIPT_OP_MOUSE, operands, sizeof(operands)))
+            {
+                return false;
+            }
+            dx -= sx;
+            dy -= sy;
+        } while (dx != 0 || dy != 0);
+        return true;
+    }
+    if (strcmp(cmd, "CLICK") == 0)
+    {
+        const char *button = next_token(&rest);
+        uint8_t mask = button == NULL || strcasecmp(button, "LEFT") == 0 ? 0x01
+                       : strcasecmp(button, "RIGHT") == 0              ? 0x02
+                       : strcasecmp(button, "MIDDLE") == 0             ? 0x04
+                                                                       : 0;
+        if (mask == 0)
+        {
+            ctx->error = "CLICK takes LEFT, RIGHT or MIDDLE";
+            return false;
+        }
+        uint8_t press[] = {mask, 0, 0};
+        uint8_t release[] = {0, 0, 0};
+        *sends_input = *repeatable = true;
+        return put_op(ctx, SCRIPT_OP_MOUSE, press, sizeof(press)) &&
+               put_op(ctx, SCRIPT_OP_MOUSE, release, sizeof(release));
+    }
+    if (strcmp(cmd, "MEDIA") == 0)
+    {
+        uint8_t usage;
+        const char *name = next_token(&rest);
+        if (name == NULL || !lookup(SCRIPT_NAMES(media_names), name, &usage))
+        {
+            ctx->error = "unknown MEDIA key";
+            return false;
+        }
+        *sends_input = *repeatable = true;
+        return put_op(ctx, SCRIPT_OP_CONSUMER, &usage, 1);
+    }
+    if (strncmp(cmd, "WAIT_FOR_", 9) == 0)
+    {
+        char led[8] = {0};
+        const char *state = strrchr(cmd, '_');
+        uint8_t mask;
+        int32_t timeout = 0;
+        size_t led_len = state - (cmd + 9);
+
+        if (led_len == 0 || led_len >= sizeof(led))
+        {
+            ctx->error = "unknown WAIT_FOR";
+            return false;
+        }
+        memcpy(led, cmd + 9, led_len);
+        if (!lookup(SCRIPT_NAMES(led_names), led, &mask) ||
+            (strcmp(state, "_ON") != 0 && strcmp(state, "_OFF") != 0))
+        {
+            ctx->error = "unknown WAIT_FOR";
+            return false;
+        }
+        char *t = next_token(&rest);
+        if (t != NULL && (!parse_int(t, &timeout) || timeout < 0))
+        {
+            ctx->error = "timeout in milliseconds expected";
+            return false;
+        }
+        uint8_t operands[] = {mask, strcmp(state, "_ON") == 0 ? mask : 0, timeout & 0xff,
+                              (timeout >> 8) & 0xff, (timeout >> 16) & 0xff, (uint32_t)timeout >> 24};
+        return put_op(ctx, SCRIPT_OP_WAIT_LED, operands, sizeof(operands));
+    }
+    if (strcmp(cmd, "VAR") == 0)
+    {
+        char *name = next_token(&rest);
+        if (name == NULL || find_var(ctx, name, true) < 0)
+        {
+            ctx->error = ctx->error != NULL ? ctx->error : "VAR takes a name";
+            return false;
+        }
+        return compile_assign(ctx, name, rest);
+    }
+    if (cmd[0] == '$')
+    {
+        return compile_assign(ctx, cmd, rest);
+    }
+    if (strcmp(cmd, "WHILE") == 0)
+    {
+        char name[SCRIPT_MAX_VAR_NAME + 2];
+        char *cond = next_token(&rest);
+        size_t len = cond != NULL ? strlen(cond) : 0;
+
+        /* WHILE ($x) and WHILE $x */
+        if (len >= sizeof(name) || next_token(&rest) != NULL)
+        {
+            ctx->error = "WHILE takes one variable";
+            return false;
+        }
+        strcpy(name, cond);
+        if (len > 2 && name[0] == '(' && name[len - 1] == ')')
+        {
+            name[len - 1] = '\0';
+            memmove(name, name + 1, len - 1);
+        }
+        int var = find_var(ctx, name, false);
+        if (var < 0)
+        {
+            return false;
+        }
+        if (ctx->depth == SCRIPT_MAX_NESTING)
+        {
+            ctx->error = "loops nested too deep";
+            return false;
+        }
+        ctx->loop_start[ctx->depth] = ctx->len;
+        uint8_t operands[] = {var, 0, 0};
+        if (!put_op(ctx, SCRIPT_OP_JZ, operands, sizeof(operands)))
+        {
+            return false;
+        }
+        ctx->loop_patch[ctx->depth++] = ctx->len - 2;
+        return true;
+    }
+    if (strcmp(cmd, "END_WHILE") == 0)
+    {
+        if (ctx->depth == 0)
+        {
+            ctx->error = "END_WHILE without WHILE";
+            return false;
+        }
+        ctx->depth--;
+        uint8_t operands[] = {0, 0};
+        return put_op(ctx, SCRIPT_OP_JMP, operands, sizeof(operands)) &&
+               put_u16_at(ctx, ctx->len - 2, ctx->loop_start[ctx->depth]) &&
+               put_u16_at(ctx, ctx->loop_patch[ctx->depth], ctx->len);
+    }
+
+    *sends_input = *repeatable = true;
+    return compile_keys(ctx, rest, cmd, SCRIPT_OP_KEY);
+}
+
+bool script_compile(const char *src, uint8_t *code, size_t cap, script_compile_result_t *result)
+{
+    script_ctx_t ctx = {.code = code, .cap = cap};
+    char line[SCRIPT_MAX_LINE];
+    int line_no = 0;
+
+    memset(result, 0, sizeof(*result));
+
+    while (*src != '\0')
+    {
+        const char *eol = strchr(src, '\n');
+        size_t len = eol != NULL ? (size_t)(eol - src) : strlen(src);
+
+        line_no++;
+        if (len >= sizeof(line))
+        {
+            ctx.error = "line too long";
+            break;
+        }
+        memcpy(line, src, len);
+        line[len] = '\0';
+        if (len > 0 && line[len - 1] == '\r')
+        {
+            line[len - 1] = '\0';
+        }
+        src += eol != NULL ? len + 1 : len;
+
+        size_t start = ctx.len;
+        bool sends_input, repeatable;
+        if (!compile_line(&ctx, line, &sends_input, &repeatable))
+        {
+            break;
+        }
+        if (sends_input && ctx.default_delay_ms > 0 && !put_wait_ms(&ctx, ctx.default_delay_ms))
+        {
+            break;
+        }
+        /* REPEAT and blank lines leave the previous line as the one to repeat */
+        if (repeatable)
+        {
+            ctx.last_start = start;
+            ctx.last_len = ctx.len - start;
+        }
+        else if (ctx.len != start)
+        {
+            ctx.last_len = 0;
+        }
+    }
+
+    if (ctx.error == NULL && ctx.depth != 0)
+    {
+        ctx.error = "WHILE without END_WHILE";
+    }
+    if (ctx.error == NULL && !put_op(&ctx, SCRIPT_OP_END, NULL, 0))
+    {
+        line_no = 0;
+    }
+    if (ctx.error != NULL)
+    {
+        result->line = line_no;
+        result->error = ctx.error;
+        return false;
+    }
+
+    result->len = ctx.len;
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef SCRIPT_COMPILER_H
+#define SCRIPT_COMPILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+    Compiles a DuckyScript-style program into script_vm.h bytecode. One command per line:
+
+        REM <comment>
+        STRING <text>                   type text
+        STRINGLN <text>                 type text, then Enter
+        DELAY <ms>
+        DEFAULT_DELAY <ms>              wait after every later line that sends input
+        REPEAT <n>                      run the previous line n more times
+        [CTRL] [SHIFT] [ALT] [GUI] <key>    tap, e.g. "GUI r", "CTRL ALT DELETE", "ENTER"
+        HOLD [modifiers] <key>          press and keep down
+        RELEASE                         release everything
+        MOUSE <dx> <dy>                 relative move
+        CLICK LEFT|RIGHT|MIDDLE
+        MEDIA <name>                    VOLUMEUP, VOLUMEDOWN, MUTE, PLAYPAUSE, NEXT, PREV, STOP
+        WAIT_FOR_<CAPS|NUM|SCROLL>_<ON|OFF> [timeout ms]
+        VAR $name = <int>
+        $name = <int>
+        $name = $name + <int>           or - <int>
+        WHILE ($name)                   loop while $name is not zero
+        END_WHILE
+
+    Only needs hid_codes.h for key codes, so the same file builds into a host tool that
+    produces bytecode for the 'script load' console command, see host_test/.
+*/
+
+typedef struct
+{
+    size_t len;             /* bytes of bytecode written */
+    int line;               /* line of the first error, 0 on success */
+    const char *error;
+} script_compile_result_t;
+
+bool script_compile(const char *src, uint8_t *code, size_t cap, script_compile_result_t *result);
+
+#endif
@@ -0,0 +1,226 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <string.h>
+
+#include "script_vm.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+/* Operand bytes after each opcode, -1 for TEXT whose length is in its first operand */
+static const int8_t operand_len[] = {
+    [SCRIPT_OP_END] = 0,
+    [SCRIPT_OP_KEY] = 2,
+    [SCRIPT_OP_KEY_DOWN] = 2,
+    [SCRIPT_OP_KEY_UP] = 0,
+    [SCRIPT_OP_MOUSE] = 3,
+    [SCRIPT_OP_CONSUMER] = 1,
+    [SCRIPT_OP_TEXT] = -1,
+    [SCRIPT_OP_WAIT] = 4,
+    [SCRIPT_OP_WAIT_LED] = 6,
+    [SCRIPT_OP_SET] = 5,
+    [SCRIPT_OP_ADD] = 5,
+    [SCRIPT_OP_JZ] = 3,
+    [SCRIPT_OP_JMP] = 2,
+    [SCRIPT_OP_DJNZ] = 3,
+};
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static uint16_t read_u16(const uint8_t *p);
+static uint32_t read_u32(const uint8_t *p);
+static void emit_key(const script_host_t *host, uint8_t type, uint8_t modifier, uint8_t keycode);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+static uint16_t read_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void emit_key(const script_host_t *host, uint8_t type, uint8_t modifier, uint8_t keycode)
+{
+    input_event_t event = {.type = type};
+
+    event.keyboard.modifier = modifier;
+    event.keyboard.keycode = keycode;
+    host->emit(&event, host->ctx);
+}
+
+void script_vm_run(const uint8_t *code, size_t len, const script_host_t *host, script_result_t *result)
+{
+    uint64_t deadline = host->now_us(host->ctx);
+    size_t pc = 0;
+
+    memset(result, 0, sizeof(*result));
+
+    while (pc < len)
+    {
+        uint8_t op = code[pc];
+        const uint8_t *arg = &code[pc + 1];
+        size_t next;
+
+        if (op >= sizeof(operand_len) / sizeof(operand_len[0]))
+        {
+            result->status = SCRIPT_ERR_OPCODE;
+            break;
+        }
+        if (operand_len[op] < 0)
+        {
+            next = pc + 2 + (pc + 1 < len ? code[pc + 1] : 0);
+        }
+        else
+        {
+            next = pc + 1 + operand_len[op];
+        }
+        if (next > len)
+        {
+            result->status = SCRIPT_ERR_BOUNDS;
+            break;
+        }
+        if ((op == SCRIPT_OP_SET || op == SCRIPT_OP_ADD || op == SCRIPT_OP_JZ || op == SCRIPT_OP_DJNZ) &&
+            arg[0] >= SCRIPT_NUM_VARS)
+        {
+            result->status = SCRIPT_ERR_VAR;
+            break;
+        }
+
+        result->steps++;
+
+        switch (op)
+        {
+        case SCRIPT_OP_END:
+            result->pc = pc;
+            return;
+        case SCRIPT_OP_KEY:
+            emit_key(host, INPUT_EVENT_KEYBOARD, arg[0], arg[1]);
+            break;
+        case SCRIPT_OP_KEY_DOWN:
+            emit_key(host, INPUT_EVENT_KEY_REPORT, arg[0], arg[1]);
+            break;
+        case SCRIPT_OP_KEY_UP:
+            emit_key(host, INPUT_EVENT_KEY_REPORT, 0, 0);
+            break;
+        case SCRIPT_OP_MOUSE:
+        {
+            input_event_t event = {.type = INPUT_EVENT_MOUSE};
+            event.mouse.mouse_buttons = arg[0];
+            event.mouse.movement_x = (int8_t)arg[1];
+            event.mouse.movement_y = (int8_t)arg[2];
+            host->emit(&event, host->ctx);
+            break;
+        }
+        case SCRIPT_OP_CONSUMER:
+        {
+            input_event_t event = {.type = INPUT_EVENT_CONSUMER};
+            event.consumer.usage = arg[0];
+            event.consumer.pressed = 1;
+            host->emit(&event, host->ctx);
+            event.consumer.pressed = 0;
+            host->emit(&event, host->ctx);
+            break;
+        }
+        case SCRIPT_OP_TEXT:
+            host->type_text((const char *)&arg[1], arg[0], host->ctx);
+            /* Typing takes as long as the link allows; the next wait counts from here */
+            deadline = host->now_us(host->ctx);
+            break;
+        case SCRIPT_OP_WAIT:
+            deadline += read_u32(arg);
+            host->wait_until(deadline, host->ctx);
+            break;
+        case SCRIPT_OP_WAIT_LED:
+        {
+            uint32_t timeout_ms = read_u32(&arg[2]);
+            uint64_t start = host->now_us(host->ctx);
+            uint64_t now = start;
+
+            while ((host->leds(host->ctx) & arg[0]) != arg[1])
+            {
+                if (host->should_stop(host->ctx))
+                {
+                    result->status = SCRIPT_STOPPED;
+                    break;
+                }
+                if (timeout_ms != 0 && now - start >= (uint64_t)timeout_ms * 1000)
+                {
+                    result->status = SCRIPT_ERR_TIMEOUT;
+                    break;
+                }
+                host->wait_until(now + SCRIPT_LED_POLL_US, host->ctx);
+                now = host->now_us(host->ctx);
+            }
+            deadline = now;
+            break;
+        }
+        case SCRIPT_OP_SET:
+            result->vars[arg[0]] = (int32_t)read_u32(&arg[1]);
+            break;
+        case SCRIPT_OP_ADD:
+            result->vars[arg[0]] += (int32_t)read_u32(&arg[1]);
+            break;
+        case SCRIPT_OP_JZ:
+            if (result->vars[arg[0]] == 0)
+            {
+                next = read_u16(&arg[1]);
+            }
+            break;
+        case SCRIPT_OP_JMP:
+            next = read_u16(arg);
+            break;
+        case SCRIPT_OP_DJNZ:
+            if (--result->vars[arg[0]] != 0)
+            {
+                next = read_u16(&arg[1]);
+            }
+            break;
+        }
+
+        if (result->status != SCRIPT_OK)
+        {
+            break;
+        }
+        if (next > len)
+        {
+            result->status = SCRIPT_ERR_BOUNDS;
+            break;
+        }
+        /* Loops and waits are where a runaway program spends its time */
+        if ((next <= pc || op == SCRIPT_OP_WAIT) && host->should_stop(host->ctx))
+        {
+            result->status = SCRIPT_STOPPED;
+            break;
+        }
+        pc = next;
+    }
+
+    result->pc = pc;
+}
+
+const char *script_status_to_str(script_status_t status)
+{
+    switch (status)
+    {
+    case SCRIPT_OK:
+        return "ok";
+    case SCRIPT_STOPPED:
+        return "stopped";
+    case SCRIPT_ERR_OPCODE:
+        return "unknown opcode";
+    case SCRIPT_ERR_BOUNDS:
+        return "out of bounds";
+    case SCRIPT_ERR_VAR:
+        return "bad variable";
+    case SCRIPT_ERR_TIMEOUT:
+        return "LED wait timed out";
+    }
+    return "unknown";
+}
@@ -0,0 +1,96 @@
+#ifndef SCRIPT_VM_H
+#define SCRIPT_VM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ble_kbm_types.h"
+
+/*
+    Bytecode for on-device input programs. Operands follow the opcode byte, multi-byte values
+    are little endian, jump targets are absolute offsets into the program:
+
+        END                             stop
+        KEY         <mod> <key>         key tap, pressed and released
+        KEY_DOWN    <mod> <key>         keyboard report, held until the next KEY_DOWN or KEY_UP
+        KEY_UP                          release everything
+        MOUSE       <buttons> <dx> <dy> dx and dy signed
+        CONSUMER    <usage>             consumer control tap
+        TEXT        <len> <bytes>       typed through the typing planner
+        WAIT        <u32 us>            wait, measured from the end of the previous wait, TEXT
+                                        or WAIT_LED
+        WAIT_LED    <mask> <value> <u32 ms>   wait until (LEDs & mask) == value, 0 ms waits forever
+        SET         <var> <i32>         var = value
+        ADD         <var> <i32>         var += value
+        JZ          <var> <u16>         jump if var == 0
+        JMP         <u16>               jump
+        DJNZ        <var> <u16>         var -= 1, jump if var != 0
+
+    This file has no ESP-IDF dependencies; everything the VM does to the outside world goes
+    through script_host_t, so the same code runs against a recording host on a PC.
+*/
+
+#define SCRIPT_OP_END       0x00
+#define SCRIPT_OP_KEY       0x01
+#define SCRIPT_OP_KEY_DOWN  0x02
+#define SCRIPT_OP_KEY_UP    0x03
+#define SCRIPT_OP_MOUSE     0x04
+#define SCRIPT_OP_CONSUMER  0x05
+#define SCRIPT_OP_TEXT      0x06
+#define SCRIPT_OP_WAIT      0x07
+#define SCRIPT_OP_WAIT_LED  0x08
+#define SCRIPT_OP_SET       0x09
+#define SCRIPT_OP_ADD       0x0a
+#define SCRIPT_OP_JZ        0x0b
+#define SCRIPT_OP_JMP       0x0c
+#define SCRIPT_OP_DJNZ      0x0d
+
+#define SCRIPT_NUM_VARS     8
+
+/* Period at which WAIT_LED re-reads the LED state */
+#define SCRIPT_LED_POLL_US  1000
+
+typedef enum
+{
+    SCRIPT_OK,
+    SCRIPT_STOPPED,         /* host asked to stop */
+    SCRIPT_ERR_OPCODE,      /* unknown opcode */
+    SCRIPT_ERR_BOUNDS,      /* operand or jump target outside the program */
+    SCRIPT_ERR_VAR,         /* variable index out of range */
+    SCRIPT_ERR_TIMEOUT,     /* WAIT_LED gave up */
+} script_status_t;
+
+typedef struct
+{
+    /* Hands one event to the HID pipeline */
+    void (*emit)(const input_event_t *event, void *ctx);
+    /* Types text; the host plans Shift and Caps Lock */
+    void (*type_text)(const char *text, size_t len, void *ctx);
+    /* Monotonic time and an absolute wait, both in microseconds */
+    uint64_t (*now_us)(void *ctx);
+    void (*wait_until)(uint64_t deadline_us, void *ctx);
+    /* LED_* bits last written by the host */
+    uint8_t (*leds)(void *ctx);
+    /* Polled at every jump and wait; return true to abort */
+    bool (*should_stop)(void *ctx);
+    void *ctx;
+} script_host_t;
+
+typedef struct
+{
+    script_status_t status;
+    size_t pc;              /* offset of the instruction that stopped the program */
+    uint32_t steps;         /* instructions executed */
+    int32_t vars[SCRIPT_NUM_VARS];
+} script_result_t;
+
+/*
+    Runs a program to completion on the calling task. Waits are scheduled against a running
+    deadline, so time spent emitting short events does not add up over a long program.
+*/
+void script_vm_run(const uint8_t *code, size_t len, const script_host_t *host, script_result_t *result);
+
+const char *script_status_to_str(script_status_t status);
+
+#endif
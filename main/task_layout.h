@@ -0,0 +1,21 @@
+#ifndef TASK_LAYOUT_H
+#define TASK_LAYOUT_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sdkconfig.h"
+
+/* Core affinity of our own tasks, see KBM_TASK_LAYOUT in Kconfig.projbuild */
+#if CONFIG_KBM_TASK_LAYOUT_PINNED
+#define KBM_HID_TASK_CORE       CONFIG_BT_BLUEDROID_PINNED_TO_CORE
+#define KBM_CONSOLE_TASK_CORE   (!CONFIG_BT_BLUEDROID_PINNED_TO_CORE)
+#else
+#define KBM_HID_TASK_CORE       tskNO_AFFINITY
+#define KBM_CONSOLE_TASK_CORE   tskNO_AFFINITY
+#endif
+
+extern TaskHandle_t hid_task_handle;
+extern TaskHandle_t console_task_handle;
+
+#endif
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include <math.h>
+#include <string.h>
+
+#include "touch_gesture.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TOUCH_CENTRE        (TOUCH_LOGICAL_MAX / 2)
+/* About 1.5 cm between neighbouring fingers */
+#define TOUCH_FINGER_GAP    150
+/* Closest two pinching fingers get */
+#define TOUCH_PINCH_MIN     60
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static uint16_t clamp_axis(float value);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+bool touch_gesture_init(touch_gesture_t *gesture, touch_gesture_kind_t kind, uint8_t fingers, int32_t dx,
+                        int32_t dy, int32_t spread, uint32_t steps)
+{
+    bool valid = kind == TOUCH_GESTURE_SWIPE ? (fingers == 3 || fingers == 4) : fingers == 2;
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    memset(gesture, 0, sizeof(*gesture));
+    gesture->kind = kind;
+    gesture->fingers = fingers;
+    gesture->dx = dx;
+    gesture->dy = dy;
+    gesture->spread = spread;
+    gesture->steps = steps > 0 ? steps : 1;
+    return true;
+}
+
+static uint16_t clamp_axis(float value)
+{
+    long rounded = lroundf(value);
+    return rounded < 0 ? 0 : rounded > TOUCH_LOGICAL_MAX ? TOUCH_LOGICAL_MAX : rounded;
+}
+
+bool touch_gesture_next(touch_gesture_t *gesture, touch_frame_t *frame)
+{
+    if (gesture->step > gesture->steps)
+    {
+        return false;
+    }
+
+    /* Lift where the last frame left the fingers */
+    if (gesture->step == gesture->steps)
+    {
+        *frame = gesture->last;
+        for (uint8_t i = 0; i < frame->count; i++)
+        {
+            frame->contacts[i].tip = false;
+        }
+        gesture->step++;
+        return true;
+    }
+
+    /* Frame 0 touches down, frame steps - 1 reaches the target, frame steps lifts there */
+    float t = gesture->steps > 1 ? (float)gesture->step / (gesture->steps - 1) : 1;
+    float first = TOUCH_CENTRE - (gesture->fingers - 1) * TOUCH_FINGER_GAP / 2.0f;
+    float gap = TOUCH_FINGER_GAP;
+    float x_offset = t * gesture->dx;
+    float y_offset = t * gesture->dy;
+
+    if (gesture->kind == TOUCH_GESTURE_PINCH)
+    {
+        gap = TOUCH_FINGER_GAP * 2 + t * gesture->spread;
+        gap = gap < TOUCH_PINCH_MIN ? TOUCH_PINCH_MIN : gap;
+        first = TOUCH_CENTRE - gap / 2;
+        x_offset = 0;
+        y_offset = 0;
+    }
+
+    frame->count = gesture->fingers;
+    for (uint8_t i = 0; i < gesture->fingers; i++)
+    {
+        frame->contacts[i].id = i;
+        frame->contacts[i].tip = true;
+        frame->contacts[i].x = clamp_axis(first + i * gap + x_offset);
+        frame->contacts[i].y = clamp_axis(TOUCH_CENTRE + y_offset);
+    }
+
+    gesture->last = *frame;
+    gesture->step++;
+    return true;
+}
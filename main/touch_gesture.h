@@ -0,0 +1,70 @@
+#ifndef TOUCH_GESTURE_H
+#define TOUCH_GESTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Expands a touchpad gesture into contact frames, one per connection interval, for the
+    Precision Touchpad collection. Coordinates are absolute on the pad, 0 to
+    TOUCH_LOGICAL_MAX on both axes, which the report map declares as 10 x 10 cm.
+
+        SCROLL      two fingers side by side moving by dx, dy
+        PINCH       two fingers on a horizontal line moving apart by spread, or together
+                    when negative; zoom in and out
+        SWIPE       three or four fingers moving by dx, dy; task view, desktop switching
+
+    Fingers touch down at the centre of the pad, move for the given number of frames and
+    lift in one last frame with the tip switch cleared. Positions are clamped to the pad.
+
+    No ESP-IDF dependencies, so it builds and runs on a PC as well.
+*/
+
+#define TOUCH_MAX_CONTACTS  5
+#define TOUCH_LOGICAL_MAX   1000
+
+typedef enum
+{
+    TOUCH_GESTURE_SCROLL,
+    TOUCH_GESTURE_PINCH,
+    TOUCH_GESTURE_SWIPE,
+} touch_gesture_kind_t;
+
+typedef struct
+{
+    uint8_t id;
+    bool tip;
+    uint16_t x;
+    uint16_t y;
+} touch_contact_t;
+
+typedef struct
+{
+    touch_contact_t contacts[TOUCH_MAX_CONTACTS];
+    uint8_t count;
+} touch_frame_t;
+
+typedef struct
+{
+    touch_gesture_kind_t kind;
+    uint8_t fingers;
+    int32_t dx;
+    int32_t dy;
+    int32_t spread;
+    uint32_t steps;
+
+    uint32_t step;      /* frames produced; steps + 1 once the fingers have lifted */
+    touch_frame_t last;
+} touch_gesture_t;
+
+/*
+    fingers is 2 for SCROLL and PINCH, 3 or 4 for SWIPE; returns false otherwise. spread is
+    only used by PINCH, dx and dy by the others.
+*/
+bool touch_gesture_init(touch_gesture_t *gesture, touch_gesture_kind_t kind, uint8_t fingers, int32_t dx,
+                        int32_t dy, int32_t spread, uint32_t steps);
+
+/* Next frame; returns false once the fingers have lifted */
+bool touch_gesture_next(touch_gesture_t *gesture, touch_frame_t *frame);
+
+#endif
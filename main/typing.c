@@ -0,0 +1,703 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hidd_prf_api.h"
+#include <string.h>
+#include <stdlib.h>
+
+#include "hid_dev.h"
+#include "hid_tx_sched.h"
+#include "led_events.h"
+#include "typing.h"
+#include "typing_unicode.h"
+#include "capture.h"
+#include "hid_stats.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_TYPING"
+
+/* Characters planned together; the end state of one window seeds the next */
+#define TYPING_PLAN_WINDOW 64
+
+/* Cost of each step in HID reports, see typing.h for keys and modifiers */
+#define TYPING_CAPS_TOGGLE_COST 2   /* Caps Lock press + release */
+#define TYPING_COST_INF         0x7FFF
+
+/* Planner state: bit 0 is Shift held, bit 1 is Caps Lock on */
+#define STATE_SHIFT(s)          ((s) & 1)
+#define STATE_CAPS(s)           (((s) >> 1) & 1)
+#define STATE(caps, shift)      (((caps) << 1) | (shift))
+#define NUM_STATES              4
+
+typedef struct
+{
+    uint8_t keycode;
+    uint8_t shift;
+} typing_key_t;
+
+/* US layout for everything that is not a letter or a digit */
+static const typing_key_t us_symbols[128] = {
+    ['\b'] = {HID_KEY_DELETE, 0},
+    ['\t'] = {HID_KEY_TAB, 0},
+    ['\n'] = {HID_KEY_RETURN, 0},
+    [' '] = {HID_KEY_SPACEBAR, 0},
+    ['!'] = {HID_KEY_1, 1},
+    ['"'] = {HID_KEY_SGL_QUOTE, 1},
+    ['#'] = {HID_KEY_3, 1},
+    ['$'] = {HID_KEY_4, 1},
+    ['%'] = {HID_KEY_5, 1},
+    ['&'] = {HID_KEY_7, 1},
+    ['\''] = {HID_KEY_SGL_QUOTE, 0},
+    ['('] = {HID_KEY_9, 1},
+    [')'] = {HID_KEY_0, 1},
+    ['*'] = {HID_KEY_8, 1},
+    ['+'] = {HID_KEY_EQUAL, 1},
+    [','] = {HID_KEY_COMMA, 0},
+    ['-'] = {HID_KEY_MINUS, 0},
+    ['.'] = {HID_KEY_DOT, 0},
+    ['/'] = {HID_KEY_FWD_SLASH, 0},
+    [':'] = {HID_KEY_SEMI_COLON, 1},
+    [';'] = {HID_KEY_SEMI_COLON, 0},
+    ['<'] = {HID_KEY_COMMA, 1},
+    ['='] = {HID_KEY_EQUAL, 0},
+    ['>'] = {HID_KEY_DOT, 1},
+    ['?'] = {HID_KEY_FWD_SLASH, 1},
+    ['@'] = {HID_KEY_2, 1},
+    ['['] = {HID_KEY_LEFT_BRKT, 0},
+    ['\\'] = {HID_KEY_BACK_SLASH, 0},
+    [']'] = {HID_KEY_RIGHT_BRKT, 0},
+    ['^'] = {HID_KEY_6, 1},
+    ['_'] = {HID_KEY_MINUS, 1},
+    ['`'] = {HID_KEY_GRV_ACCENT, 0},
+    ['{'] = {HID_KEY_LEFT_BRKT, 1},
+    ['|'] = {HID_KEY_BACK_SLASH, 1},
+    ['}'] = {HID_KEY_RIGHT_BRKT, 1},
+    ['~'] = {HID_KEY_GRV_ACCENT, 1},
+};
+
+static volatile bool host_caps_lock = false;
+static bool caps_toggle_allowed = true;
+
+#if CONFIG_KBM_TYPING_CACHE_ENTRIES > 0
+/*
+    A planned text, keyed by everything the plan depends on: the text, the lock state it
+    started from and the settings that stand in for the layout. Reports are packed as
+    modifier << 8 | keycode; the text follows them in the same allocation.
+*/
+typedef struct
+{
+    uint32_t hash;
+    uint32_t last_used;         /* 0 for an empty slot */
+    size_t len;
+    uint8_t state;              /* TYPING_CACHE_* bits */
+    bool final_caps;
+    uint16_t num_reports;
+    uint16_t *reports;
+    const char *text;
+} typing_cache_entry_t;
+
+#define TYPING_CACHE_CAPS       (1 << 0)
+#define TYPING_CACHE_NUM        (1 << 1)
+#define TYPING_CACHE_TOGGLE     (1 << 2)
+#define TYPING_CACHE_METHODS(m) ((m) << 4)
+
+typedef struct
+{
+    typing_emit_t emit;
+    void *ctx;
+    uint16_t *reports;          /* CONFIG_KBM_TYPING_CACHE_MAX_REPORTS, owned by the caller */
+    uint16_t count;
+    bool overflow;
+} typing_recorder_t;
+
+/*
+    The HID and script tasks both type. The lock covers the lookup and the insert only, never
+    an emit: emitting can block on a full input ring that only the HID task drains.
+*/
+static SemaphoreHandle_t cache_lock;
+static typing_cache_entry_t cache[CONFIG_KBM_TYPING_CACHE_ENTRIES];
+static uint32_t cache_clock;
+#endif
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static void typing_on_led_event(const led_event_t *event, void *ctx);
+static bool typing_lookup(char c, typing_key_t *key, bool *is_letter);
+static size_t typing_plan_window(const char *text, size_t len, uint8_t *state, bool restore_caps,
+                                 uint8_t initial_caps, typing_emit_t emit, void *ctx);
+static void typing_send_report(uint8_t modifier, uint8_t keycode, void *ctx);
+static size_t typing_utf8_decode(const char *text, size_t len, uint32_t *code_point);
+static size_t typing_plan_text(const char *text, size_t len, bool *caps_lock, typing_emit_t emit, void *ctx);
+#if CONFIG_KBM_TYPING_CACHE_ENTRIES > 0
+static uint32_t typing_hash(const char *text, size_t len);
+static void typing_record_report(uint8_t modifier, uint8_t keycode, void *ctx);
+static typing_cache_entry_t *typing_cache_find(uint32_t hash, const char *text, size_t len, uint8_t state);
+static void typing_cache_insert(uint32_t hash, const char *text, size_t len, uint8_t state, bool final_caps,
+                                const uint16_t *reports, uint16_t num_reports);
+#endif
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void typing_init(void)
+{
+    /* Restored across deep sleep; the host's next LED write overrides it */
+    host_caps_lock = (led_events_last().leds & LED_CAPS_LOCK) != 0;
+    ESP_ERROR_CHECK(led_events_subscribe(&typing_on_led_event, NULL));
+
+#if CONFIG_KBM_TYPING_CACHE_ENTRIES > 0
+    cache_lock = xSemaphoreCreateMutex();
+    if (cache_lock == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create typing cache lock, typing uncached");
+    }
+#endif
+
+#if defined(CONFIG_KBM_UNICODE_INPUT_WINDOWS)
+    typing_unicode_set_methods(TYPING_UNICODE_WIN_ALT);
+#elif defined(CONFIG_KBM_UNICODE_INPUT_WINDOWS_HEX)
+    typing_unicode_set_methods(TYPING_UNICODE_WIN_ALT | TYPING_UNICODE_WIN_HEX);
+#elif defined(CONFIG_KBM_UNICODE_INPUT_LINUX)
+    typing_unicode_set_methods(TYPING_UNICODE_LINUX);
+#elif defined(CONFIG_KBM_UNICODE_INPUT_MACOS)
+    typing_unicode_set_methods(TYPING_UNICODE_MACOS);
+#endif
+}
+
+void typing_set_caps_toggle(bool allowed)
+{
+    caps_toggle_allowed = allowed;
+}
+
+bool typing_host_caps_lock(void)
+{
+    return host_caps_lock;
+}
+
+static void typing_on_led_event(const led_event_t *event, void *ctx)
+{
+    host_caps_lock = (event->leds & LED_CAPS_LOCK) != 0;
+}
+
+static bool typing_lookup(char c, typing_key_t *key, bool *is_letter)
+{
+    *is_letter = false;
+
+    if (c >= 'a' && c <= 'z')
+    {
+        key->keycode = HID_KEY_A + (c - 'a');
+        key->shift = 0;
+        *is_letter = true;
+    }
+    else if (c >= 'A' && c <= 'Z')
+    {
+        key->keycode = HID_KEY_A + (c - 'A');
+        key->shift = 1;
+        *is_letter = true;
+    }
+    else if (c >= '1' && c <= '9')
+    {
+        key->keycode = HID_KEY_1 + (c - '1');
+        key->shift = 0;
+    }
+    else if (c == '0')
+    {
+        key->keycode = HID_KEY_0;
+        key->shift = 0;
+    }
+    else if ((unsigned char)c < 128 && us_symbols[(unsigned char)c].keycode != 0)
+    {
+        *key = us_symbols[(unsigned char)c];
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+size_t typing_plan(const char *text, size_t len, bool *caps_lock, typing_emit_t emit, void *ctx)
+{
+#if CONFIG_KBM_TYPING_CACHE_ENTRIES > 0
+    if (cache_lock == NULL)
+    {
+        return typing_plan_text(text, len, caps_lock, emit, ctx);
+    }
+
+    uint32_t hash = typing_hash(text, len);
+    uint8_t state = (*caps_lock ? TYPING_CACHE_CAPS : 0) |
+                    ((led_events_last().leds & LED_NUM_LOCK) ? TYPING_CACHE_NUM : 0) |
+                    (caps_toggle_allowed ? TYPING_CACHE_TOGGLE : 0) |
+                    TYPING_CACHE_METHODS(typing_unicode_methods());
+
+    /* A hit is copied out so the reports can be emitted with the lock released */
+    uint16_t *copy = NULL;
+    uint16_t num_reports = 0;
+    bool final_caps = false;
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    typing_cache_entry_t *entry = typing_cache_find(hash, text, len, state);
+    if (entry != NULL)
+    {
+        copy = malloc(entry->num_reports * sizeof(uint16_t));
+        if (copy != NULL)
+        {
+            memcpy(copy, entry->reports, entry->num_reports * sizeof(uint16_t));
+            num_reports = entry->num_reports;
+            final_caps = entry->final_caps;
+        }
+    }
+    xSemaphoreGive(cache_lock);
+
+    if (copy != NULL)
+    {
+        hid_stats_inc(HID_STAT_TYPING_CACHE_HIT);
+        for (uint16_t r = 0; r < num_reports; r++)
+        {
+            emit(copy[r] >> 8, copy[r] & 0xff, ctx);
+        }
+        free(copy);
+        *caps_lock = final_caps;
+        return num_reports;
+    }
+
+    hid_stats_inc(HID_STAT_TYPING_CACHE_MISS);
+    typing_recorder_t recorder = {
+        .emit = emit,
+        .ctx = ctx,
+        .reports = malloc(CONFIG_KBM_TYPING_CACHE_MAX_REPORTS * sizeof(uint16_t)),
+    };
+    recorder.overflow = recorder.reports == NULL;
+    size_t reports = typing_plan_text(text, len, caps_lock, &typing_record_report, &recorder);
+    if (!recorder.overflow)
+    {
+        xSemaphoreTake(cache_lock, portMAX_DELAY);
+        typing_cache_insert(hash, text, len, state, *caps_lock, recorder.reports, recorder.count);
+        xSemaphoreGive(cache_lock);
+    }
+    free(recorder.reports);
+    return reports;
+#else
+    return typing_plan_text(text, len, caps_lock, emit, ctx);
+#endif
+}
+
+void typing_cache_clear(void)
+{
+#if CONFIG_KBM_TYPING_CACHE_ENTRIES > 0
+    if (cache_lock == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    for (size_t i = 0; i < CONFIG_KBM_TYPING_CACHE_ENTRIES; i++)
+    {
+        free(cache[i].reports);
+        memset(&cache[i], 0, sizeof(cache[i]));
+    }
+    xSemaphoreGive(cache_lock);
+#endif
+}
+
+#if CONFIG_KBM_TYPING_CACHE_ENTRIES > 0
+/* FNV-1a */
+static uint32_t typing_hash(const char *text, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Passes reports on as they are planned and keeps a copy for the cache */
+static void typing_record_report(uint8_t modifier, uint8_t keycode, void *ctx)
+{
+    typing_recorder_t *recorder = ctx;
+
+    if (!recorder->overflow && recorder->count < CONFIG_KBM_TYPING_CACHE_MAX_REPORTS)
+    {
+        recorder->reports[recorder->count++] = (modifier << 8) | keycode;
+    }
+    else
+    {
+        recorder->overflow = true;
+    }
+    recorder->emit(modifier, keycode, recorder->ctx);
+}
+
+/* Marks the entry used; call with cache_lock held */
+static typing_cache_entry_t *typing_cache_find(uint32_t hash, const char *text, size_t len, uint8_t state)
+{
+    cache_clock++;
+    for (size_t i = 0; i < CONFIG_KBM_TYPING_CACHE_ENTRIES; i++)
+    {
+        typing_cache_entry_t *entry = &cache[i];
+        if (entry->last_used != 0 && entry->hash == hash && entry->len == len && entry->state == state &&
+            memcmp(entry->text, text, len) == 0)
+        {
+            entry->last_used = cache_clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Call with cache_lock held */
+static void typing_cache_insert(uint32_t hash, const char *text, size_t len, uint8_t state, bool final_caps,
+                                const uint16_t *recorded, uint16_t num_reports)
+{
+    /* The other task may have planned the same text while the lock was free */
+    if (typing_cache_find(hash, text, len, state) != NULL)
+    {
+        return;
+    }
+
+    typing_cache_entry_t *victim = &cache[0];
+
+    for (size_t i = 1; i < CONFIG_KBM_TYPING_CACHE_ENTRIES && victim->last_used != 0; i++)
+    {
+        if (cache[i].last_used < victim->last_used)
+        {
+            victim = &cache[i];
+        }
+    }
+
+    free(victim->reports);
+    memset(victim, 0, sizeof(*victim));
+
+    uint16_t *reports = malloc(num_reports * sizeof(uint16_t) + len);
+    if (reports == NULL)
+    {
+        return;
+    }
+    memcpy(reports, recorded, num_reports * sizeof(uint16_t));
+    memcpy(&reports[num_reports], text, len);
+
+    victim->hash = hash;
+    victim->last_used = cache_clock;
+    victim->len = len;
+    victim->state = state;
+    victim->final_caps = final_caps;
+    victim->num_reports = num_reports;
+    victim->reports = reports;
+    victim->text = (const char *)&reports[num_reports];
+}
+#endif
+
+static size_t typing_plan_text(const char *text, size_t len, bool *caps_lock, typing_emit_t emit, void *ctx)
+{
+    uint8_t initial_caps = *caps_lock ? 1 : 0;
+    uint8_t state = STATE(initial_caps, 0);
+    size_t reports = 0;
+
+    while (len > 0)
+    {
+        /* ASCII goes through the layout, anything else through the host's Unicode input */
+        size_t chunk = 0;
+        while (chunk < len && chunk < TYPING_PLAN_WINDOW && (unsigned char)text[chunk] < 0x80)
+        {
+            chunk++;
+        }
+        if (chunk > 0)
+        {
+            reports += typing_plan_window(text, chunk, &state, chunk == len, initial_caps, emit, ctx);
+            text += chunk;
+            len -= chunk;
+            continue;
+        }
+
+        /* Input methods bring their own modifiers */
+        if (STATE_SHIFT(state))
+        {
+            emit(0, 0, ctx);
+            reports += TYPING_MODIFIER_COST;
+            state = STATE(STATE_CAPS(state), 0);
+        }
+
+        uint32_t code_points[TYPING_UNICODE_MAX_RUN];
+        size_t count = 0;
+        while (len > 0 && count < TYPING_UNICODE_MAX_RUN && (unsigned char)*text >= 0x80)
+        {
+            size_t used = typing_utf8_decode(text, len, &code_points[count]);
+            if (used == 0)
+            {
+                ESP_LOGW(TAG, "Invalid UTF-8 byte 0x%02x, skipped", (unsigned char)*text);
+                used = 1;
+            }
+            else
+            {
+                count++;
+            }
+            text += used;
+            len -= used;
+        }
+        reports += typing_unicode_plan(code_points, count, emit, ctx);
+    }
+
+    /* Only the layout planner restores Caps Lock, so a Unicode run at the end needs it here */
+    if (STATE_CAPS(state) != initial_caps)
+    {
+        emit(0, HID_KEY_CAPS_LOCK, ctx);
+        emit(0, 0, ctx);
+        reports += TYPING_CAPS_TOGGLE_COST;
+        state = STATE(initial_caps, 0);
+    }
+
+    *caps_lock = STATE_CAPS(state);
+    return reports;
+}
+
+/* Bytes used by the sequence at text, 0 if it is not well-formed UTF-8 */
+static size_t typing_utf8_decode(const char *text, size_t len, uint32_t *code_point)
+{
+    const unsigned char *s = (const unsigned char *)text;
+    static const uint32_t min_value[4] = {0, 0x80, 0x800, 0x10000};
+    size_t n;
+
+    if (s[0] >= 0xc2 && s[0] <= 0xdf)
+    {
+        n = 2;
+        *code_point = s[0] & 0x1f;
+    }
+    else if (s[0] >= 0xe0 && s[0] <= 0xef)
+    {
+        n = 3;
+        *code_point = s[0] & 0x0f;
+    }
+    else if (s[0] >= 0xf0 && s[0] <= 0xf4)
+    {
+        n = 4;
+        *code_point = s[0] & 0x07;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (n > len)
+    {
+        return 0;
+    }
+    for (size_t i = 1; i < n; i++)
+    {
+        if ((s[i] & 0xc0) != 0x80)
+        {
+            return 0;
+        }
+        *code_point = (*code_point << 6) | (s[i] & 0x3f);
+    }
+
+    /* Overlong forms, surrogates and anything past U+10FFFF */
+    if (*code_point < min_value[n - 1] || (*code_point >= 0xd800 && *code_point <= 0xdfff) ||
+        *code_point > 0x10ffff)
+    {
+        return 0;
+    }
+    return n;
+}
+
+/*
+    Viterbi over the four (Caps Lock, Shift) states. For a letter the Shift state is forced by
+    its case and the Caps Lock state, for anything else by the layout alone. Toggling Caps
+    Lock is sent without modifiers, so Shift is released by the toggle.
+*/
+static size_t typing_plan_window(const char *text, size_t len, uint8_t *state, bool restore_caps,
+                                 uint8_t initial_caps, typing_emit_t emit, void *ctx)
+{
+    int16_t cost[NUM_STATES];
+    uint8_t from[TYPING_PLAN_WINDOW][NUM_STATES];
+    typing_key_t keys[TYPING_PLAN_WINDOW];
+    bool typeable[TYPING_PLAN_WINDOW];
+    uint8_t path[TYPING_PLAN_WINDOW];
+    size_t reports = 0;
+
+    for (uint8_t s = 0; s < NUM_STATES; s++)
+    {
+        cost[s] = s == *state ? 0 : TYPING_COST_INF;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        int16_t next[NUM_STATES];
+        bool is_letter;
+
+        typeable[i] = typing_lookup(text[i], &keys[i], &is_letter);
+        if (!typeable[i])
+        {
+            ESP_LOGW(TAG, "No key for character 0x%02x, skipped", (unsigned char)text[i]);
+            for (uint8_t s = 0; s < NUM_STATES; s++)
+            {
+                from[i][s] = s;
+            }
+            continue;
+        }
+
+        for (uint8_t ns = 0; ns < NUM_STATES; ns++)
+        {
+            uint8_t caps = STATE_CAPS(ns);
+            uint8_t shift = STATE_SHIFT(ns);
+
+            next[ns] = TYPING_COST_INF;
+            from[i][ns] = 0;
+
+            if (!caps_toggle_allowed && caps != initial_caps)
+            {
+                continue;
+            }
+            if (shift != (is_letter ? (keys[i].shift ^ caps) : keys[i].shift))
+            {
+                continue;
+            }
+
+            for (uint8_t ps = 0; ps < NUM_STATES; ps++)
+            {
+                if (cost[ps] == TYPING_COST_INF)
+                {
+                    continue;
+                }
+
+                bool toggle = STATE_CAPS(ps) != caps;
+                uint8_t held = toggle ? 0 : STATE_SHIFT(ps);
+                int16_t c = cost[ps] + TYPING_KEY_COST +
+                            (toggle ? TYPING_CAPS_TOGGLE_COST : 0) +
+                            (held != shift ? TYPING_MODIFIER_COST : 0);
+
+                if (c < next[ns])
+                {
+                    next[ns] = c;
+                    from[i][ns] = ps;
+                }
+            }
+        }
+        memcpy(cost, next, sizeof(cost));
+    }
+
+    /* Pick the cheapest end state, including the cost of cleaning up after the last window */
+    uint8_t best = *state;
+    int16_t best_cost = TYPING_COST_INF;
+    for (uint8_t s = 0; s < NUM_STATES; s++)
+    {
+        if (cost[s] == TYPING_COST_INF)
+        {
+            continue;
+        }
+
+        int16_t c = cost[s];
+        if (restore_caps)
+        {
+            c += STATE_CAPS(s) != initial_caps ? TYPING_CAPS_TOGGLE_COST
+                                               : (STATE_SHIFT(s) ? TYPING_MODIFIER_COST : 0);
+        }
+        if (c < best_cost)
+        {
+            best_cost = c;
+            best = s;
+        }
+    }
+
+    for (size_t i = len; i > 0; i--)
+    {
+        path[i - 1] = best;
+        best = from[i - 1][best];
+    }
+
+    uint8_t cur = *state;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t ns = path[i];
+
+        if (!typeable[i])
+        {
+            continue;
+        }
+
+        uint8_t held = STATE_SHIFT(cur);
+        if (STATE_CAPS(cur) != STATE_CAPS(ns))
+        {
+            emit(0, HID_KEY_CAPS_LOCK, ctx);
+            emit(0, 0, ctx);
+            reports += TYPING_CAPS_TOGGLE_COST;
+            held = 0;
+        }
+
+        uint8_t modifier = STATE_SHIFT(ns) ? LEFT_SHIFT_KEY_MASK : 0;
+        if (held != STATE_SHIFT(ns))
+        {
+            emit(modifier, 0, ctx);
+            reports += TYPING_MODIFIER_COST;
+        }
+
+        emit(modifier, keys[i].keycode, ctx);
+        emit(modifier, 0, ctx);
+        reports += TYPING_KEY_COST;
+        cur = ns;
+    }
+
+    if (restore_caps)
+    {
+        if (STATE_CAPS(cur) != initial_caps)
+        {
+            emit(0, HID_KEY_CAPS_LOCK, ctx);
+            emit(0, 0, ctx);
+            reports += TYPING_CAPS_TOGGLE_COST;
+            cur = STATE(initial_caps, 0);
+        }
+        else if (STATE_SHIFT(cur))
+        {
+            emit(0, 0, ctx);
+            reports += TYPING_MODIFIER_COST;
+            cur = STATE(STATE_CAPS(cur), 0);
+        }
+    }
+
+    *state = cur;
+    return reports;
+}
+
+static void typing_send_report(uint8_t modifier, uint8_t keycode, void *ctx)
+{
+    uint16_t conn_id = *(uint16_t *)ctx;
+    input_event_t event = {.timestamp_us = (uint32_t)esp_timer_get_time(), .type = INPUT_EVENT_KEY_REPORT};
+
+    /* Typed text replays as the reports it produced */
+    event.keyboard.modifier = modifier;
+    event.keyboard.keycode = keycode;
+    capture_record(&event);
+
+    /* Typing can outrun the link; wait for the key lane to drain rather than drop a release */
+    while (!hid_tx_sched_push_key(conn_id, modifier, &keycode, 1))
+    {
+        hid_tx_sched_flush(conn_id);
+        vTaskDelay(1);
+    }
+    if (keycode == HID_KEY_CAPS_LOCK)
+    {
+        /* Track our own toggle right away; the host's LED write confirms it later */
+        host_caps_lock = !host_caps_lock;
+    }
+}
+
+size_t typing_type_string(uint16_t conn_id, const char *text)
+{
+    bool caps = host_caps_lock;
+    size_t len = strlen(text);
+    size_t reports = typing_plan(text, len, &caps, &typing_send_report, &conn_id);
+
+    hid_tx_sched_flush(conn_id);
+
+    ESP_LOGD(TAG, "Typed %u characters with %u reports", len, reports);
+    return reports;
+}
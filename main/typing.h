@@ -0,0 +1,46 @@
+#ifndef TYPING_H
+#define TYPING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+    Cost of each step in HID reports. A modifier change gets a report of its own before the
+    key because some hosts drop Shift when it arrives in the same report as the key.
+*/
+#define TYPING_KEY_COST         2   /* press + release */
+#define TYPING_MODIFIER_COST    1
+
+/* Called once per HID keyboard report the planner wants sent */
+typedef void (*typing_emit_t)(uint8_t modifier, uint8_t keycode, void *ctx);
+
+void typing_init(void);
+
+/*
+    Plans the report sequence for text given the host's current Caps Lock state and hands
+    every report to emit. Shift is kept held across a run of characters that need it and
+    Caps Lock is toggled when that is cheaper, e.g. for long uppercase runs broken up by
+    digits or punctuation. Caps Lock is restored to its original state at the end.
+    text is UTF-8; characters outside ASCII are typed through the host's Unicode input
+    method, see typing_unicode.h, or skipped if none is enabled.
+    Returns the number of reports emitted. *caps_lock is updated to the final state.
+*/
+size_t typing_plan(const char *text, size_t len, bool *caps_lock, typing_emit_t emit, void *ctx);
+
+/*
+    typing_plan() keeps the report sequences of recently typed texts, keyed by the text, the
+    starting lock state, the Caps Lock toggle setting and the Unicode input methods, and
+    replays them instead of planning again. Hits and misses are counted in hid_stats.
+*/
+void typing_cache_clear(void);
+
+/* Types text on the given connection using the host lock state reported through LED writes */
+size_t typing_type_string(uint16_t conn_id, const char *text);
+
+/* Allow or forbid the planner to toggle Caps Lock, e.g. for hosts with a Caps Lock delay */
+void typing_set_caps_toggle(bool allowed);
+
+bool typing_host_caps_lock(void);
+
+#endif
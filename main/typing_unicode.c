@@ -0,0 +1,372 @@
+/******************************************************************************
+ * Dependencies
+ *****************************************************************************/
+#include "freertos/FreeRTOS.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_hidd_prf_api.h"
+
+#include "hid_dev.h"
+#include "led_events.h"
+#include "typing_unicode.h"
+
+/******************************************************************************
+ * File variables
+ *****************************************************************************/
+#define TAG "ESP32_KBM_UNICODE"
+
+/* Key sequences are cached per code point and method; direct mapped, a power of two */
+#define TYPING_UNICODE_CACHE_SIZE   64
+#define TYPING_UNICODE_MAX_KEYS     8   /* two UTF-16 units of four hex digits on macOS */
+#define TYPING_UNICODE_COST_INF     0x7FFFFFFF
+
+#define TYPING_UNICODE_WINDOWS      (TYPING_UNICODE_WIN_ALT | TYPING_UNICODE_WIN_HEX)
+#define TYPING_UNICODE_NUM_METHODS  4
+
+typedef struct
+{
+    uint32_t code_point;    /* 0 for an empty slot */
+    uint8_t method;
+    uint8_t num_keys;       /* 0 if method cannot type code_point */
+    uint8_t keys[TYPING_UNICODE_MAX_KEYS];
+} unicode_entry_t;
+
+/* Windows-1252 0x80 to 0x9f; from 0xa0 it matches Latin-1 */
+static const uint16_t cp1252_high[32] = {
+    0x20ac, 0, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021,
+    0x02c6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017d, 0,
+    0, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+    0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0, 0x017e, 0x0178,
+};
+
+static uint8_t enabled_methods;
+static unicode_entry_t cache[TYPING_UNICODE_CACHE_SIZE];
+/* Any task may type; a slot is filled and copied out under the lock, never used in place */
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************
+ * Function declarations
+ *****************************************************************************/
+static uint8_t digit_key(uint8_t digit, bool keypad);
+static uint8_t encode_hex(uint32_t value, size_t min_digits, bool keypad, uint8_t *keys);
+static uint8_t encode(uint32_t code_point, uint8_t method, uint8_t *keys);
+static void lookup(uint32_t code_point, uint8_t method, unicode_entry_t *out);
+static uint32_t char_cost(const unicode_entry_t *entry, bool option_held);
+static uint32_t run_overhead(uint8_t methods_used, bool num_lock);
+static size_t emit_code_point(const unicode_entry_t *entry, bool *option_held, typing_emit_t emit, void *ctx);
+
+/******************************************************************************
+ * Function implementation
+ *****************************************************************************/
+void typing_unicode_set_methods(uint8_t methods)
+{
+    enabled_methods = methods;
+}
+
+uint8_t typing_unicode_methods(void)
+{
+    return enabled_methods;
+}
+
+static uint8_t digit_key(uint8_t digit, bool keypad)
+{
+    if (digit >= 10)
+    {
+        /* Hex letters come from the main block on every host */
+        return HID_KEY_A + (digit - 10);
+    }
+    if (keypad)
+    {
+        return digit == 0 ? HID_KEYPAD_0 : HID_KEYPAD_1 + (digit - 1);
+    }
+    return digit == 0 ? HID_KEY_0 : HID_KEY_1 + (digit - 1);
+}
+
+/* Hex digits of value, most significant first, padded to min_digits */
+static uint8_t encode_hex(uint32_t value, size_t min_digits, bool keypad, uint8_t *keys)
+{
+    uint8_t n = 0;
+    int shift = 28;
+
+    while (shift > 0 && (value >> shift) == 0 && (size_t)(shift / 4) >= min_digits)
+    {
+        shift -= 4;
+    }
+    for (; shift >= 0; shift -= 4)
+    {
+        keys[n++] = digit_key((value >> shift) & 0xf, keypad);
+    }
+    return n;
+}
+
+static uint8_t encode(uint32_t code_point, uint8_t method, uint8_t *keys)
+{
+    switch (method)
+    {
+    case TYPING_UNICODE_WIN_ALT:
+    {
+        uint32_t byte = code_point >= 0xa0 && code_point <= 0xff ? code_point : 0;
+
+        for (uint32_t i = 0; byte == 0 && i < sizeof(cp1252_high) / sizeof(cp1252_high[0]); i++)
+        {
+            if (cp1252_high[i] == code_point)
+            {
+                byte = 0x80 + i;
+            }
+        }
+        if (byte == 0)
+        {
+            return 0;
+        }
+
+        /* The leading 0 picks the ANSI code page over the OEM one */
+        keys[0] = digit_key(0, true);
+        keys[1] = digit_key(byte / 100, true);
+        keys[2] = digit_key(byte / 10 % 10, true);
+        keys[3] = digit_key(byte % 10, true);
+        return 4;
+    }
+    case TYPING_UNICODE_WIN_HEX:
+        return code_point <= 0xffff ? encode_hex(code_point, 1, true, keys) : 0;
+    case TYPING_UNICODE_LINUX:
+        return encode_hex(code_point, 1, false, keys);
+    case TYPING_UNICODE_MACOS:
+        if (code_point <= 0xffff)
+        {
+            return encode_hex(code_point, 4, false, keys);
+        }
+        else
+        {
+            uint32_t v = code_point - 0x10000;
+            uint8_t n = encode_hex(0xd800 | (v >> 10), 4, false, keys);
+            return n + encode_hex(0xdc00 | (v & 0x3ff), 4, false, &keys[n]);
+        }
+    }
+    return 0;
+}
+
+static void lookup(uint32_t code_point, uint8_t method, unicode_entry_t *out)
+{
+    unicode_entry_t *entry = &cache[(code_point * 4 + method) & (TYPING_UNICODE_CACHE_SIZE - 1)];
+
+    portENTER_CRITICAL(&cache_lock);
+    if (entry->code_point != code_point || entry->method != method)
+    {
+        entry->code_point = code_point;
+        entry->method = method;
+        entry->num_keys = encode(code_point, method, entry->keys);
+    }
+    *out = *entry;
+    portEXIT_CRITICAL(&cache_lock);
+}
+
+/* Reports for one character, matching what emit_code_point() sends */
+static uint32_t char_cost(const unicode_entry_t *entry, bool option_held)
+{
+    uint32_t digits = entry->num_keys * TYPING_KEY_COST;
+
+    switch (entry->method)
+    {
+    case TYPING_UNICODE_WIN_ALT:
+        return TYPING_MODIFIER_COST + digits + TYPING_MODIFIER_COST;
+    case TYPING_UNICODE_WIN_HEX:
+        return TYPING_MODIFIER_COST + TYPING_KEY_COST + digits + TYPING_MODIFIER_COST;
+    case TYPING_UNICODE_LINUX:
+        return TYPING_MODIFIER_COST + TYPING_KEY_COST + TYPING_MODIFIER_COST + digits + TYPING_KEY_COST;
+    case TYPING_UNICODE_MACOS:
+        return (option_held ? 0 : TYPING_MODIFIER_COST) + digits;
+    }
+    return TYPING_UNICODE_COST_INF;
+}
+
+/* Reports a run costs beyond its characters: Option release, Num Lock on and off for the keypad */
+static uint32_t run_overhead(uint8_t methods_used, bool num_lock)
+{
+    uint32_t cost = 0;
+
+    if (methods_used & TYPING_UNICODE_MACOS)
+    {
+        cost += TYPING_MODIFIER_COST;
+    }
+    if ((methods_used & TYPING_UNICODE_WINDOWS) && !num_lock)
+    {
+        cost += 2 * TYPING_KEY_COST;
+    }
+    return cost;
+}
+
+static size_t emit_code_point(const unicode_entry_t *entry, bool *option_held, typing_emit_t emit, void *ctx)
+{
+    const uint8_t ctrl_shift = LEFT_CONTROL_KEY_MASK | LEFT_SHIFT_KEY_MASK;
+    uint8_t modifier = 0;
+    size_t reports = 0;
+
+    if (*option_held && entry->method != TYPING_UNICODE_MACOS)
+    {
+        emit(0, 0, ctx);
+        reports += TYPING_MODIFIER_COST;
+        *option_held = false;
+    }
+
+    switch (entry->method)
+    {
+    case TYPING_UNICODE_WIN_ALT:
+    case TYPING_UNICODE_WIN_HEX:
+        modifier = LEFT_ALT_KEY_MASK;
+        emit(modifier, 0, ctx);
+        reports += TYPING_MODIFIER_COST;
+        if (entry->method == TYPING_UNICODE_WIN_HEX)
+        {
+            emit(modifier, HID_KEY_ADD, ctx);
+            emit(modifier, 0, ctx);
+            reports += TYPING_KEY_COST;
+        }
+        break;
+    case TYPING_UNICODE_LINUX:
+        emit(ctrl_shift, 0, ctx);
+        emit(ctrl_shift, HID_KEY_U, ctx);
+        emit(ctrl_shift, 0, ctx);
+        emit(0, 0, ctx);
+        reports += TYPING_MODIFIER_COST + TYPING_KEY_COST + TYPING_MODIFIER_COST;
+        break;
+    case TYPING_UNICODE_MACOS:
+        modifier = LEFT_ALT_KEY_MASK;
+        if (!*option_held)
+        {
+            emit(modifier, 0, ctx);
+            reports += TYPING_MODIFIER_COST;
+            *option_held = true;
+        }
+        break;
+    }
+
+    for (uint8_t i = 0; i < entry->num_keys; i++)
+    {
+        emit(modifier, entry->keys[i], ctx);
+        emit(modifier, 0, ctx);
+        reports += TYPING_KEY_COST;
+    }
+
+    switch (entry->method)
+    {
+    case TYPING_UNICODE_WIN_ALT:
+    case TYPING_UNICODE_WIN_HEX:
+        /* Releasing Alt commits the character */
+        emit(0, 0, ctx);
+        reports += TYPING_MODIFIER_COST;
+        break;
+    case TYPING_UNICODE_LINUX:
+        emit(0, HID_KEY_SPACEBAR, ctx);
+        emit(0, 0, ctx);
+        reports += TYPING_KEY_COST;
+        break;
+    }
+    return reports;
+}
+
+/*
+    Tries every enabled method on the whole run, since the per-run setup (Option held across
+    macOS characters, Num Lock for the Windows keypad) is shared, and keeps the cheapest one
+    that types every character. If none does, each character takes its own cheapest method.
+*/
+size_t typing_unicode_plan(const uint32_t *code_points, size_t count, typing_emit_t emit, void *ctx)
+{
+    bool num_lock = (led_events_last().leds & LED_NUM_LOCK) != 0;
+    uint8_t best_method = 0;
+    uint32_t best_cost = TYPING_UNICODE_COST_INF;
+    size_t reports = 0;
+
+    if (count == 0 || count > TYPING_UNICODE_MAX_RUN)
+    {
+        return 0;
+    }
+
+    for (uint8_t m = 0; m < TYPING_UNICODE_NUM_METHODS; m++)
+    {
+        uint8_t method = 1 << m;
+        uint32_t cost = run_overhead(method, num_lock);
+
+        if (!(enabled_methods & method))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < count && cost != TYPING_UNICODE_COST_INF; i++)
+        {
+            unicode_entry_t entry;
+            lookup(code_points[i], method, &entry);
+            cost = entry.num_keys == 0 ? TYPING_UNICODE_COST_INF : cost + char_cost(&entry, i > 0);
+        }
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_method = method;
+        }
+    }
+
+    /* Method chosen per character, 0 to skip it */
+    uint8_t plan[TYPING_UNICODE_MAX_RUN];
+    uint8_t methods_used = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        plan[i] = best_method;
+        if (best_method == 0)
+        {
+            uint32_t cost = TYPING_UNICODE_COST_INF;
+            for (uint8_t m = 0; m < TYPING_UNICODE_NUM_METHODS; m++)
+            {
+                if (!(enabled_methods & (1 << m)))
+                {
+                    continue;
+                }
+                unicode_entry_t entry;
+                lookup(code_points[i], 1 << m, &entry);
+                if (entry.num_keys != 0 && char_cost(&entry, false) < cost)
+                {
+                    cost = char_cost(&entry, false);
+                    plan[i] = 1 << m;
+                }
+            }
+        }
+
+        if (plan[i] == 0)
+        {
+            ESP_LOGW(TAG, "No input method for U+%04X, skipped", (unsigned)code_points[i]);
+        }
+        methods_used |= plan[i];
+    }
+
+    bool toggle_num_lock = (methods_used & TYPING_UNICODE_WINDOWS) && !num_lock;
+    if (toggle_num_lock)
+    {
+        emit(0, HID_KEY_NUM_LOCK, ctx);
+        emit(0, 0, ctx);
+        reports += TYPING_KEY_COST;
+    }
+
+    bool option_held = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        /* Looked up again: another character of the run may have reused the slot */
+        if (plan[i] != 0)
+        {
+            unicode_entry_t entry;
+            lookup(code_points[i], plan[i], &entry);
+            reports += emit_code_point(&entry, &option_held, emit, ctx);
+        }
+    }
+
+    if (option_held)
+    {
+        emit(0, 0, ctx);
+        reports += TYPING_MODIFIER_COST;
+    }
+    if (toggle_num_lock)
+    {
+        emit(0, HID_KEY_NUM_LOCK, ctx);
+        emit(0, 0, ctx);
+        reports += TYPING_KEY_COST;
+    }
+    return reports;
+}
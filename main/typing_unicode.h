@@ -0,0 +1,39 @@
+#ifndef TYPING_UNICODE_H
+#define TYPING_UNICODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "typing.h"
+
+/*
+    Types characters the keyboard layout has no key for through the host's own Unicode
+    input method. Each needs setting up on the host side:
+
+        WIN_ALT     Alt + keypad 0nnn, the ANSI code page; needs nothing but only covers
+                    Windows-1252, i.e. Latin-1 and a few typographic characters
+        WIN_HEX     Alt + keypad '+' + hex, any BMP character; needs the EnableHexNumpad
+                    registry value
+        LINUX       Ctrl+Shift+U, hex, space; IBus and GTK
+        MACOS       Option + four hex digits per UTF-16 unit; needs the Unicode Hex Input
+                    input source selected
+
+    More than one may be enabled, for a host that supports several; each run of characters
+    goes the way that takes the fewest HID reports.
+*/
+
+#define TYPING_UNICODE_WIN_ALT  (1 << 0)
+#define TYPING_UNICODE_WIN_HEX  (1 << 1)
+#define TYPING_UNICODE_LINUX    (1 << 2)
+#define TYPING_UNICODE_MACOS    (1 << 3)
+
+/* Most code points planned together */
+#define TYPING_UNICODE_MAX_RUN  64
+
+void typing_unicode_set_methods(uint8_t methods);
+uint8_t typing_unicode_methods(void);
+
+/* Plans and emits a run of code points, skipping any no enabled method can type. Returns reports */
+size_t typing_unicode_plan(const uint32_t *code_points, size_t count, typing_emit_t emit, void *ctx);
+
+#endif